@@ -0,0 +1,277 @@
+// *****************************************************************************
+    // include Vircon32 headers
+    #include "ConsoleLogic/V32Console.hpp"
+    
+    // include the autogenerated embedded benchmark programs
+    #include <embedded/BenchmarkBulkMemory.h>
+    #include <embedded/BenchmarkFloatMath.h>
+    #include <embedded/BenchmarkIntegerALU.h>
+    #include <embedded/BenchmarkPortIO.h>
+    #include <embedded/BenchmarkRotozoom.h>
+    #include <embedded/BenchmarkSPUChannels.h>
+    #include <embedded/BenchmarkStackCalls.h>
+    
+    // include C/C++ headers
+    #include <cstdio>           // [ ANSI C ] Standard I/O
+    #include <cstdlib>          // [ ANSI C ] Standard library
+    #include <cstring>          // [ ANSI C ] Strings
+    #include <chrono>           // [ C++ STL ] Time
+    #include <sstream>          // [ C++ STL ] String streams
+    #include <stdexcept>        // [ C++ STL ] Exceptions
+    #include <string>           // [ C++ STL ] Strings
+    #include <vector>           // [ C++ STL ] Vectors
+    
+    // declare used namespaces
+    using namespace std;
+    using namespace V32;
+// *****************************************************************************
+
+
+// =============================================================================
+//      HEADLESS CALLBACKS
+// =============================================================================
+
+
+// console messages are only shown on request
+static bool ShowConsoleLog = false;
+
+class LoggingCallbacks: public HeadlessCallbacks
+{
+    public:
+        
+        virtual void LogLine( const string& Message ) override
+        {
+            if( ShowConsoleLog )
+              printf( "  [console] %s\n", Message.c_str() );
+        }
+};
+
+// -----------------------------------------------------------------------------
+
+// nothing is drawn: only the emulated GPU does
+// its work, so results don't depend on OpenGL
+static LoggingCallbacks HeadlessOutput;
+
+
+// =============================================================================
+//      BENCHMARK PROGRAMS
+// =============================================================================
+
+
+// each program is a BIOS, so no cartridge is needed
+typedef struct
+{
+    const char* Name;
+    const unsigned char* BiosData;
+    size_t BiosBytes;
+}
+BenchmarkProgram;
+
+// -----------------------------------------------------------------------------
+
+const BenchmarkProgram BenchmarkPrograms[] =
+{
+    { "IntegerALU",  embedded_BenchmarkIntegerALU,  sizeof( embedded_BenchmarkIntegerALU ) },
+    { "FloatMath",   embedded_BenchmarkFloatMath,   sizeof( embedded_BenchmarkFloatMath ) },
+    { "StackCalls",  embedded_BenchmarkStackCalls,  sizeof( embedded_BenchmarkStackCalls ) },
+    { "BulkMemory",  embedded_BenchmarkBulkMemory,  sizeof( embedded_BenchmarkBulkMemory ) },
+    { "PortIO",      embedded_BenchmarkPortIO,      sizeof( embedded_BenchmarkPortIO ) },
+    { "Rotozoom",    embedded_BenchmarkRotozoom,    sizeof( embedded_BenchmarkRotozoom ) },
+    { "SPUChannels", embedded_BenchmarkSPUChannels, sizeof( embedded_BenchmarkSPUChannels ) }
+};
+
+
+// =============================================================================
+//      RUNNING BENCHMARKS
+// =============================================================================
+
+
+// results are averaged over all measured frames
+typedef struct
+{
+    double MeanFrameMilliseconds;
+    double WorstFrameMilliseconds;
+    double GuestMIPS;
+    double CPULoad;
+    double GPULoad;
+    bool CPUHalted;
+}
+BenchmarkResult;
+
+// -----------------------------------------------------------------------------
+
+// the console is large, so a single one is reused
+static V32Console Console;
+static SPUOutputBuffer SoundOutput;
+
+// -----------------------------------------------------------------------------
+
+BenchmarkResult RunBenchmark( const BenchmarkProgram& Program, int WarmupFrames, int MeasuredFrames )
+{
+    // load the program as BIOS and start from a reset
+    stringstream BiosData;
+    BiosData.write( (const char*)Program.BiosData, Program.BiosBytes );
+    
+    Console.SetPower( false );
+    Console.LoadBiosData( BiosData );
+    Console.SetPower( true );
+    
+    // the first frames are not measured, so that
+    // caches and branch predictors are warmed up
+    for( int Frame = 0; Frame < WarmupFrames; Frame++ )
+    {
+        Console.RunNextFrame( false );
+        Console.GetFrameSoundOutput( SoundOutput );
+    }
+    
+    // guest instructions are counted from the cycles
+    // run each frame, since each one takes 1 cycle
+    BenchmarkResult Result;
+    memset( &Result, 0, sizeof(BenchmarkResult) );
+    
+    double TotalSeconds = 0;
+    double GuestInstructions = 0;
+    
+    for( int Frame = 0; Frame < MeasuredFrames; Frame++ )
+    {
+        auto FrameStart = chrono::steady_clock::now();
+        Console.RunNextFrame( false );
+        Console.GetFrameSoundOutput( SoundOutput );
+        auto FrameEnd = chrono::steady_clock::now();
+        
+        double FrameSeconds = chrono::duration< double >( FrameEnd - FrameStart ).count();
+        TotalSeconds += FrameSeconds;
+        
+        if( FrameSeconds * 1000 > Result.WorstFrameMilliseconds )
+          Result.WorstFrameMilliseconds = FrameSeconds * 1000;
+        
+        GuestInstructions += Console.Timer.CycleCounter;
+        Result.CPULoad += Console.LastCPULoads[ 0 ];
+        Result.GPULoad += Console.LastGPULoads[ 0 ];
+    }
+    
+    Result.MeanFrameMilliseconds = TotalSeconds * 1000 / MeasuredFrames;
+    Result.GuestMIPS = GuestInstructions / TotalSeconds / 1000000;
+    Result.CPULoad /= MeasuredFrames;
+    Result.GPULoad /= MeasuredFrames;
+    Result.CPUHalted = Console.IsCPUHalted();
+    return Result;
+}
+
+
+// =============================================================================
+//      MAIN FUNCTION
+// =============================================================================
+
+
+void PrintUsage()
+{
+    printf( "USAGE: vircon32_benchmark [options] [benchmark names]\n" );
+    printf( "Options:\n" );
+    printf( "  --frames <N>   Measured frames for each benchmark (default: 600)\n" );
+    printf( "  --warmup <N>   Frames run before measuring (default: 60)\n" );
+    printf( "  --log          Show console log messages\n" );
+    printf( "  --list         List available benchmarks\n" );
+    printf( "With no names, all benchmarks are run.\n" );
+}
+
+// -----------------------------------------------------------------------------
+
+int main( int NumberOfArguments, char* Arguments[] )
+{
+    int MeasuredFrames = 600;
+    int WarmupFrames = 60;
+    vector< string > SelectedNames;
+    
+    // process command line arguments
+    for( int i = 1; i < NumberOfArguments; i++ )
+    {
+        string Argument = Arguments[ i ];
+        
+        if( Argument == "--frames" && i + 1 < NumberOfArguments )
+          MeasuredFrames = max( 1, atoi( Arguments[ ++i ] ) );
+        
+        else if( Argument == "--warmup" && i + 1 < NumberOfArguments )
+          WarmupFrames = max( 0, atoi( Arguments[ ++i ] ) );
+        
+        else if( Argument == "--log" )
+          ShowConsoleLog = true;
+        
+        else if( Argument == "--list" )
+        {
+            for( const BenchmarkProgram& Program: BenchmarkPrograms )
+              printf( "%s\n", Program.Name );
+            
+            return 0;
+        }
+        
+        else if( Argument[ 0 ] == '-' )
+        {
+            PrintUsage();
+            return 1;
+        }
+        
+        else SelectedNames.push_back( Argument );
+    }
+    
+    // the console needs all callbacks
+    Console.SetCallbacks( &HeadlessOutput );
+    
+    printf( "%-12s %10s %10s %11s %9s %9s\n", "Benchmark", "ms/frame", "worst ms", "guest MIPS", "CPU load", "GPU load" );
+    bool AllPassed = true;
+    bool AnyRun = false;
+    
+    for( const BenchmarkProgram& Program: BenchmarkPrograms )
+    {
+        // when names are given, run only those
+        if( !SelectedNames.empty() )
+        {
+            bool Selected = false;
+            
+            for( const string& Name: SelectedNames )
+              if( Name == Program.Name )
+                Selected = true;
+            
+            if( !Selected )
+              continue;
+        }
+        
+        AnyRun = true;
+        
+        try
+        {
+            BenchmarkResult Result = RunBenchmark( Program, WarmupFrames, MeasuredFrames );
+            
+            printf
+            (
+                "%-12s %10.3f %10.3f %11.2f %8.1f%% %8.1f%%%s\n",
+                Program.Name,
+                Result.MeanFrameMilliseconds,
+                Result.WorstFrameMilliseconds,
+                Result.GuestMIPS,
+                Result.CPULoad,
+                Result.GPULoad,
+                Result.CPUHalted? "  FAILED (CPU halted)" : ""
+            );
+            
+            // benchmarks never halt unless
+            // there was a hardware error
+            if( Result.CPUHalted )
+              AllPassed = false;
+        }
+        
+        catch( exception& e )
+        {
+            printf( "%-12s FAILED: %s\n", Program.Name, e.what() );
+            AllPassed = false;
+        }
+    }
+    
+    if( !AnyRun )
+    {
+        printf( "No benchmarks were selected\n" );
+        return 1;
+    }
+    
+    return (AllPassed? 0 : 1);
+}
@@ -0,0 +1,439 @@
+// *****************************************************************************
+    // include Vircon32 headers
+    #include "ConsoleLogic/V32Console.hpp"
+    
+    // include emulator headers
+    #include "Savestates.hpp"
+    
+    // include the autogenerated embedded bios file
+    #include <embedded/StandardBios.h>
+    
+    // include C/C++ headers
+    #include <cstdio>           // [ ANSI C ] Standard I/O
+    #include <cstdlib>          // [ ANSI C ] Standard library
+    #include <chrono>           // [ C++ STL ] Time
+    #include <memory>           // [ C++ STL ] Smart pointers
+    #include <sstream>          // [ C++ STL ] String streams
+    #include <stdexcept>        // [ C++ STL ] Exceptions
+    #include <string>           // [ C++ STL ] Strings
+    #include <vector>           // [ C++ STL ] Vectors
+    
+    // declare used namespaces
+    using namespace std;
+    using namespace V32;
+// *****************************************************************************
+
+
+// =============================================================================
+//      HEADLESS CALLBACKS
+// =============================================================================
+
+
+// nothing is drawn, so kernels are measured
+// without any cost from the video library
+static HeadlessCallbacks KernelCallbacks;
+
+// -----------------------------------------------------------------------------
+
+// all kernels work on this console
+static V32Console Console;
+
+
+// =============================================================================
+//      KERNELS TO MEASURE
+// =============================================================================
+
+
+// results are accumulated here so that
+// the compiler cannot discard the work
+static volatile int32_t ResultSink = 0;
+
+// -----------------------------------------------------------------------------
+
+static void WritePort( IOPorts Port, int32_t Value )
+{
+    V32Word Word;
+    Word.AsInteger = Value;
+    Console.ControlBus.WritePort( (int32_t)Port, Word );
+}
+
+// -----------------------------------------------------------------------------
+
+static void WritePort( IOPorts Port, float Value )
+{
+    V32Word Word;
+    Word.AsFloat = Value;
+    Console.ControlBus.WritePort( (int32_t)Port, Word );
+}
+
+// -----------------------------------------------------------------------------
+
+// channels play the BIOS sound in a loop, each one at a
+// different speed so that their positions don't match
+static void PrepareSPUChannels( int ActiveChannels )
+{
+    WritePort( IOPorts::SPU_Command, (int32_t)IOPortValues::SPUCommand_StopAllChannels );
+    
+    for( int Channel = 0; Channel < ActiveChannels; Channel++ )
+    {
+        WritePort( IOPorts::SPU_SelectedChannel, Channel );
+        WritePort( IOPorts::SPU_ChannelAssignedSound, -1 );
+        WritePort( IOPorts::SPU_ChannelSpeed, 1.0f + 0.05f * Channel );
+        WritePort( IOPorts::SPU_Command, (int32_t)IOPortValues::SPUCommand_PlaySelectedChannel );
+        
+        // playing takes the loop setting from the
+        // sound, so it has to be overriden after
+        WritePort( IOPorts::SPU_ChannelLoopEnabled, 1 );
+    }
+}
+
+static void PrepareSPU1()  { PrepareSPUChannels( 1 ); }
+static void PrepareSPU4()  { PrepareSPUChannels( 4 ); }
+static void PrepareSPU16() { PrepareSPUChannels( Constants::SPUSoundChannels ); }
+
+// -----------------------------------------------------------------------------
+
+// each operation mixes the output for a whole frame
+static void RunSPUMix( int Operations )
+{
+    for( int i = 0; i < Operations; i++ )
+      Console.SPU.UpdateOutputBuffer();
+    
+    ResultSink += Console.SPU.OutputBuffer.Samples[ 0 ].LeftSample;
+}
+
+// -----------------------------------------------------------------------------
+
+// draw a 64x64 region of the BIOS texture with
+// its hotspot centered, from the screen center
+static void PrepareGPU()
+{
+    WritePort( IOPorts::GPU_SelectedTexture, -1 );
+    WritePort( IOPorts::GPU_SelectedRegion, 0 );
+    WritePort( IOPorts::GPU_RegionMinX, 0 );
+    WritePort( IOPorts::GPU_RegionMinY, 0 );
+    WritePort( IOPorts::GPU_RegionMaxX, 63 );
+    WritePort( IOPorts::GPU_RegionMaxY, 63 );
+    WritePort( IOPorts::GPU_RegionHotspotX, 32 );
+    WritePort( IOPorts::GPU_RegionHotspotY, 32 );
+    WritePort( IOPorts::GPU_DrawingPointX, Constants::ScreenWidth / 2 );
+    WritePort( IOPorts::GPU_DrawingPointY, Constants::ScreenHeight / 2 );
+    WritePort( IOPorts::GPU_DrawingScaleX, 1.5f );
+    WritePort( IOPorts::GPU_DrawingScaleY, 0.75f );
+}
+
+// -----------------------------------------------------------------------------
+
+// capacity is refilled for each operation, so no draw is
+// rejected; the angle changes to avoid any fixed results
+static void RunGPUDrawRegion( int Operations )
+{
+    V32GPU& GPU = Console.GPU;
+    
+    for( int i = 0; i < Operations; i++ )
+    {
+        GPU.RemainingPixels = Constants::GPUPixelCapacityPerFrame;
+        GPU.DrawingAngle = 0.001f * (i & 1023);
+        GPU.DrawRegion( true, true );
+    }
+    
+    ResultSink += GPU.RemainingPixels;
+}
+
+// -----------------------------------------------------------------------------
+
+// addresses are scattered over RAM with a
+// large odd stride, so that all pages are used
+static void RunMemoryBusRead( int Operations )
+{
+    V32Word Word;
+    int32_t Sum = 0;
+    
+    for( int i = 0; i < Operations; i++ )
+    {
+        int32_t Address = (i * 4099) & (Constants::RAMSize - 1);
+        Console.MemoryBus.ReadAddress( Constants::RAMFirstAddress + Address, Word );
+        Sum += Word.AsInteger;
+    }
+    
+    ResultSink += Sum;
+}
+
+// -----------------------------------------------------------------------------
+
+static void RunMemoryBusWrite( int Operations )
+{
+    V32Word Word;
+    
+    for( int i = 0; i < Operations; i++ )
+    {
+        int32_t Address = (i * 4099) & (Constants::RAMSize - 1);
+        Word.AsInteger = i;
+        Console.MemoryBus.WriteAddress( Constants::RAMFirstAddress + Address, Word );
+    }
+}
+
+// -----------------------------------------------------------------------------
+
+// reads from BIOS also go through the bus, but
+// to a different device than the previous ones
+static void RunMemoryBusReadBios( int Operations )
+{
+    V32Word Word;
+    int32_t Sum = 0;
+    
+    for( int i = 0; i < Operations; i++ )
+    {
+        Console.MemoryBus.ReadAddress( Constants::BiosProgramROMFirstAddress + (i & 255), Word );
+        Sum += Word.AsInteger;
+    }
+    
+    ResultSink += Sum;
+}
+
+// -----------------------------------------------------------------------------
+
+// full states are large, so a single one is reused
+static unique_ptr< ConsoleState > StateBuffer;
+
+static void RunSaveState( int Operations )
+{
+    for( int i = 0; i < Operations; i++ )
+      SaveState( Console, StateBuffer.get() );
+    
+    ResultSink += StateBuffer->CPU.Registers[ 0 ].AsInteger;
+}
+
+// -----------------------------------------------------------------------------
+
+static void RunLoadState( int Operations )
+{
+    for( int i = 0; i < Operations; i++ )
+      if( !LoadState( Console, StateBuffer.get() ) )
+        throw runtime_error( "state could not be loaded" );
+}
+
+// -----------------------------------------------------------------------------
+
+// keep some buttons pressed, so that
+// both count directions are measured
+static void PrepareGamepads()
+{
+    for( int Gamepad = 0; Gamepad < Constants::GamepadPorts; Gamepad++ )
+    {
+        Console.SetGamepadConnection( Gamepad, true );
+        Console.SetGamepadControl( Gamepad, GamepadControls::ButtonA, true );
+        Console.SetGamepadControl( Gamepad, GamepadControls::Left, true );
+    }
+}
+
+// -----------------------------------------------------------------------------
+
+static void RunGamepadChangeFrame( int Operations )
+{
+    for( int i = 0; i < Operations; i++ )
+      Console.GamepadController.ChangeFrame();
+    
+    ResultSink += Console.GamepadController.ProvidedGamepadStates[ 0 ].ButtonA;
+}
+
+
+// =============================================================================
+//      MICROBENCHMARK LIST
+// =============================================================================
+
+
+// bytes for each operation are the data the kernel
+// produces or transfers, to report it as throughput
+typedef struct
+{
+    const char* Name;
+    double BytesPerOperation;
+    void (*Prepare)();
+    void (*Run)( int Operations );
+}
+Microbenchmark;
+
+// -----------------------------------------------------------------------------
+
+const Microbenchmark Microbenchmarks[] =
+{
+    { "SPUMix1",            Constants::SPUSamplesPerFrame * sizeof(SPUSample),    PrepareSPU1,     RunSPUMix             },
+    { "SPUMix4",            Constants::SPUSamplesPerFrame * sizeof(SPUSample),    PrepareSPU4,     RunSPUMix             },
+    { "SPUMix16",           Constants::SPUSamplesPerFrame * sizeof(SPUSample),    PrepareSPU16,    RunSPUMix             },
+    { "GPUDrawRegion",      sizeof(GPUQuad),                                      PrepareGPU,      RunGPUDrawRegion      },
+    { "MemoryBusRead",      sizeof(V32Word),                                      nullptr,         RunMemoryBusRead      },
+    { "MemoryBusWrite",     sizeof(V32Word),                                      nullptr,         RunMemoryBusWrite     },
+    { "MemoryBusReadBios",  sizeof(V32Word),                                      nullptr,         RunMemoryBusReadBios  },
+    { "SaveState",          sizeof(ConsoleState),                                 nullptr,         RunSaveState          },
+    { "LoadState",          sizeof(ConsoleState),                                 nullptr,         RunLoadState          },
+    { "GamepadChangeFrame", 2 * Constants::GamepadPorts * sizeof(GamepadState),   PrepareGamepads, RunGamepadChangeFrame }
+};
+
+
+// =============================================================================
+//      RUNNING MICROBENCHMARKS
+// =============================================================================
+
+
+// operations run in batches that grow until a batch
+// takes long enough to be timed with good precision
+double MeasureNanosecondsPerOperation( const Microbenchmark& Benchmark, double MinimumSeconds )
+{
+    int Operations = 1;
+    
+    while( true )
+    {
+        auto Start = chrono::steady_clock::now();
+        Benchmark.Run( Operations );
+        auto End = chrono::steady_clock::now();
+        
+        double Seconds = chrono::duration< double >( End - Start ).count();
+        
+        if( Seconds >= MinimumSeconds || Operations >= (1 << 30) )
+          return Seconds * 1e9 / Operations;
+        
+        // aim a bit above the minimum time to
+        // avoid falling just short of it again
+        if( Seconds <= 0 )
+          Operations *= 16;
+        else
+          Operations = (int)min( 1.2 * Operations * MinimumSeconds / Seconds, (double)(1 << 30) );
+        
+        Operations = max( Operations, 2 );
+    }
+}
+
+// -----------------------------------------------------------------------------
+
+string FormatThroughput( double BytesPerSecond )
+{
+    const char* Units[] = { "B/s", "KB/s", "MB/s", "GB/s" };
+    int Unit = 0;
+    
+    while( BytesPerSecond >= 1024 && Unit < 3 )
+    {
+        BytesPerSecond /= 1024;
+        Unit++;
+    }
+    
+    char Text[ 32 ];
+    snprintf( Text, sizeof(Text), "%.2f %s", BytesPerSecond, Units[ Unit ] );
+    return Text;
+}
+
+
+// =============================================================================
+//      MAIN FUNCTION
+// =============================================================================
+
+
+void PrintUsage()
+{
+    printf( "USAGE: vircon32_microbenchmark [options] [microbenchmark names]\n" );
+    printf( "Options:\n" );
+    printf( "  --time <ms>    Minimum measured time for each one (default: 500)\n" );
+    printf( "  --list         List available microbenchmarks\n" );
+    printf( "With no names, all microbenchmarks are run.\n" );
+}
+
+// -----------------------------------------------------------------------------
+
+int main( int NumberOfArguments, char* Arguments[] )
+{
+    double MinimumSeconds = 0.5;
+    vector< string > SelectedNames;
+    
+    // process command line arguments
+    for( int i = 1; i < NumberOfArguments; i++ )
+    {
+        string Argument = Arguments[ i ];
+        
+        if( Argument == "--time" && i + 1 < NumberOfArguments )
+          MinimumSeconds = max( 1, atoi( Arguments[ ++i ] ) ) / 1000.0;
+        
+        else if( Argument == "--list" )
+        {
+            for( const Microbenchmark& Benchmark: Microbenchmarks )
+              printf( "%s\n", Benchmark.Name );
+            
+            return 0;
+        }
+        
+        else if( Argument[ 0 ] == '-' )
+        {
+            PrintUsage();
+            return 1;
+        }
+        
+        else SelectedNames.push_back( Argument );
+    }
+    
+    // the console needs all callbacks
+    Console.SetCallbacks( &KernelCallbacks );
+    
+    // kernels run with the standard BIOS loaded
+    try
+    {
+        stringstream BiosData;
+        BiosData.write( (const char*)embedded_StandardBios, sizeof( embedded_StandardBios ) );
+        Console.LoadBiosData( BiosData );
+        Console.SetPower( true );
+        
+        // save a first state to have one to load
+        StateBuffer.reset( new ConsoleState() );
+        SaveState( Console, StateBuffer.get() );
+    }
+    
+    catch( exception& e )
+    {
+        printf( "Cannot start the console: %s\n", e.what() );
+        return 1;
+    }
+    
+    printf( "%-20s %12s %14s\n", "Microbenchmark", "ns/op", "throughput" );
+    bool AllPassed = true;
+    bool AnyRun = false;
+    
+    for( const Microbenchmark& Benchmark: Microbenchmarks )
+    {
+        // when names are given, run only those
+        if( !SelectedNames.empty() )
+        {
+            bool Selected = false;
+            
+            for( const string& Name: SelectedNames )
+              if( Name == Benchmark.Name )
+                Selected = true;
+            
+            if( !Selected )
+              continue;
+        }
+        
+        AnyRun = true;
+        
+        try
+        {
+            if( Benchmark.Prepare )
+              Benchmark.Prepare();
+            
+            double Nanoseconds = MeasureNanosecondsPerOperation( Benchmark, MinimumSeconds );
+            double BytesPerSecond = Benchmark.BytesPerOperation * 1e9 / Nanoseconds;
+            printf( "%-20s %12.2f %14s\n", Benchmark.Name, Nanoseconds, FormatThroughput( BytesPerSecond ).c_str() );
+        }
+        
+        catch( exception& e )
+        {
+            printf( "%-20s FAILED: %s\n", Benchmark.Name, e.what() );
+            AllPassed = false;
+        }
+    }
+    
+    if( !AnyRun )
+    {
+        printf( "No microbenchmarks were selected\n" );
+        return 1;
+    }
+    
+    return (AllPassed? 0 : 1);
+}
@@ -0,0 +1,233 @@
+#!/usr/bin/env python3
+# -----------------------------------------------------------------------------
+#   Builds the benchmark BIOS ROMs from their assembly sources. Only the
+#   subset of the Vircon32 assembly language used by the benchmarks is
+#   supported. Each ROM gets the same 64x64 texture and looping sound.
+#   Usage: python3 BuildRoms.py (from any folder)
+# -----------------------------------------------------------------------------
+
+import math
+import os
+import re
+import struct
+import sys
+
+OPCODES = [
+    "hlt", "wait", "jmp", "call", "ret", "jt", "jf",
+    "ieq", "ine", "igt", "ige", "ilt", "ile",
+    "feq", "fne", "fgt", "fge", "flt", "fle",
+    "mov", "lea", "push", "pop", "in", "out",
+    "movs", "sets", "cmps",
+    "cif", "cfi", "cib", "cfb",
+    "not", "and", "or", "xor", "bnot", "shl",
+    "iadd", "isub", "imul", "idiv", "imod", "isgn", "imin", "imax", "iabs",
+    "fadd", "fsub", "fmul", "fdiv", "fmod", "fsgn", "fmin", "fmax", "fabs",
+    "flr", "ceil", "round", "sin", "acos", "atan2", "log", "pow"
+]
+
+REGISTER_ALIASES = { "cr": 11, "sr": 12, "dr": 13, "bp": 14, "sp": 15 }
+
+PORTS = {}
+PORT_GROUPS = [
+    (0x000, ["TIM_CurrentDate", "TIM_CurrentTime", "TIM_FrameCounter", "TIM_CycleCounter"]),
+    (0x100, ["RNG_CurrentValue"]),
+    (0x200, ["GPU_Command", "GPU_RemainingPixels", "GPU_ClearColor", "GPU_MultiplyColor",
+             "GPU_ActiveBlending", "GPU_SelectedTexture", "GPU_SelectedRegion",
+             "GPU_DrawingPointX", "GPU_DrawingPointY", "GPU_DrawingScaleX", "GPU_DrawingScaleY",
+             "GPU_DrawingAngle", "GPU_RegionMinX", "GPU_RegionMinY", "GPU_RegionMaxX",
+             "GPU_RegionMaxY", "GPU_RegionHotspotX", "GPU_RegionHotspotY"]),
+    (0x300, ["SPU_Command", "SPU_GlobalVolume", "SPU_SelectedSound", "SPU_SelectedChannel",
+             "SPU_SoundLength", "SPU_SoundPlayWithLoop", "SPU_SoundLoopStart", "SPU_SoundLoopEnd",
+             "SPU_ChannelState", "SPU_ChannelAssignedSound", "SPU_ChannelVolume",
+             "SPU_ChannelSpeed", "SPU_ChannelLoopEnabled", "SPU_ChannelPosition"]),
+    (0x400, ["INP_SelectedGamepad", "INP_GamepadConnected", "INP_GamepadLeft",
+             "INP_GamepadRight", "INP_GamepadUp", "INP_GamepadDown", "INP_GamepadButtonStart",
+             "INP_GamepadButtonA", "INP_GamepadButtonB", "INP_GamepadButtonX",
+             "INP_GamepadButtonY", "INP_GamepadButtonL", "INP_GamepadButtonR"]),
+    (0x500, ["CAR_Connected", "CAR_ProgramROMSize", "CAR_NumberOfTextures", "CAR_NumberOfSounds"]),
+    (0x600, ["MEM_Connected"])
+]
+
+for first, names in PORT_GROUPS:
+    for i, name in enumerate(names):
+        PORTS[name.lower()] = first + i
+
+PORT_VALUES = {}
+VALUE_GROUPS = [
+    (0x10, ["GPUCommand_ClearScreen", "GPUCommand_DrawRegion", "GPUCommand_DrawRegionZoomed",
+            "GPUCommand_DrawRegionRotated", "GPUCommand_DrawRegionRotozoomed"]),
+    (0x20, ["GPUBlendingMode_Alpha", "GPUBlendingMode_Add", "GPUBlendingMode_Subtract"]),
+    (0x30, ["SPUCommand_PlaySelectedChannel", "SPUCommand_PauseSelectedChannel",
+            "SPUCommand_StopSelectedChannel", "SPUCommand_PauseAllChannels",
+            "SPUCommand_ResumeAllChannels", "SPUCommand_StopAllChannels"])
+]
+
+for first, names in VALUE_GROUPS:
+    for i, name in enumerate(names):
+        PORT_VALUES[name.lower()] = first + i
+
+BIOS_FIRST_ADDRESS = 0x10000000
+
+# -----------------------------------------------------------------------------
+
+def parse_register(text):
+    text = text.lower()
+    if text in REGISTER_ALIASES:
+        return REGISTER_ALIASES[text]
+    if re.fullmatch(r"r([0-9]|1[0-5])", text):
+        return int(text[1:])
+    return None
+
+def parse_value(text, labels):
+    lower = text.lower()
+    if lower in labels:
+        return labels[lower]
+    if lower in PORT_VALUES:
+        return PORT_VALUES[lower]
+    if re.fullmatch(r"-?[0-9]+\.[0-9]+", text):
+        return struct.unpack("<I", struct.pack("<f", float(text)))[0]
+    if re.fullmatch(r"-?(0x[0-9a-fA-F]+|[0-9]+)", text):
+        return int(text, 0) & 0xFFFFFFFF
+    raise ValueError("invalid operand: " + text)
+
+def parse_memory(text):
+    match = re.fullmatch(r"\[\s*(\w+)\s*(?:([+-])\s*(\w+))?\s*\]", text)
+    if not match:
+        return None
+    register = parse_register(match.group(1))
+    if register is None:
+        raise ValueError("invalid address: " + text)
+    offset = None
+    if match.group(2):
+        offset = int(match.group(3), 0) * (-1 if match.group(2) == "-" else 1)
+    return register, offset
+
+def encode(opcode, immediate=None, register1=0, register2=0, mode=0, port=0):
+    word = (OPCODES.index(opcode) << 26) | ((immediate is not None) << 25)
+    word |= (register1 << 21) | (register2 << 17) | (mode << 14) | port
+    return [word] if immediate is None else [word, immediate & 0xFFFFFFFF]
+
+def assemble_instruction(mnemonic, operands, labels):
+    if mnemonic in ("hlt", "wait", "ret", "movs", "sets"):
+        return encode(mnemonic)
+
+    if mnemonic in ("jmp", "call"):
+        register = parse_register(operands[0])
+        if register is not None:
+            return encode(mnemonic, register1=register)
+        return encode(mnemonic, parse_value(operands[0], labels))
+
+    if mnemonic in ("push", "pop", "not", "bnot", "isgn", "iabs", "fsgn", "fabs", "cif", "cfi",
+                    "cib", "cfb", "flr", "ceil", "round", "sin", "acos", "log", "cmps"):
+        return encode(mnemonic, register1=parse_register(operands[0]))
+
+    if mnemonic == "in":
+        return encode(mnemonic, register1=parse_register(operands[0]), port=PORTS[operands[1].lower()])
+
+    if mnemonic == "out":
+        port = PORTS[operands[0].lower()]
+        register = parse_register(operands[1])
+        if register is not None:
+            return encode(mnemonic, register2=register, port=port)
+        return encode(mnemonic, parse_value(operands[1], labels), port=port)
+
+    if mnemonic == "mov":
+        destination = parse_memory(operands[0])
+        source = parse_memory(operands[1])
+        if destination is not None:
+            register, offset = destination
+            if offset is None:
+                return encode(mnemonic, register1=register, register2=parse_register(operands[1]), mode=6)
+            return encode(mnemonic, offset, register, parse_register(operands[1]), mode=7)
+        register1 = parse_register(operands[0])
+        if source is not None:
+            register, offset = source
+            if offset is None:
+                return encode(mnemonic, register1=register1, register2=register, mode=3)
+            return encode(mnemonic, offset, register1, register, mode=4)
+        register2 = parse_register(operands[1])
+        if register2 is not None:
+            return encode(mnemonic, register1=register1, register2=register2, mode=1)
+        return encode(mnemonic, parse_value(operands[1], labels), register1, mode=0)
+
+    # the rest take a register and then a register or a value
+    register1 = parse_register(operands[0])
+    register2 = parse_register(operands[1])
+    if register2 is not None:
+        return encode(mnemonic, register1=register1, register2=register2)
+    return encode(mnemonic, parse_value(operands[1], labels), register1)
+
+def assemble(path):
+    lines = []
+    for line in open(path):
+        line = line.split(";")[0].strip()
+        if line:
+            lines.append(line)
+
+    # first pass places labels, second one encodes
+    labels = {}
+    for final_pass in (False, True):
+        words = []
+        for line in lines:
+            if line.endswith(":"):
+                labels[line[:-1].lower()] = BIOS_FIRST_ADDRESS + len(words)
+                continue
+            parts = line.split(None, 1)
+            mnemonic = parts[0].lower()
+            operands = [o.strip() for o in parts[1].split(",")] if len(parts) > 1 else []
+            try:
+                words += assemble_instruction(mnemonic, operands, labels if final_pass else {})
+            except ValueError:
+                if final_pass:
+                    raise
+                words += [0, 0]
+    return words
+
+# -----------------------------------------------------------------------------
+
+def make_texture():
+    # checkerboard with a color gradient and transparent corners
+    pixels = bytearray()
+    for y in range(64):
+        for x in range(64):
+            corner = (x < 8 or x >= 56) and (y < 8 or y >= 56)
+            light = ((x // 8) + (y // 8)) % 2
+            pixels += bytes([x * 4, y * 4, 255 if light else 96, 0 if corner else 255])
+    return struct.pack("<8sII", b"V32-VTEX", 64, 64) + pixels
+
+def make_sound():
+    # 1/10 second of a 440 Hz tone, with slightly different channels
+    samples = bytearray()
+    for i in range(4410):
+        left = int(8000 * math.sin(2 * math.pi * 440 * i / 44100))
+        right = int(8000 * math.sin(2 * math.pi * 440 * i / 44100 + 0.5))
+        samples += struct.pack("<hh", left, right)
+    return struct.pack("<8sI", b"V32-VSND", 4410) + samples
+
+def make_bios(title, words):
+    program = struct.pack("<8sI", b"V32-VBIN", len(words)) + struct.pack("<%dI" % len(words), *words)
+    texture = make_texture()
+    sound = make_sound()
+
+    program_start = 128
+    texture_start = program_start + len(program)
+    sound_start = texture_start + len(texture)
+
+    header = struct.pack("<8sII64sIIII", b"V32-BIOS", 1, 0, title.encode(), 1, 0, 1, 1)
+    header += struct.pack("<6I", program_start, len(program), texture_start, len(texture), sound_start, len(sound))
+    header += bytes(8)
+    return header + program + texture + sound
+
+# -----------------------------------------------------------------------------
+
+if __name__ == "__main__":
+    folder = os.path.dirname(os.path.abspath(__file__))
+
+    for file_name in sorted(os.listdir(folder)):
+        if not file_name.endswith(".asm"):
+            continue
+        name = file_name[:-4]
+        words = assemble(os.path.join(folder, file_name))
+        with open(os.path.join(folder, name + ".v32"), "wb") as output:
+            output.write(make_bios("Benchmark: " + name, words))
+        print("%s: %d words" % (name, len(words)))
@@ -0,0 +1,27 @@
+; -----------------------------------------------------
+;   VIRCON32 BENCHMARK: BULK MEMORY
+; -----------------------------------------------------
+; Fills a block of 64K words of RAM with SETS and then
+; copies it to another block with MOVS, over and over.
+; Each of these instructions moves 1 word per cycle.
+
+; hardware errors jump here: stop the CPU
+; so that the benchmark runner reports them
+  hlt
+  hlt
+  hlt
+  hlt
+
+_start:
+  ; fill the first block
+  mov CR, 65536
+  mov DR, 0x10000
+  mov SR, 0x12345678
+  sets
+  
+  ; copy it to the second block
+  mov CR, 65536
+  mov SR, 0x10000
+  mov DR, 0x20000
+  movs
+  jmp _start
@@ -0,0 +1,59 @@
+; -----------------------------------------------------
+;   VIRCON32 BENCHMARK: FLOAT MATH
+; -----------------------------------------------------
+; Runs float arithmetic, conversions and transcendental
+; functions in a loop that never waits for the next
+; frame. Operands are kept in range to avoid errors.
+
+; hardware errors jump here: stop the CPU
+; so that the benchmark runner reports them
+  hlt
+  hlt
+  hlt
+  hlt
+
+_start:
+  mov R0, 0.0
+  mov R1, 1.5
+
+_loop:
+  ; advance the angle, wrapping it at 2*pi
+  fadd R0, 0.001
+  mov R9, R0
+  fgt R9, 6.2831853
+  jf R9, _no_wrap
+  mov R0, 0.0
+
+_no_wrap:
+  ; basic arithmetic
+  mov R2, R0
+  sin R2
+  mov R3, R0
+  fmul R3, R1
+  fdiv R3, 3.0
+  fsub R3, R2
+  
+  ; logarithm and power of values >= 1
+  mov R4, R2
+  fabs R4
+  fadd R4, 1.0
+  log R4
+  mov R5, R4
+  pow R5, R1
+  
+  ; inverse trigonometry with valid operands
+  mov R6, R2
+  fmul R6, 0.5
+  acos R6
+  mov R7, R3
+  atan2 R7, R1
+  fadd R7, R6
+  
+  ; rounding and conversions
+  mov R8, R7
+  fmul R8, 100.0
+  round R8
+  cfi R8
+  cif R8
+  flr R5
+  jmp _loop
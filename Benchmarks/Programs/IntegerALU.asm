@@ -0,0 +1,46 @@
+; -----------------------------------------------------
+;   VIRCON32 BENCHMARK: INTEGER ALU
+; -----------------------------------------------------
+; Runs integer arithmetic and bitwise operations in a
+; loop that never waits for the next frame, so every
+; frame uses all available CPU cycles.
+
+; hardware errors jump here: stop the CPU
+; so that the benchmark runner reports them
+  hlt
+  hlt
+  hlt
+  hlt
+
+_start:
+  mov R0, 1
+  mov R1, 12345
+  mov R2, 0
+
+_loop:
+  ; linear congruential generator
+  imul R0, 1103515245
+  iadd R0, R1
+  
+  ; bit manipulation on the high bits
+  mov R3, R0
+  shl R3, -16
+  xor R2, R3
+  and R3, 0xFF
+  iadd R3, 1
+  
+  ; division and modulus by a non-zero value
+  mov R4, R0
+  imod R4, R3
+  isub R2, R4
+  mov R5, R0
+  idiv R5, R3
+  or R2, R5
+  
+  ; comparisons and min/max
+  mov R6, R2
+  ilt R6, R1
+  iadd R1, R6
+  imax R1, 1000
+  imin R1, 1000000
+  jmp _loop
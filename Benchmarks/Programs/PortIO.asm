@@ -0,0 +1,38 @@
+; -----------------------------------------------------
+;   VIRCON32 BENCHMARK: PORT I/O
+; -----------------------------------------------------
+; Reads and writes ports of all devices in a loop that
+; never waits for the next frame. Drawing commands are
+; not sent, so the GPU does no rendering work.
+
+; hardware errors jump here: stop the CPU
+; so that the benchmark runner reports them
+  hlt
+  hlt
+  hlt
+  hlt
+
+_start:
+  ; timer and random number generator
+  in R0, TIM_CycleCounter
+  in R1, RNG_CurrentValue
+  in R2, TIM_FrameCounter
+  
+  ; GPU registers
+  out GPU_DrawingPointX, R2
+  in R3, GPU_DrawingPointX
+  out GPU_MultiplyColor, R1
+  in R4, GPU_RemainingPixels
+  
+  ; SPU registers
+  out SPU_SelectedChannel, 3
+  in R5, SPU_ChannelState
+  out SPU_ChannelVolume, 0.5
+  
+  ; gamepads, cartridge and memory card
+  out INP_SelectedGamepad, 0
+  in R6, INP_GamepadConnected
+  in R7, INP_GamepadButtonA
+  in R8, CAR_Connected
+  in R9, MEM_Connected
+  jmp _start
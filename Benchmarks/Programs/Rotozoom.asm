@@ -0,0 +1,57 @@
+; -----------------------------------------------------
+;   VIRCON32 BENCHMARK: ROTOZOOM
+; -----------------------------------------------------
+; Each frame clears the screen and then draws the BIOS
+; texture rotated and zoomed until the GPU runs out of
+; pixel capacity for the frame, and then waits.
+
+; hardware errors jump here: stop the CPU
+; so that the benchmark runner reports them
+  hlt
+  hlt
+  hlt
+  hlt
+
+_start:
+  ; define region 0 as the whole 64x64 texture
+  out GPU_SelectedTexture, -1
+  out GPU_SelectedRegion, 0
+  out GPU_RegionMinX, 0
+  out GPU_RegionMinY, 0
+  out GPU_RegionMaxX, 63
+  out GPU_RegionMaxY, 63
+  out GPU_RegionHotspotX, 32
+  out GPU_RegionHotspotY, 32
+  
+  ; draw at 2x size
+  out GPU_DrawingScaleX, 2.0
+  out GPU_DrawingScaleY, 2.0
+  mov R0, 0.0
+
+_frame:
+  out GPU_ClearColor, 0xFF402010
+  out GPU_Command, GPUCommand_ClearScreen
+  
+  ; all quads share the angle for this frame
+  fadd R0, 0.01
+  out GPU_DrawingAngle, R0
+  mov R1, 0
+
+_draw:
+  ; spread quads over the screen
+  mov R2, R1
+  imod R2, 640
+  out GPU_DrawingPointX, R2
+  mov R3, R1
+  imod R3, 360
+  out GPU_DrawingPointY, R3
+  out GPU_Command, GPUCommand_DrawRegionRotozoomed
+  iadd R1, 37
+  
+  ; continue while there is capacity left
+  in R4, GPU_RemainingPixels
+  igt R4, 0
+  jt R4, _draw
+  
+  wait
+  jmp _frame
@@ -0,0 +1,44 @@
+; -----------------------------------------------------
+;   VIRCON32 BENCHMARK: SPU CHANNELS
+; -----------------------------------------------------
+; Plays the BIOS sound in a loop on all 16 channels,
+; each one at a different speed, and then just waits.
+; This only measures the cost of mixing all channels.
+
+; hardware errors jump here: stop the CPU
+; so that the benchmark runner reports them
+  hlt
+  hlt
+  hlt
+  hlt
+
+_start:
+  ; the BIOS sound loops over all of its length
+  out SPU_SelectedSound, -1
+  out SPU_SoundPlayWithLoop, 1
+  out SPU_GlobalVolume, 1.0
+  mov R0, 0
+
+_channel:
+  out SPU_SelectedChannel, R0
+  out SPU_ChannelAssignedSound, -1
+  out SPU_ChannelVolume, 0.5
+  out SPU_ChannelLoopEnabled, 1
+  
+  ; speed goes from 0.5 to 2.0
+  mov R1, R0
+  cif R1
+  fmul R1, 0.1
+  fadd R1, 0.5
+  out SPU_ChannelSpeed, R1
+  out SPU_Command, SPUCommand_PlaySelectedChannel
+  
+  ; continue with the next channel
+  iadd R0, 1
+  mov R1, R0
+  ilt R1, 16
+  jt R1, _channel
+
+_idle:
+  wait
+  jmp _idle
@@ -0,0 +1,40 @@
+; -----------------------------------------------------
+;   VIRCON32 BENCHMARK: STACK AND CALLS
+; -----------------------------------------------------
+; Runs a recursive function 48 levels deep, over and
+; over. Each level creates a stack frame with local
+; variables, the same way compiled C code does.
+
+; hardware errors jump here: stop the CPU
+; so that the benchmark runner reports them
+  hlt
+  hlt
+  hlt
+  hlt
+
+_start:
+  mov R0, 48
+  call _recurse
+  jmp _start
+
+; receives the remaining depth in R0
+_recurse:
+  push BP
+  mov BP, SP
+  isub SP, 2
+  mov [BP-1], R0
+  
+  ; end recursion at depth 0
+  mov R1, R0
+  ile R1, 0
+  jt R1, _recurse_end
+  
+  isub R0, 1
+  call _recurse
+  mov R0, [BP-1]
+  mov [BP-2], R0
+
+_recurse_end:
+  mov SP, BP
+  pop BP
+  ret
@@ -0,0 +1,378 @@
+// *****************************************************************************
+    // include Vircon32 headers
+    #include "ConsoleLogic/V32Console.hpp"
+    
+    // include emulator headers
+    #include "Cheats.hpp"
+    
+    // include C/C++ headers
+    #include <cstdlib>          // [ ANSI C ] Standard library
+    #include <cstring>          // [ ANSI C ] Strings
+    
+    // include SIMD headers for the available instruction set
+    #if defined(__SSE2__) || defined(_M_X64)
+      #include <emmintrin.h>    // [ x86 ] SSE2 intrinsics
+      #define RAM_SEARCH_SSE2
+    #elif defined(__ARM_NEON) && defined(__aarch64__)
+      #include <arm_neon.h>     // [ ARM ] NEON intrinsics
+      #define RAM_SEARCH_NEON
+    #endif
+    
+    // declare used namespaces
+    using namespace std;
+    using namespace V32;
+// *****************************************************************************
+
+
+// =============================================================================
+//      CHEAT ENGINE: INSTANCE HANDLING
+// =============================================================================
+
+
+CheatEngine::CheatEngine( V32Console& CheatConsole ):
+    Console( CheatConsole )
+{
+    // no cheats are enabled initially
+}
+
+
+// =============================================================================
+//      CHEAT ENGINE: CODE HANDLING
+// =============================================================================
+
+
+// returns false if any of the codes is not valid
+bool CheatEngine::ParseCodes( const string& Text, vector< CheatCode >& Codes )
+{
+    Codes.clear();
+    const char* Position = Text.c_str();
+    
+    while( *Position )
+    {
+        // read the address
+        char* End;
+        unsigned long Address = strtoul( Position, &End, 16 );
+        
+        if( End == Position || Address >= (unsigned long)Constants::RAMSize )
+          return false;
+        
+        // addresses and values can be separated
+        // with a colon, an equal sign or spaces
+        Position = End;
+        
+        while( *Position == ' ' || *Position == ':' || *Position == '=' )
+          Position++;
+        
+        // read the value
+        unsigned long Value = strtoul( Position, &End, 16 );
+        
+        if( End == Position )
+          return false;
+        
+        CheatCode Code;
+        Code.Address = Address;
+        Code.Value.AsInteger = (int32_t)Value;
+        Codes.push_back( Code );
+        
+        // continue with the next code, if any
+        Position = End;
+        
+        while( *Position == ' ' || *Position == '+' )
+          Position++;
+    }
+    
+    return !Codes.empty();
+}
+
+// -----------------------------------------------------------------------------
+
+void CheatEngine::UpdateActiveCodes()
+{
+    ActiveCodes.clear();
+    
+    for( auto& Cheat: EnabledCheats )
+      ActiveCodes.insert( ActiveCodes.end(), Cheat.second.begin(), Cheat.second.end() );
+}
+
+
+// =============================================================================
+//      CHEAT ENGINE: CONFIGURATION
+// =============================================================================
+
+
+void CheatEngine::Clear()
+{
+    EnabledCheats.clear();
+    ActiveCodes.clear();
+}
+
+// -----------------------------------------------------------------------------
+
+bool CheatEngine::SetCheat( unsigned Index, bool Enabled, const string& Text )
+{
+    if( !Enabled )
+    {
+        EnabledCheats.erase( Index );
+        UpdateActiveCodes();
+        return true;
+    }
+    
+    vector< CheatCode > Codes;
+    
+    if( !ParseCodes( Text, Codes ) )
+    {
+        Console.Callbacks->LogLine( "ERROR: Invalid cheat code: \"" + Text + "\"" );
+        return false;
+    }
+    
+    EnabledCheats[ Index ] = Codes;
+    UpdateActiveCodes();
+    return true;
+}
+
+
+// =============================================================================
+//      CHEAT ENGINE: OPERATION
+// =============================================================================
+
+
+// called before each frame; words are only written when
+// they differ, so that their RAM pages are not marked as
+// dirty and written every frame without need
+void CheatEngine::ApplyCheats()
+{
+    V32RAM& RAM = Console.RAM;
+    
+    for( const CheatCode& Code: ActiveCodes )
+      if( RAM.Memory[ Code.Address ].AsInteger != Code.Value.AsInteger )
+        RAM.WriteAddress( Code.Address, Code.Value );
+}
+
+
+// =============================================================================
+//      RAM SEARCH: COMPARISON KERNELS
+// =============================================================================
+
+
+// comparisons are reduced to either A == B or A > B
+uint64_t RAMSearch::CompareBlockScalar( const int32_t* A, const int32_t* B, bool Greater )
+{
+    uint64_t Result = 0;
+    
+    for( int i = 0; i < 64; i++ )
+    {
+        bool Matches = Greater? (A[ i ] > B[ i ]) : (A[ i ] == B[ i ]);
+        Result |= (uint64_t)Matches << i;
+    }
+    
+    return Result;
+}
+
+// -----------------------------------------------------------------------------
+
+// uses SIMD when available, with the same results
+uint64_t RAMSearch::CompareBlock( const int32_t* A, const int32_t* B, bool Greater )
+{
+    #if defined(RAM_SEARCH_SSE2)
+    
+      uint64_t Result = 0;
+      
+      for( int i = 0; i < 64; i += 4 )
+      {
+          __m128i WordsA = _mm_loadu_si128( (const __m128i*)(A + i) );
+          __m128i WordsB = _mm_loadu_si128( (const __m128i*)(B + i) );
+          __m128i Matches = Greater? _mm_cmpgt_epi32( WordsA, WordsB ) : _mm_cmpeq_epi32( WordsA, WordsB );
+          Result |= (uint64_t)_mm_movemask_ps( _mm_castsi128_ps( Matches ) ) << i;
+      }
+      
+      return Result;
+    
+    #elif defined(RAM_SEARCH_NEON)
+    
+      uint64_t Result = 0;
+      const uint32_t BitValues[ 4 ] = { 1, 2, 4, 8 };
+      uint32x4_t Bits = vld1q_u32( BitValues );
+      
+      for( int i = 0; i < 64; i += 4 )
+      {
+          int32x4_t WordsA = vld1q_s32( A + i );
+          int32x4_t WordsB = vld1q_s32( B + i );
+          uint32x4_t Matches = Greater? vcgtq_s32( WordsA, WordsB ) : vceqq_s32( WordsA, WordsB );
+          Result |= (uint64_t)vaddvq_u32( vandq_u32( Matches, Bits ) ) << i;
+      }
+      
+      return Result;
+    
+    #else
+    
+      return CompareBlockScalar( A, B, Greater );
+    
+    #endif
+}
+
+// -----------------------------------------------------------------------------
+
+static uint32_t CountBits( uint64_t Bits )
+{
+    #if defined(__GNUC__)
+      return __builtin_popcountll( Bits );
+    #else
+      uint32_t Count = 0;
+      
+      for( ; Bits; Bits &= Bits - 1 )
+        Count++;
+      
+      return Count;
+    #endif
+}
+
+
+// =============================================================================
+//      RAM SEARCH: SEARCH CONTROL
+// =============================================================================
+
+
+// RAM size is always a whole number of blocks
+static_assert( Constants::RAMSize % 64 == 0, "RAM size must be a multiple of 64 words" );
+
+// -----------------------------------------------------------------------------
+
+RAMSearch::RAMSearch( V32Console& SearchConsole ):
+    Console( SearchConsole )
+{
+    // searches are inactive until started
+}
+
+// -----------------------------------------------------------------------------
+
+void RAMSearch::Start()
+{
+    // initially, all words are candidates
+    PreviousValues = Console.RAM.Memory;
+    Candidates.assign( Constants::RAMSize / 64, ~(uint64_t)0 );
+}
+
+// -----------------------------------------------------------------------------
+
+void RAMSearch::Stop()
+{
+    PreviousValues.clear();
+    PreviousValues.shrink_to_fit();
+    Candidates.clear();
+    Candidates.shrink_to_fit();
+}
+
+// -----------------------------------------------------------------------------
+
+bool RAMSearch::IsActive()
+{
+    return !Candidates.empty();
+}
+
+
+// =============================================================================
+//      RAM SEARCH: SEARCH STEPS
+// =============================================================================
+
+
+uint32_t RAMSearch::Filter( RAMSearchComparisons Comparison, int32_t Value )
+{
+    if( !IsActive() )
+      return 0;
+    
+    const int32_t* Current = (const int32_t*)&Console.RAM.Memory[ 0 ];
+    const int32_t* Previous = (const int32_t*)&PreviousValues[ 0 ];
+    
+    // comparisons against a value use the same
+    // block of repeated values for all blocks
+    int32_t ValueBlock[ 64 ];
+    
+    for( int i = 0; i < 64; i++ )
+      ValueBlock[ i ] = Value;
+    
+    // express the comparison as A == B or A > B,
+    // possibly inverting the result
+    const int32_t* A = Current;
+    const int32_t* B = Previous;
+    size_t StrideB = 64;
+    bool Greater = false;
+    bool Inverted = false;
+    
+    switch( Comparison )
+    {
+        case RAMSearchComparisons::EqualToValue:
+            B = ValueBlock;
+            StrideB = 0;
+            break;
+        
+        case RAMSearchComparisons::Changed:
+            Inverted = true;
+            break;
+        
+        case RAMSearchComparisons::Unchanged:
+            break;
+        
+        case RAMSearchComparisons::Increased:
+            Greater = true;
+            break;
+        
+        case RAMSearchComparisons::Decreased:
+            A = Previous;
+            B = Current;
+            Greater = true;
+            break;
+    }
+    
+    // only compare blocks with remaining candidates
+    uint32_t RemainingCandidates = 0;
+    
+    for( size_t Block = 0; Block < Candidates.size(); Block++ )
+    {
+        if( !Candidates[ Block ] )
+          continue;
+        
+        uint64_t Matches = CompareBlock( A + Block * 64, B + Block * StrideB, Greater );
+        Candidates[ Block ] &= (Inverted? ~Matches : Matches);
+        RemainingCandidates += CountBits( Candidates[ Block ] );
+    }
+    
+    // current values are the reference for the next step
+    memcpy( &PreviousValues[ 0 ], Current, Constants::RAMSize * sizeof(V32Word) );
+    return RemainingCandidates;
+}
+
+// -----------------------------------------------------------------------------
+
+uint32_t RAMSearch::CountCandidates()
+{
+    uint32_t Count = 0;
+    
+    for( uint64_t Bits: Candidates )
+      Count += CountBits( Bits );
+    
+    return Count;
+}
+
+// -----------------------------------------------------------------------------
+
+vector< int32_t > RAMSearch::GetCandidates( uint32_t MaximumResults )
+{
+    vector< int32_t > Addresses;
+    
+    for( size_t Block = 0; Block < Candidates.size(); Block++ )
+      for( uint64_t Bits = Candidates[ Block ]; Bits; Bits &= Bits - 1 )
+      {
+          if( Addresses.size() >= MaximumResults )
+            return Addresses;
+          
+          // find the lowest bit that is still set
+          int Bit = 0;
+          
+          while( !((Bits >> Bit) & 1) )
+            Bit++;
+          
+          Addresses.push_back( Block * 64 + Bit );
+      }
+    
+    return Addresses;
+}
@@ -0,0 +1,128 @@
+// *****************************************************************************
+    // start include guard
+    #ifndef CHEATS_HPP
+    #define CHEATS_HPP
+    
+    // include Vircon32 headers
+    #include "VirconDefinitions/DataStructures.hpp"
+    
+    // include C/C++ headers
+    #include <map>          // [ C++ STL ] Maps
+    #include <string>       // [ C++ STL ] Strings
+    #include <vector>       // [ C++ STL ] Vectors
+    
+    // forward declarations for all needed classes
+    namespace V32{ class V32Console; }
+// *****************************************************************************
+
+
+// =============================================================================
+//      CHEAT ENGINE
+// =============================================================================
+
+
+// a single RAM word that is kept at a fixed value
+typedef struct
+{
+    int32_t Address;
+    V32::V32Word Value;
+}
+CheatCode;
+
+// -----------------------------------------------------------------------------
+
+// Cheat codes have the form AAAAAA:VVVVVVVV, giving a RAM address and
+// the word value to write there, both in hexadecimal. Several codes can
+// be joined with '+', as usual in libretro cheat files. Codes are applied
+// at the start of each frame, writing only words that don't match.
+class CheatEngine
+{
+    private:
+    
+        // cheats are applied to the RAM of this console
+        V32::V32Console& Console;
+        
+        // codes for each enabled cheat, by index
+        std::map< unsigned, std::vector< CheatCode > > EnabledCheats;
+        
+        // codes from all enabled cheats together
+        std::vector< CheatCode > ActiveCodes;
+        
+        // code handling
+        static bool ParseCodes( const std::string& Text, std::vector< CheatCode >& Codes );
+        void UpdateActiveCodes();
+    
+    public:
+    
+        // instance handling
+        CheatEngine( V32::V32Console& CheatConsole );
+        
+        // configuration
+        void Clear();
+        bool SetCheat( unsigned Index, bool Enabled, const std::string& Text );
+        
+        // operation
+        void ApplyCheats();
+};
+
+
+// =============================================================================
+//      RAM SEARCH
+// =============================================================================
+
+
+enum class RAMSearchComparisons
+{
+    EqualToValue,       // current value is the given one
+    Changed,            // since the previous search step
+    Unchanged,
+    Increased,          // signed comparisons, as integers
+    Decreased
+};
+
+// -----------------------------------------------------------------------------
+
+// Searches keep one candidate bit for each RAM word, and the
+// RAM values at the previous step. Each step compares all of
+// RAM in blocks of 64 words, so that each block produces a
+// whole word of candidate bits, and blocks with no remaining
+// candidates are skipped. Comparisons use SIMD when available.
+class RAMSearch
+{
+    private:
+    
+        // the search looks at the RAM of this console
+        V32::V32Console& Console;
+        
+        std::vector< V32::V32Word > PreviousValues;
+        std::vector< uint64_t > Candidates;
+    
+    public:
+    
+        // instance handling
+        RAMSearch( V32::V32Console& SearchConsole );
+        
+        // search control
+        void Start();
+        void Stop();
+        bool IsActive();
+        
+        // search steps; each one returns
+        // the number of remaining candidates
+        uint32_t Filter( RAMSearchComparisons Comparison, int32_t Value = 0 );
+        uint32_t CountCandidates();
+        
+        // gives the RAM addresses of the first candidates
+        std::vector< int32_t > GetCandidates( uint32_t MaximumResults );
+        
+        // compare a block of 64 words, returning 1 bit per word;
+        // the scalar version is the reference for the SIMD ones
+        static uint64_t CompareBlock( const int32_t* A, const int32_t* B, bool Greater );
+        static uint64_t CompareBlockScalar( const int32_t* A, const int32_t* B, bool Greater );
+};
+
+
+// *****************************************************************************
+    // end include guard
+    #endif
+// *****************************************************************************
@@ -0,0 +1,134 @@
+// *****************************************************************************
+    // include common Vircon32 headers
+    #include "../VirconDefinitions/FileFormats.hpp"
+    
+    // include console logic headers
+    #include "Decompression.hpp"
+    
+    // include C/C++ headers
+    #include <cstring>          // [ ANSI C ] Strings
+    
+    // declare used namespaces
+    using namespace std;
+// *****************************************************************************
+
+
+namespace V32
+{
+    // =============================================================================
+    //      DECOMPRESSION FUNCTIONS
+    // =============================================================================
+    
+    
+    bool DecodeRaw( const uint8_t* Source, uint32_t SourceLength, uint8_t* Destination, uint32_t DestinationLength )
+    {
+        if( SourceLength != DestinationLength )
+          return false;
+        
+        memcpy( Destination, Source, DestinationLength );
+        return true;
+    }
+    
+    // -----------------------------------------------------------------------------
+    
+    // decoder for the standard LZ4 block format (not the frame
+    // format); every read and write is checked, since cartridge
+    // files cannot be trusted to be well formed
+    bool DecodeLZ4Block( const uint8_t* Source, uint32_t SourceLength, uint8_t* Destination, uint32_t DestinationLength )
+    {
+        const uint8_t* Input = Source;
+        const uint8_t* InputEnd = Source + SourceLength;
+        uint8_t* Output = Destination;
+        uint8_t* OutputEnd = Destination + DestinationLength;
+        
+        while( Input < InputEnd )
+        {
+            // each sequence starts with a token
+            // containing both of its lengths
+            uint8_t Token = *Input++;
+            
+            // read the literals length
+            uint32_t LiteralsLength = Token >> 4;
+            
+            if( LiteralsLength == 15 )
+            {
+                uint8_t ExtraLength;
+                
+                do
+                {
+                    if( Input >= InputEnd ) return false;
+                    ExtraLength = *Input++;
+                    LiteralsLength += ExtraLength;
+                }
+                while( ExtraLength == 255 );
+            }
+            
+            // copy the literals
+            if( LiteralsLength > (uint32_t)(InputEnd - Input) )  return false;
+            if( LiteralsLength > (uint32_t)(OutputEnd - Output) ) return false;
+            
+            memcpy( Output, Input, LiteralsLength );
+            Input += LiteralsLength;
+            Output += LiteralsLength;
+            
+            // the last sequence has only literals
+            if( Input == InputEnd )
+              break;
+            
+            // read the match offset
+            if( (InputEnd - Input) < 2 ) return false;
+            uint32_t Offset = Input[ 0 ] | (Input[ 1 ] << 8);
+            Input += 2;
+            
+            if( Offset == 0 || Offset > (uint32_t)(Output - Destination) )
+              return false;
+            
+            // read the match length
+            uint32_t MatchLength = Token & 15;
+            
+            if( MatchLength == 15 )
+            {
+                uint8_t ExtraLength;
+                
+                do
+                {
+                    if( Input >= InputEnd ) return false;
+                    ExtraLength = *Input++;
+                    MatchLength += ExtraLength;
+                }
+                while( ExtraLength == 255 );
+            }
+            
+            MatchLength += 4;
+            
+            // copy the match; it can overlap with
+            // the output so copy byte by byte
+            if( MatchLength > (uint32_t)(OutputEnd - Output) )
+              return false;
+            
+            const uint8_t* Match = Output - Offset;
+            
+            for( uint32_t i = 0; i < MatchLength; i++ )
+              *Output++ = *Match++;
+        }
+        
+        return (Output == OutputEnd);
+    }
+    
+    // -----------------------------------------------------------------------------
+    
+    bool DecodeChunk( uint32_t Codec, const uint8_t* Source, uint32_t SourceLength, uint8_t* Destination, uint32_t DestinationLength )
+    {
+        switch( Codec )
+        {
+            case (uint32_t)CompressedROMFileFormat::Codecs::Raw:
+                return DecodeRaw( Source, SourceLength, Destination, DestinationLength );
+            
+            case (uint32_t)CompressedROMFileFormat::Codecs::LZ4:
+                return DecodeLZ4Block( Source, SourceLength, Destination, DestinationLength );
+            
+            // unknown codecs cannot be decoded
+            default: return false;
+        }
+    }
+}
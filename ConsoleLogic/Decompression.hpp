@@ -0,0 +1,31 @@
+// *****************************************************************************
+    // start include guard
+    #ifndef DECOMPRESSION_HPP
+    #define DECOMPRESSION_HPP
+    
+    // include C/C++ headers
+    #include <cstdint>          // [ ANSI C ] Standard integer types
+// *****************************************************************************
+
+
+namespace V32
+{
+    // =============================================================================
+    //      DECOMPRESSION FUNCTIONS
+    // =============================================================================
+    
+    
+    // all decoders need to fill the destination exactly;
+    // they return false for any malformed or truncated data
+    bool DecodeRaw( const uint8_t* Source, uint32_t SourceLength, uint8_t* Destination, uint32_t DestinationLength );
+    bool DecodeLZ4Block( const uint8_t* Source, uint32_t SourceLength, uint8_t* Destination, uint32_t DestinationLength );
+    
+    // selects the decoder from a compressed ROM codec value
+    bool DecodeChunk( uint32_t Codec, const uint8_t* Source, uint32_t SourceLength, uint8_t* Destination, uint32_t DestinationLength );
+}
+
+
+// *****************************************************************************
+    // end include guard
+    #endif
+// *****************************************************************************
@@ -10,24 +10,95 @@
 namespace V32
 {
     // =============================================================================
-    //      CALLBACKS FOR EXTERNAL FUNCTIONS
+    //      CONSOLE CALLBACKS
     // =============================================================================
     
     
-    namespace Callbacks
-    {
-        // callbacks to the video library
-        void( *ClearScreen )( V32::GPUColor ) = nullptr;
-        void( *DrawQuad )( V32::GPUQuad& ) = nullptr;
-        void( *SetMultiplyColor )( V32::GPUColor ) = nullptr;
-        void( *SetBlendingMode )( int ) = nullptr;
-        void( *SelectTexture )( int ) = nullptr;
-        void( *LoadTexture )( int, void* ) = nullptr;
-        void( *UnloadCartridgeTextures )() = nullptr;
-        void( *UnloadBiosTexture )() = nullptr;
-        
-        // callbacks to the log library
-        void( *LogLine )( const string& ) = nullptr;
-        void( *ThrowException )( const string& ) = nullptr;
+    void ConsoleCallbacks::RestoreRenderState( int GPUTextureID, GPUColor NewMultiplyColor, int NewBlendingMode )
+    {
+        SelectTexture( GPUTextureID );
+        SetMultiplyColor( NewMultiplyColor );
+        SetBlendingMode( NewBlendingMode );
+    }
+    
+    // -----------------------------------------------------------------------------
+    
+    void ConsoleCallbacks::HardwareErrorRaised( CPUErrorCodes Code )
+    {
+        // (empty block: errors are only optionally reported)
+    }
+    
+    
+    // =============================================================================
+    //      HEADLESS CALLBACKS
+    // =============================================================================
+    
+    
+    void HeadlessCallbacks::ClearScreen( GPUColor ClearColor )
+    {
+        // (empty block: there is no screen)
+    }
+    
+    // -----------------------------------------------------------------------------
+    
+    void HeadlessCallbacks::DrawQuad( GPUQuad& DrawnQuad )
+    {
+        // (empty block: there is no screen)
+    }
+    
+    // -----------------------------------------------------------------------------
+    
+    void HeadlessCallbacks::SetMultiplyColor( GPUColor NewMultiplyColor )
+    {
+        // (empty block: there is no screen)
+    }
+    
+    // -----------------------------------------------------------------------------
+    
+    void HeadlessCallbacks::SetBlendingMode( int NewBlendingMode )
+    {
+        // (empty block: there is no screen)
+    }
+    
+    // -----------------------------------------------------------------------------
+    
+    void HeadlessCallbacks::SelectTexture( int GPUTextureID )
+    {
+        // (empty block: there is no screen)
+    }
+    
+    // -----------------------------------------------------------------------------
+    
+    void HeadlessCallbacks::LoadTexture( int GPUTextureID, int Width, int Height, void* Pixels )
+    {
+        // (empty block: there is no screen)
+    }
+    
+    // -----------------------------------------------------------------------------
+    
+    void HeadlessCallbacks::UnloadCartridgeTextures()
+    {
+        // (empty block: there is no screen)
+    }
+    
+    // -----------------------------------------------------------------------------
+    
+    void HeadlessCallbacks::UnloadBiosTexture()
+    {
+        // (empty block: there is no screen)
+    }
+    
+    // -----------------------------------------------------------------------------
+    
+    void HeadlessCallbacks::LogLine( const string& Message )
+    {
+        // (empty block: logs are ignored)
+    }
+    
+    // -----------------------------------------------------------------------------
+    
+    void HeadlessCallbacks::ThrowException( const string& Message )
+    {
+        throw runtime_error( Message );
     }
 }
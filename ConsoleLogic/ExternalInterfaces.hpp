@@ -6,6 +6,7 @@
     // include common vircon32 headers
     #include "../VirconDefinitions/Constants.hpp"
     #include "../VirconDefinitions/DataStructures.hpp"
+    #include "../VirconDefinitions/Enumerations.hpp"
     
     // include C/C++ headers
     #include <string>         // [ C++ STL ] Strings
@@ -76,24 +77,61 @@ namespace V32
     // =============================================================================
     
     
-    // note that providing all these callbacks is required:
-    // the console will invoke them without any checks
-    namespace Callbacks
+    // Each console calls the functions of its own interface
+    // object, so many consoles can run in the same program,
+    // each one on its own thread. Note that providing this
+    // interface is required: the console will invoke these
+    // functions without any checks.
+    class ConsoleCallbacks
     {
-        // callbacks to the video library
-        extern void( *ClearScreen )( V32::GPUColor );
-        extern void( *DrawQuad )( V32::GPUQuad& );
-        extern void( *SetMultiplyColor )( V32::GPUColor );
-        extern void( *SetBlendingMode )( int );
-        extern void( *SelectTexture )( int );
-        extern void( *LoadTexture )( int, void* );
-        extern void( *UnloadCartridgeTextures )();
-        extern void( *UnloadBiosTexture )();
-        
-        // callbacks to the log library
-        extern void( *LogLine )( const std::string& );
-        extern void( *ThrowException )( const std::string& );
-    }
+        public:
+            
+            virtual ~ConsoleCallbacks() {};
+            
+            // callbacks to the video library
+            virtual void ClearScreen( GPUColor ClearColor ) = 0;
+            virtual void DrawQuad( GPUQuad& DrawnQuad ) = 0;
+            virtual void SetMultiplyColor( GPUColor NewMultiplyColor ) = 0;
+            virtual void SetBlendingMode( int NewBlendingMode ) = 0;
+            virtual void SelectTexture( int GPUTextureID ) = 0;
+            virtual void LoadTexture( int GPUTextureID, int Width, int Height, void* Pixels ) = 0;
+            virtual void UnloadCartridgeTextures() = 0;
+            virtual void UnloadBiosTexture() = 0;
+            
+            // used when GPU registers are loaded from a state;
+            // by default the 3 settings are just set again
+            virtual void RestoreRenderState( int GPUTextureID, GPUColor NewMultiplyColor, int NewBlendingMode );
+            
+            // callbacks to the log library
+            virtual void LogLine( const std::string& Message ) = 0;
+            virtual void ThrowException( const std::string& Message ) = 0;
+            
+            // called when the CPU raises a hardware error, just
+            // before the BIOS handles it; by default does nothing
+            virtual void HardwareErrorRaised( CPUErrorCodes Code );
+    };
+    
+    // -----------------------------------------------------------------------------
+    
+    // for programs that run consoles without any video
+    // output: nothing is drawn (only the emulated GPU
+    // does its work), logs are ignored and exceptions
+    // are thrown as runtime errors
+    class HeadlessCallbacks: public ConsoleCallbacks
+    {
+        public:
+            
+            virtual void ClearScreen( GPUColor ClearColor ) override;
+            virtual void DrawQuad( GPUQuad& DrawnQuad ) override;
+            virtual void SetMultiplyColor( GPUColor NewMultiplyColor ) override;
+            virtual void SetBlendingMode( int NewBlendingMode ) override;
+            virtual void SelectTexture( int GPUTextureID ) override;
+            virtual void LoadTexture( int GPUTextureID, int Width, int Height, void* Pixels ) override;
+            virtual void UnloadCartridgeTextures() override;
+            virtual void UnloadBiosTexture() override;
+            virtual void LogLine( const std::string& Message ) override;
+            virtual void ThrowException( const std::string& Message ) override;
+    };
     
     
     // =============================================================================
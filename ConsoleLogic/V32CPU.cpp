@@ -121,6 +121,7 @@ namespace V32
     {
         MemoryBus = nullptr;
         ControlBus = nullptr;
+        Callbacks = nullptr;
     }
     
     // -----------------------------------------------------------------------------
@@ -164,6 +165,11 @@ namespace V32
         if( Instruction.UsesImmediate )
           MemoryBus->ReadAddress( InstructionPointer.AsInteger++, ImmediateValue );
         
+        // count it before running, since it may throw
+        #if defined(ENABLE_CPU_PROFILER)
+          Profiler.CountInstruction( InstructionPointer.AsInteger - 1 - Instruction.UsesImmediate, Instruction );
+        #endif
+        
         // run the instruction
         // (redirect to the needed specific processor)
         int32_t OpCode = Instruction.OpCode;
@@ -192,6 +198,7 @@ namespace V32
         
         // jump to BIOS handler routine
         InstructionPointer.AsInteger = Constants::BiosProgramROMFirstAddress;
+        Callbacks->HardwareErrorRaised( Code );
         
         // abort any normal instruction processing
         throw CPUException();
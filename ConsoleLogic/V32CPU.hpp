@@ -8,6 +8,12 @@
     
     // include console logic headers
     #include "V32Buses.hpp"
+    #include "ExternalInterfaces.hpp"
+    
+    // the profiler is only used in profiling builds
+    #if defined(ENABLE_CPU_PROFILER)
+      #include "V32CPUProfiler.hpp"
+    #endif
 // *****************************************************************************
 
 
@@ -45,6 +51,12 @@ namespace V32
             // connections with the host Vircon system
             V32MemoryBus* MemoryBus;
             V32ControlBus* ControlBus;
+            ConsoleCallbacks* Callbacks;
+            
+            // execution counters for profiling builds
+            #if defined(ENABLE_CPU_PROFILER)
+              V32CPUProfiler Profiler;
+            #endif
             
         public:
             
@@ -0,0 +1,136 @@
+// *****************************************************************************
+    // include console logic headers
+    #include "V32CPUProfiler.hpp"
+    
+    // include C/C++ headers
+    #include <cstdio>           // [ ANSI C ] Standard I/O
+    #include <vector>           // [ C++ STL ] Vectors
+    #include <algorithm>        // [ C++ STL ] Algorithms
+    
+    // declare used namespaces
+    using namespace std;
+// *****************************************************************************
+
+
+namespace V32
+{
+    // =============================================================================
+    //      NAMES USED IN REPORTS
+    // =============================================================================
+    
+    
+    // same order as instruction opcodes
+    static const char* const OpCodeNames[ 64 ] =
+    {
+        "HLT",  "WAIT", "JMP",  "CALL", "RET",  "JT",   "JF",   "IEQ",
+        "INE",  "IGT",  "IGE",  "ILT",  "ILE",  "FEQ",  "FNE",  "FGT",
+        "FGE",  "FLT",  "FLE",  "MOV",  "LEA",  "PUSH", "POP",  "IN",
+        "OUT",  "MOVS", "SETS", "CMPS", "CIF",  "CFI",  "CIB",  "CFB",
+        "NOT",  "AND",  "OR",   "XOR",  "BNOT", "SHL",  "IADD", "ISUB",
+        "IMUL", "IDIV", "IMOD", "ISGN", "IMIN", "IMAX", "IABS", "FADD",
+        "FSUB", "FMUL", "FDIV", "FMOD", "FSGN", "FMIN", "FMAX", "FABS",
+        "FLR",  "CEIL", "ROUND","SIN",  "ACOS", "ATAN2","LOG",  "POW"
+    };
+    
+    // -----------------------------------------------------------------------------
+    
+    // same order as addressing modes
+    static const char* const MOVModeNames[ 8 ] =
+    {
+        "MOV R1, Imm",
+        "MOV R1, R2",
+        "MOV R1, [Imm]",
+        "MOV R1, [R2]",
+        "MOV R1, [R2+Imm]",
+        "MOV [Imm], R2",
+        "MOV [R1], R2",
+        "MOV [R1+Imm], R2"
+    };
+    
+    
+    // =============================================================================
+    //      V32 CPU PROFILER: INSTANCE HANDLING
+    // =============================================================================
+    
+    
+    V32CPUProfiler::V32CPUProfiler()
+    {
+        Clear();
+    }
+    
+    // -----------------------------------------------------------------------------
+    
+    void V32CPUProfiler::Clear()
+    {
+        fill( OpCodeCounts, OpCodeCounts + 64, 0 );
+        fill( MOVModeCounts, MOVModeCounts + 8, 0 );
+        TotalInstructions = 0;
+        
+        AddressSamples.clear();
+        CyclesUntilSample = CPUProfilerSampleInterval;
+    }
+    
+    
+    // =============================================================================
+    //      V32 CPU PROFILER: RESULTS
+    // =============================================================================
+    
+    
+    // adds a report line with a count and its percentage
+    static void AddReportLine( string& Report, const char* Name, uint64_t Count, uint64_t Total )
+    {
+        char Line[ 80 ];
+        double Percentage = (Total > 0? 100.0 * Count / Total : 0.0);
+        snprintf( Line, sizeof(Line), "  %-18s %14llu  %6.2f%%\n", Name, (unsigned long long)Count, Percentage );
+        Report += Line;
+    }
+    
+    // -----------------------------------------------------------------------------
+    
+    string V32CPUProfiler::GetReport( unsigned HottestAddresses )
+    {
+        string Report = "CPU profile: " + to_string( TotalInstructions ) + " instructions executed\n";
+        
+        // opcodes are sorted by number of executions
+        vector< int > OpCodes;
+        
+        for( int OpCode = 0; OpCode < 64; OpCode++ )
+          if( OpCodeCounts[ OpCode ] > 0 )
+            OpCodes.push_back( OpCode );
+        
+        sort( OpCodes.begin(), OpCodes.end(), [this]( int A, int B ){ return OpCodeCounts[ A ] > OpCodeCounts[ B ]; } );
+        Report += "Instruction mix:\n";
+        
+        for( int OpCode: OpCodes )
+          AddReportLine( Report, OpCodeNames[ OpCode ], OpCodeCounts[ OpCode ], TotalInstructions );
+        
+        // MOV percentages are relative to all MOVs
+        uint64_t TotalMOVs = OpCodeCounts[ (int)InstructionOpCodes::MOV ];
+        Report += "MOV addressing modes:\n";
+        
+        for( int Mode = 0; Mode < 8; Mode++ )
+          AddReportLine( Report, MOVModeNames[ Mode ], MOVModeCounts[ Mode ], TotalMOVs );
+        
+        // take the addresses with most samples
+        vector< pair< int32_t, uint64_t > > Addresses( AddressSamples.begin(), AddressSamples.end() );
+        size_t ShownAddresses = min( (size_t)HottestAddresses, Addresses.size() );
+        uint64_t TotalSamples = TotalInstructions / CPUProfilerSampleInterval;
+        
+        partial_sort
+        (
+            Addresses.begin(), Addresses.begin() + ShownAddresses, Addresses.end(),
+            []( const pair< int32_t, uint64_t >& A, const pair< int32_t, uint64_t >& B ){ return A.second > B.second; }
+        );
+        
+        Report += "Hottest addresses (1 sample every " + to_string( CPUProfilerSampleInterval ) + " instructions):\n";
+        
+        for( size_t i = 0; i < ShownAddresses; i++ )
+        {
+            char Address[ 16 ];
+            snprintf( Address, sizeof(Address), "0x%08X", (unsigned)Addresses[ i ].first );
+            AddReportLine( Report, Address, Addresses[ i ].second, TotalSamples );
+        }
+        
+        return Report;
+    }
+}
@@ -0,0 +1,76 @@
+// *****************************************************************************
+    // start include guard
+    #ifndef V32CPUPROFILER_HPP
+    #define V32CPUPROFILER_HPP
+    
+    // include common Vircon32 headers
+    #include "../VirconDefinitions/DataStructures.hpp"
+    #include "../VirconDefinitions/Enumerations.hpp"
+    
+    // include C/C++ headers
+    #include <string>           // [ C++ STL ] Strings
+    #include <unordered_map>    // [ C++ STL ] Unordered maps
+// *****************************************************************************
+
+
+namespace V32
+{
+    // =============================================================================
+    //      V32 CPU PROFILER
+    // =============================================================================
+    
+    
+    // instruction addresses are only counted once
+    // every this many instructions, to reduce cost
+    const uint32_t CPUProfilerSampleInterval = 16;
+    
+    // -----------------------------------------------------------------------------
+    
+    // The profiler is only part of the CPU in builds with
+    // ENABLE_CPU_PROFILER defined; otherwise the CPU loop
+    // does not call it at all, so it has no cost.
+    class V32CPUProfiler
+    {
+        public:
+        
+            // exact counts for all instructions
+            uint64_t OpCodeCounts[ 64 ];
+            uint64_t MOVModeCounts[ 8 ];
+            uint64_t TotalInstructions;
+            
+            // sampled counts for instruction addresses
+            std::unordered_map< int32_t, uint64_t > AddressSamples;
+            uint32_t CyclesUntilSample;
+        
+        public:
+        
+            // instance handling
+            V32CPUProfiler();
+            void Clear();
+            
+            // called for every executed instruction
+            void CountInstruction( int32_t Address, CPUInstruction Instruction )
+            {
+                OpCodeCounts[ Instruction.OpCode ]++;
+                TotalInstructions++;
+                
+                if( Instruction.OpCode == (uint32_t)InstructionOpCodes::MOV )
+                  MOVModeCounts[ Instruction.AddressingMode ]++;
+                
+                if( --CyclesUntilSample == 0 )
+                {
+                    AddressSamples[ Address ]++;
+                    CyclesUntilSample = CPUProfilerSampleInterval;
+                }
+            }
+            
+            // results
+            std::string GetReport( unsigned HottestAddresses );
+    };
+}
+
+
+// *****************************************************************************
+    // end include guard
+    #endif
+// *****************************************************************************
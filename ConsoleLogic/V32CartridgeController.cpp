@@ -1,6 +1,10 @@
 // *****************************************************************************
+    // include common Vircon32 headers
+    #include "../VirconDefinitions/FileFormats.hpp"
+    
     // include console logic headers
     #include "V32CartridgeController.hpp"
+    #include "Decompression.hpp"
 // *****************************************************************************
 
 
@@ -25,6 +29,77 @@ namespace V32
     
     // -----------------------------------------------------------------------------
     
+    V32CartridgeController::~V32CartridgeController()
+    {
+        // ensure we always close the file
+        if( LinkedFile.is_open() )
+          LinkedFile.close();
+    }
+    
+    // -----------------------------------------------------------------------------
+    
+    // pixels are given only for the actual texture size,
+    // and unread pixels are left as transparent black
+    bool V32CartridgeController::ReadTexture( int32_t TextureID, std::vector< GPUColor >& Pixels, std::ifstream& InputFile )
+    {
+        const CartridgeTextureLocation& Location = TextureLocations[ TextureID ];
+        
+        Pixels.clear();
+        Pixels.resize( Location.Width * Location.Height, GPUColor{ 0, 0, 0, 0 } );
+        
+        return ReadStoredData( InputFile, Location.FileOffset, Location.StoredLength, Location.Codec, &Pixels[ 0 ], Pixels.size() * 4 );
+    }
+    
+    // -----------------------------------------------------------------------------
+    
+    // same as for textures, samples not read are left as silence
+    bool V32CartridgeController::ReadSound( int32_t SoundID, std::vector< SPUSample >& Samples, std::ifstream& InputFile )
+    {
+        const CartridgeSoundLocation& Location = SoundLocations[ SoundID ];
+        
+        Samples.clear();
+        Samples.resize( Location.Samples, SPUSample{ 0, 0 } );
+        
+        return ReadStoredData( InputFile, Location.FileOffset, Location.StoredLength, Location.Codec, &Samples[ 0 ], Samples.size() * 4 );
+    }
+    
+    // -----------------------------------------------------------------------------
+    
+    bool V32CartridgeController::ReadStoredData( std::ifstream& InputFile, uint32_t FileOffset, uint32_t StoredLength, uint32_t Codec, void* Destination, uint32_t DecodedLength )
+    {
+        if( !InputFile.is_open() )
+          return false;
+        
+        // a previous failed read would block all next ones
+        InputFile.clear();
+        InputFile.seekg( FileOffset, std::ios_base::beg );
+        
+        // raw data can be read directly with no copies
+        if( Codec == (uint32_t)CompressedROMFileFormat::Codecs::Raw )
+        {
+            if( StoredLength != DecodedLength )
+              return false;
+            
+            InputFile.read( (char*)Destination, DecodedLength );
+            return !InputFile.fail();
+        }
+        
+        // otherwise read the whole chunk and decode it
+        if( StoredLength == 0 )
+          return false;
+        
+        std::vector< uint8_t > StoredData;
+        StoredData.resize( StoredLength );
+        InputFile.read( (char*)(&StoredData[ 0 ]), StoredLength );
+        
+        if( InputFile.fail() )
+          return false;
+        
+        return DecodeChunk( Codec, &StoredData[ 0 ], StoredLength, (uint8_t*)Destination, DecodedLength );
+    }
+    
+    // -----------------------------------------------------------------------------
+    
     bool V32CartridgeController::ReadPort( int32_t LocalPort, V32Word& Result )
     {
         // check range
@@ -9,6 +9,8 @@
     
     // include C/C++ headers
     #include <string>           // [ C++ STL ] Strings
+    #include <vector>           // [ C++ STL ] Vectors
+    #include <fstream>          // [ C++ STL ] File streams
 // *****************************************************************************
 
 
@@ -32,6 +34,33 @@ namespace V32
     // used as limit of local port numbers
     const int32_t CAR_LastPort = (int32_t)CAR_LocalPorts::NumberOfSounds;
     
+    // -----------------------------------------------------------------------------
+    
+    // textures are not kept in memory: we only store
+    // where to find them within the cartridge file
+    typedef struct
+    {
+        uint32_t FileOffset;        // start of pixel data, given in bytes
+        uint32_t StoredLength;      // bytes of pixel data within the file
+        uint32_t Codec;             // encoding of pixel data (for compressed ROMs)
+        uint32_t Width;             // texture width in pixels
+        uint32_t Height;            // texture height in pixels
+    }
+    CartridgeTextureLocation;
+    
+    // -----------------------------------------------------------------------------
+    
+    // sound samples are loaded in the background
+    // so we also need to know where to find them
+    typedef struct
+    {
+        uint32_t FileOffset;        // start of sample data, given in bytes
+        uint32_t StoredLength;      // bytes of sample data within the file
+        uint32_t Codec;             // encoding of sample data (for compressed ROMs)
+        uint32_t Samples;           // sound length in samples
+    }
+    CartridgeSoundLocation;
+    
     
     // =============================================================================
     //      CARTRIDGE CONTROLLER CLASS
@@ -52,10 +81,25 @@ namespace V32
             uint32_t CartridgeVersion;
             uint32_t CartridgeRevision;
             
+            // video and audio ROM are read from file in the
+            // background, or on demand if not done yet
+            std::ifstream LinkedFile;
+            std::vector< CartridgeTextureLocation > TextureLocations;
+            std::vector< CartridgeSoundLocation > SoundLocations;
+            
         public:
             
             // instance handling
             V32CartridgeController();
+           ~V32CartridgeController();
+            
+            // access to video and audio ROM (the file is
+            // given, since they can be read from other threads)
+            bool ReadTexture( int32_t TextureID, std::vector< GPUColor >& Pixels, std::ifstream& InputFile );
+            bool ReadSound( int32_t SoundID, std::vector< SPUSample >& Samples, std::ifstream& InputFile );
+            
+            // decodes any stored asset data to its final form
+            static bool ReadStoredData( std::ifstream& InputFile, uint32_t FileOffset, uint32_t StoredLength, uint32_t Codec, void* Destination, uint32_t DecodedLength );
             
             // connection to control bus
             virtual bool ReadPort( int32_t LocalPort, V32Word& Result );
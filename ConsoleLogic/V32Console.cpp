@@ -7,9 +7,11 @@
     #include "V32Console.hpp"
     #include "ExternalInterfaces.hpp"
     #include "AuxiliaryFunctions.hpp"
+    #include "V32Tracing.hpp"
     
     // include C/C++ headers
     #include <cstring>          // [ ANSI C ] Strings
+    #include <algorithm>        // [ C++ STL ] Algorithms
     
     // these are only needed to treat UTF-16 file paths
     #if defined(__WIN32__)
@@ -24,8 +26,24 @@
 
 namespace V32
 {
-    // buffer used to transmit textures from loaded ROM files to the video library
-    static GPUColor LoadedTexture[ Constants::GPUTextureSize ][ Constants::GPUTextureSize ];
+    // =============================================================================
+    //      AUXILIARY FUNCTIONS
+    // =============================================================================
+    
+    
+    // cartridge files need to be opened from more than one
+    // thread, so keep all path handling in a single place
+    static void OpenCartridgeFile( ifstream& InputFile, const std::string& FilePath )
+    {
+        // on windows convert path from UTF-8 to UTF-16
+        #if defined(__WIN32__)
+          wstring_convert< std::codecvt_utf8_utf16< wchar_t > > converter;
+          wstring FilePathUTF16 = converter.from_bytes(FilePath);
+          InputFile.open( FilePathUTF16.c_str(), ios_base::binary | ios_base::ate );
+        #else
+          InputFile.open( FilePath, ios_base::binary | ios_base::ate );
+        #endif
+    }
     
     
     // =============================================================================
@@ -59,11 +77,21 @@ namespace V32
         ControlBus.Slaves[ 6 ] = &MemoryCardController;
         ControlBus.Slaves[ 7 ] = &NullController;
         
+        // connect GPU and SPU to the cartridge ROMs
+        GPU.CartridgeController = &CartridgeController;
+        SPU.CartridgeController = &CartridgeController;
+        
         // connect main RAM
         RAM.Connect( Constants::RAMSize );
         
+        // callbacks are provided later
+        Callbacks = nullptr;
+        
         // set initial state
         PowerIsOn = false;
+        AssetLoadersMustStop = false;
+        NextTextureToLoad = 0;
+        NextSoundToLoad = 0;
         
         // initial loads are 0
         LastCPULoads[ 0 ] = LastCPULoads[ 1 ] = 0;
@@ -82,6 +110,18 @@ namespace V32
         if( HasBios() )        UnloadBios();
     }
     
+    // -----------------------------------------------------------------------------
+    
+    void V32Console::SetCallbacks( ConsoleCallbacks* NewCallbacks )
+    {
+        // components report to the same interface
+        Callbacks = NewCallbacks;
+        CPU.Callbacks = NewCallbacks;
+        GPU.Callbacks = NewCallbacks;
+        SPU.Callbacks = NewCallbacks;
+        MemoryCardController.Callbacks = NewCallbacks;
+    }
+    
     
     // =============================================================================
     //      V32 CONSOLE: CONTROL SIGNALS
@@ -98,14 +138,14 @@ namespace V32
         // to take care of initializations
         if( On )
         {
-            Callbacks::LogLine( "Console power ON" );
+            Callbacks->LogLine( "Console power ON" );
             Reset();
         }
         
         // at power off, stop all sound
         else
         {
-            Callbacks::LogLine( "Console power OFF" );
+            Callbacks->LogLine( "Console power OFF" );
             SPU.StopAllChannels();
         }
     }
@@ -114,7 +154,7 @@ namespace V32
     
     void V32Console::Reset()
     {
-        Callbacks::LogLine( "Console reset" );
+        Callbacks->LogLine( "Console reset" );
         
         // first: transmit the message to all components that need it
         Timer.Reset();
@@ -141,6 +181,8 @@ namespace V32
     // games audio desynchronization might cause problems
     void V32Console::RunNextFrame( bool FrameSkipped )
     {
+        TRACE_SCOPE( "V32Console::RunNextFrame" );
+        
         // do nothing when not applicable
         if( !PowerIsOn )
           return;
@@ -163,6 +205,8 @@ namespace V32
         // STEP 2: Run a frame's worth of cycles
         try
         {
+            PERF_SCOPE( CPULoop );
+            
             for( int i = 0; i < Constants::CyclesPerFrame; i++ )
             {
                 // end loop early when CPU is set to wait
@@ -189,9 +233,29 @@ namespace V32
         LastGPULoads[ 1 ] = LastGPULoads[ 0 ];
         LastGPULoads[ 0 ] = 100.0 * GPUUsedPixels / Constants::GPUPixelCapacityPerFrame;
         
-        // STEP 3: save memory card to file when modified
-        if( MemoryCardController.PendingSave )
-          SaveMemoryCard();
+        // STEP 3: save memory card to file when modified,
+        // after the configured delay to group many writes
+        if( MemoryCardController.PendingSave && !MemoryCardController.SavesSuppressed && MemoryCardController.IsWriterRunning() )
+          if( ++MemoryCardController.FramesSinceModified > MemoryCardController.SaveDelayFrames )
+            SaveMemoryCard();
+    }
+    
+    // -----------------------------------------------------------------------------
+    
+    // GPU commands still use their exact capacity, so
+    // the program runs just as it would when drawing
+    void V32Console::SetDrawingSuppressed( bool Suppressed )
+    {
+        GPU.DrawingSuppressed = Suppressed;
+    }
+    
+    // -----------------------------------------------------------------------------
+    
+    // the card can still be modified, and it will
+    // be saved as usual once saves are allowed again
+    void V32Console::SetMemoryCardSavesSuppressed( bool Suppressed )
+    {
+        MemoryCardController.SavesSuppressed = Suppressed;
     }
     
     
@@ -240,8 +304,8 @@ namespace V32
     
     void V32Console::LoadBiosFile( const std::string& FilePath )
     {
-        Callbacks::LogLine( "Loading bios file" );
-        Callbacks::LogLine( "File path: \"" + FilePath + "\"" );
+        Callbacks->LogLine( "Loading bios file" );
+        Callbacks->LogLine( "File path: \"" + FilePath + "\"" );
         
         // open bios file
         ifstream FileInput;
@@ -256,7 +320,7 @@ namespace V32
         #endif
         
         if( FileInput.fail() )
-          Callbacks::ThrowException( "Cannot open BIOS file" );
+          Callbacks->ThrowException( "Cannot open BIOS file" );
         
         // now load the bios from the stream
         LoadBiosData( FileInput );
@@ -269,7 +333,7 @@ namespace V32
     
     void V32Console::LoadBiosData( std::istream& Input )
     {
-        Callbacks::LogLine( "Loading bios data" );
+        Callbacks->LogLine( "Loading bios data" );
         
         // unload any previous bios
         UnloadBios();
@@ -284,11 +348,11 @@ namespace V32
         unsigned FileBytes = Input.tellg();
         
         if( (FileBytes % 4) != 0 )
-          Callbacks::ThrowException( "Incorrect V32 file format (file size must be a multiple of 4)" );
+          Callbacks->ThrowException( "Incorrect V32 file format (file size must be a multiple of 4)" );
         
         // ensure that we can at least load the file header
         if( FileBytes < sizeof(ROMFileFormat::Header) )
-          Callbacks::ThrowException( "Incorrect V32 file format (file is too small)" );
+          Callbacks->ThrowException( "Incorrect V32 file format (file is too small)" );
         
         // now we can safely read the global header
         Input.seekg( 0, ios_base::beg );
@@ -297,20 +361,20 @@ namespace V32
         
         // check if the ROM is actually a cartridge
         if( CheckSignature( ROMHeader.Signature, ROMFileFormat::CartridgeSignature ) )
-          Callbacks::ThrowException( "Input V32 ROM cannot be loaded as a BIOS (is it a cartridge instead)" );
+          Callbacks->ThrowException( "Input V32 ROM cannot be loaded as a BIOS (is it a cartridge instead)" );
         
         // now check the actual BIOS signature
         if( !CheckSignature( ROMHeader.Signature, ROMFileFormat::BiosSignature ) )
-          Callbacks::ThrowException( "Incorrect V32 file format (file does not have a valid signature)" );
+          Callbacks->ThrowException( "Incorrect V32 file format (file does not have a valid signature)" );
         
         // check current Vircon version
         if( ROMHeader.VirconVersion  > (unsigned)Constants::VirconVersion
         ||  ROMHeader.VirconRevision > (unsigned)Constants::VirconRevision )
-          Callbacks::ThrowException( "This BIOS was made for a more recent version of Vircon32. Please use an updated emulator" );
+          Callbacks->ThrowException( "This BIOS was made for a more recent version of Vircon32. Please use an updated emulator" );
         
         // report the title
         ROMHeader.Title[ 63 ] = 0;
-        Callbacks::LogLine( string("BIOS title: \"") + ROMHeader.Title + "\"" );
+        Callbacks->LogLine( string("BIOS title: \"") + ROMHeader.Title + "\"" );
         
         // - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - -
         // STEP 2: Check the declared rom contents
@@ -318,33 +382,33 @@ namespace V32
         
         // ensure that there is exactly 1 texture
         if( ROMHeader.NumberOfTextures != 1 )
-          Callbacks::ThrowException( "A BIOS video rom should have exactly 1 texture" );
+          Callbacks->ThrowException( "A BIOS video rom should have exactly 1 texture" );
         
         // ensure that there is exactly 1 sound
         if( ROMHeader.NumberOfSounds != 1 )
-          Callbacks::ThrowException( "A BIOS audio rom should have exactly 1 sound" );
+          Callbacks->ThrowException( "A BIOS audio rom should have exactly 1 sound" );
         
         // check for correct program rom location
         if( ROMHeader.ProgramROMLocation.StartOffset != sizeof(ROMFileFormat::Header) )
-          Callbacks::ThrowException( "Incorrect V32 file format (program ROM is not located after file header)" );
+          Callbacks->ThrowException( "Incorrect V32 file format (program ROM is not located after file header)" );
         
         // check for correct video rom location
         uint32_t SizeAfterProgramROM = ROMHeader.ProgramROMLocation.StartOffset + ROMHeader.ProgramROMLocation.Length;
         
         if( ROMHeader.VideoROMLocation.StartOffset != SizeAfterProgramROM )
-          Callbacks::ThrowException( "Incorrect V32 file format (video ROM is not located after program ROM)" );
+          Callbacks->ThrowException( "Incorrect V32 file format (video ROM is not located after program ROM)" );
         
         // check for correct audio rom location
         uint32_t SizeAfterVideoROM = ROMHeader.VideoROMLocation.StartOffset + ROMHeader.VideoROMLocation.Length;
         
         if( ROMHeader.AudioROMLocation.StartOffset != SizeAfterVideoROM )
-          Callbacks::ThrowException( "Incorrect V32 file format (audio ROM is not located after video ROM)" );
+          Callbacks->ThrowException( "Incorrect V32 file format (audio ROM is not located after video ROM)" );
         
         // check for correct file size
         uint32_t SizeAfterAudioROM = ROMHeader.AudioROMLocation.StartOffset + ROMHeader.AudioROMLocation.Length;
         
         if( FileBytes != SizeAfterAudioROM )
-          Callbacks::ThrowException( "Incorrect V32 file format (file size does not match indicated ROM contents)" );
+          Callbacks->ThrowException( "Incorrect V32 file format (file size does not match indicated ROM contents)" );
         
         // - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - -
         // STEP 3: Load program rom
@@ -356,11 +420,11 @@ namespace V32
         
         // check signature for embedded binary
         if( !CheckSignature( BinaryHeader.Signature, BinaryFileFormat::Signature ) )
-          Callbacks::ThrowException( "BIOS binary does not have a valid signature" );
+          Callbacks->ThrowException( "BIOS binary does not have a valid signature" );
         
         // checking program rom size limitations
         if( !IsBetween( BinaryHeader.NumberOfWords, 1, Constants::MaximumBiosProgramROM ) )
-          Callbacks::ThrowException( "BIOS binary does not have a correct size (from 1 word up to 1M words)" );
+          Callbacks->ThrowException( "BIOS binary does not have a correct size (from 1 word up to 1M words)" );
         
         // load the binary contents
         vector< V32Word > LoadedBinary;
@@ -381,27 +445,29 @@ namespace V32
         
         // check signature for embedded texture
         if( !CheckSignature( TextureHeader.Signature, TextureFileFormat::Signature ) )
-          Callbacks::ThrowException( "BIOS texture does not have a valid signature" );
+          Callbacks->ThrowException( "BIOS texture does not have a valid signature" );
         
         // report texture size
-        Callbacks::LogLine( "BIOS texture is " + to_string( TextureHeader.TextureWidth )
+        Callbacks->LogLine( "BIOS texture is " + to_string( TextureHeader.TextureWidth )
            + "x" + to_string( TextureHeader.TextureHeight ) );
         
         // check texture size limitations
         if( !IsBetween( TextureHeader.TextureWidth , 1, Constants::GPUTextureSize )
         ||  !IsBetween( TextureHeader.TextureHeight, 1, Constants::GPUTextureSize ) )
-          Callbacks::ThrowException( "BIOS texture does not have correct dimensions (from 1x1 up to 1024x1024 pixels)" );
-        
-        // clear all texture pixels
-        memset( LoadedTexture, 0, sizeof(LoadedTexture) );
+          Callbacks->ThrowException( "BIOS texture does not have correct dimensions (from 1x1 up to 1024x1024 pixels)" );
         
-        // load the texture pixels line by line,
-        // in order to expand it to full size
-        for( unsigned y = 0; y < TextureHeader.TextureHeight; y++ )
-          Input.read( (char*)(LoadedTexture[ y ]), TextureHeader.TextureWidth * 4 );
+        // load the texture pixels; there is no need to expand
+        // them to full size, since the video library will only
+        // update the area that the texture actually covers
+        vector< GPUColor > LoadedTexture;
+        LoadedTexture.resize( TextureHeader.TextureWidth * TextureHeader.TextureHeight );
+        Input.read( (char*)(&LoadedTexture[ 0 ]), LoadedTexture.size() * 4 );
         
         // send bios texture to the video library
-        Callbacks::LoadTexture( -1, LoadedTexture );
+        Callbacks->LoadTexture( -1, TextureHeader.TextureWidth, TextureHeader.TextureHeight, &LoadedTexture[ 0 ] );
+        
+        // discard the temporary buffer
+        LoadedTexture.clear();
         
         // - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - -
         // STEP 5: Load audio rom
@@ -413,14 +479,14 @@ namespace V32
         
         // check signature for embedded sound
         if( !CheckSignature( SoundHeader.Signature, SoundFileFormat::Signature ) )
-          Callbacks::ThrowException( "BIOS sound does not have a valid signature" );
+          Callbacks->ThrowException( "BIOS sound does not have a valid signature" );
         
         // report sound length
-        Callbacks::LogLine( "BIOS sound is " + to_string( SoundHeader.SoundSamples ) + " samples" );
+        Callbacks->LogLine( "BIOS sound is " + to_string( SoundHeader.SoundSamples ) + " samples" );
         
         // check sound length limitations
         if( !IsBetween( SoundHeader.SoundSamples, 1, Constants::SPUMaximumBiosSamples ) )
-          Callbacks::ThrowException( "BIOS sound does not have a correct length (from 1 up to 1M samples)" );
+          Callbacks->ThrowException( "BIOS sound does not have a correct length (from 1 up to 1M samples)" );
         
         // load the sound samples
         vector< SPUSample > LoadedSound;
@@ -432,7 +498,7 @@ namespace V32
         LoadedSound.clear();
         
         // report success
-        Callbacks::LogLine( "Finished loading BIOS" );
+        Callbacks->LogLine( "Finished loading BIOS" );
     }
     
     // -----------------------------------------------------------------------------
@@ -441,13 +507,13 @@ namespace V32
     {
         // do nothing if a bios is not loaded
         if( !HasBios() ) return;
-        Callbacks::LogLine( "Unloading bios" );
+        Callbacks->LogLine( "Unloading bios" );
         
         // release bios program ROM
         BiosProgramROM.Disconnect();
         
         // release the bios texture
-        Callbacks::UnloadBiosTexture();
+        Callbacks->UnloadBiosTexture();
         
         // tell SPU to release the bios sounds
         SPU.UnloadSound( SPU.BiosSound );
@@ -468,26 +534,21 @@ namespace V32
     
     void V32Console::LoadCartridge( const std::string& FilePath )
     {
-        Callbacks::LogLine( "Loading cartridge" );
-        Callbacks::LogLine( "File path: \"" + FilePath + "\"" );
+        TRACE_SCOPE( "V32Console::LoadCartridge" );
+        PERF_SCOPE( CartridgeLoad );
+        Callbacks->LogLine( "Loading cartridge" );
+        Callbacks->LogLine( "File path: \"" + FilePath + "\"" );
     
         // unload any previous cartridge
         UnloadCartridge();
         
-        // open cartridge file
-        ifstream InputFile;
-        
-        // on windows convert path from UTF-8 to UTF-16
-        #if defined(__WIN32__)
-          wstring_convert< std::codecvt_utf8_utf16< wchar_t > > converter;
-          wstring FilePathUTF16 = converter.from_bytes(FilePath);
-          InputFile.open( FilePathUTF16.c_str(), ios_base::binary | ios_base::ate );
-        #else
-          InputFile.open( FilePath, ios_base::binary | ios_base::ate );
-        #endif
+        // open cartridge file; it will be kept open
+        // so that textures can be read when needed
+        ifstream& InputFile = CartridgeController.LinkedFile;
+        OpenCartridgeFile( InputFile, FilePath );
         
         if( InputFile.fail() )
-          Callbacks::ThrowException( "Cannot open cartridge file" );
+          Callbacks->ThrowException( "Cannot open cartridge file" );
         
         // - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - -
         // STEP 1: Load global information
@@ -498,11 +559,11 @@ namespace V32
         unsigned FileBytes = InputFile.tellg();
         
         if( (FileBytes % 4) != 0 )
-          Callbacks::ThrowException( "Incorrect V32 file format (file size must be a multiple of 4)" );
+          Callbacks->ThrowException( "Incorrect V32 file format (file size must be a multiple of 4)" );
         
         // ensure that we can at least load the file header
         if( FileBytes < sizeof(ROMFileFormat::Header) )
-          Callbacks::ThrowException( "Incorrect V32 file format (file is too small)" );
+          Callbacks->ThrowException( "Incorrect V32 file format (file is too small)" );
         
         // now we can safely read the global header
         InputFile.seekg( 0, ios_base::beg );
@@ -511,64 +572,124 @@ namespace V32
         
         // check if the ROM is actually a BIOS
         if( CheckSignature( ROMHeader.Signature, ROMFileFormat::BiosSignature ) )
-          Callbacks::ThrowException( "Input V32 ROM cannot be loaded as a cartridge (is it a BIOS instead)" );
+          Callbacks->ThrowException( "Input V32 ROM cannot be loaded as a cartridge (is it a BIOS instead)" );
         
-        // now check the actual cartridge signature
-        if( !CheckSignature( ROMHeader.Signature, ROMFileFormat::CartridgeSignature ) )
-          Callbacks::ThrowException( "Incorrect V32 file format (file does not have a valid signature)" );
+        // now check the actual cartridge signature;
+        // cartridges can also use a compressed format
+        bool IsCompressed = CheckSignature( ROMHeader.Signature, CompressedROMFileFormat::Signature );
+        
+        if( !IsCompressed && !CheckSignature( ROMHeader.Signature, ROMFileFormat::CartridgeSignature ) )
+          Callbacks->ThrowException( "Incorrect V32 file format (file does not have a valid signature)" );
         
         // check current Vircon version
         if( ROMHeader.VirconVersion  > (unsigned)Constants::VirconVersion
         ||  ROMHeader.VirconRevision > (unsigned)Constants::VirconRevision )
-          Callbacks::ThrowException( "This cartridge was made for a more recent version of Vircon32. Please use an updated emulator" );
+          Callbacks->ThrowException( "This cartridge was made for a more recent version of Vircon32. Please use an updated emulator" );
         
         // report the title
         ROMHeader.Title[ 63 ] = 0;
-        Callbacks::LogLine( string("Cartridge title: \"") + ROMHeader.Title + "\"" );
+        Callbacks->LogLine( string("Cartridge title: \"") + ROMHeader.Title + "\"" );
         
         // - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - -
         // STEP 2: Check the declared rom contents
         // - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - -
         
         // check that there are not too many textures
-        Callbacks::LogLine( "Video ROM contains " + to_string( ROMHeader.NumberOfTextures ) + " textures" );
+        Callbacks->LogLine( "Video ROM contains " + to_string( ROMHeader.NumberOfTextures ) + " textures" );
         
         if( ROMHeader.NumberOfTextures > (uint32_t)Constants::GPUMaximumCartridgeTextures )
-          Callbacks::ThrowException( "Video ROM contains too many textures (Vircon GPU only allows up to 256)" );
+          Callbacks->ThrowException( "Video ROM contains too many textures (Vircon GPU only allows up to 256)" );
         
         // check that there are not too many sounds
-        Callbacks::LogLine( "Audio ROM contains " + to_string( ROMHeader.NumberOfSounds ) + " sounds" );
+        Callbacks->LogLine( "Audio ROM contains " + to_string( ROMHeader.NumberOfSounds ) + " sounds" );
         
         if( ROMHeader.NumberOfSounds > (uint32_t)Constants::SPUMaximumCartridgeSounds )
-          Callbacks::ThrowException( "Audio ROM contains too many sounds (Vircon SPU only allows up to 1024)" );
+          Callbacks->ThrowException( "Audio ROM contains too many sounds (Vircon SPU only allows up to 1024)" );
+        
+        // load the ROM contents depending on the format
+        if( IsCompressed )
+          LoadCompressedCartridgeROMs( InputFile, FileBytes, ROMHeader );
+        else
+          LoadCartridgeROMs( InputFile, FileBytes, ROMHeader );
+        
+        // - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - -
+        // STEP 3: General Vircon setup
+        // - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - -
+        
+        // only when loading was successful:
+        // copy cartridge contents information
+        CartridgeController.NumberOfTextures = ROMHeader.NumberOfTextures;
+        CartridgeController.NumberOfSounds = ROMHeader.NumberOfSounds;
+        
+        // copy cartridge metadata
+        CartridgeController.CartridgeTitle = ROMHeader.Title;
+        CartridgeController.CartridgeVersion = ROMHeader.ROMVersion;
+        CartridgeController.CartridgeRevision = ROMHeader.ROMRevision;
+        
+        // do NOT close the input file! leave it open
+        // until cartridge is unloaded, so that textures
+        // can be read from it as they become needed
+        
+        // save the file name
+        CartridgeController.CartridgeFileName = GetPathFileName( FilePath );
+        
+        // the console can now start while assets are decoded;
+        // loaders use their own files to not interfere with
+        // each other or with reads on demand from main thread
+        unsigned NumberOfLoaders = thread::hardware_concurrency();
+        NumberOfLoaders = min( max( NumberOfLoaders, 1u ), 8u );
+        
+        if( NumberOfLoaders > ROMHeader.NumberOfTextures + ROMHeader.NumberOfSounds )
+          NumberOfLoaders = ROMHeader.NumberOfTextures + ROMHeader.NumberOfSounds;
+        
+        Callbacks->LogLine( "Loading cartridge assets with " + to_string( NumberOfLoaders ) + " threads" );
+        AssetLoadersMustStop = false;
+        NextTextureToLoad = 0;
+        NextSoundToLoad = 0;
+        
+        for( unsigned i = 0; i < NumberOfLoaders; i++ )
+          AssetLoaders.push_back( thread( &V32Console::LoadCartridgeAssets, this, FilePath ) );
+        
+        Callbacks->LogLine( "Finished loading cartridge" );
+    }
+    
+    // -----------------------------------------------------------------------------
+    
+    // loads contents for the regular cartridge format, where
+    // all embedded files are placed in sequence with no gaps
+    void V32Console::LoadCartridgeROMs( std::ifstream& InputFile, uint32_t FileBytes, ROMFileFormat::Header& ROMHeader )
+    {
+        // - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - -
+        // STEP 1: Check ROM locations
+        // - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - -
         
         // check for correct program rom location
         if( ROMHeader.ProgramROMLocation.StartOffset != sizeof(ROMFileFormat::Header) )
-          Callbacks::ThrowException( "Incorrect V32 file format (program ROM is not located after file header)" );
+          Callbacks->ThrowException( "Incorrect V32 file format (program ROM is not located after file header)" );
         
         // check for correct video rom location
         uint32_t SizeAfterProgramROM = ROMHeader.ProgramROMLocation.StartOffset + ROMHeader.ProgramROMLocation.Length;
         
         if( ROMHeader.VideoROMLocation.StartOffset != SizeAfterProgramROM )
-          Callbacks::ThrowException( "Incorrect V32 file format (video ROM is not located after program ROM)" );
+          Callbacks->ThrowException( "Incorrect V32 file format (video ROM is not located after program ROM)" );
         
         // check for correct audio rom location
         uint32_t SizeAfterVideoROM = ROMHeader.VideoROMLocation.StartOffset + ROMHeader.VideoROMLocation.Length;
         
         if( ROMHeader.AudioROMLocation.StartOffset != SizeAfterVideoROM )
-          Callbacks::ThrowException( "Incorrect V32 file format (audio ROM is not located after video ROM)" );
+          Callbacks->ThrowException( "Incorrect V32 file format (audio ROM is not located after video ROM)" );
         
         // check for correct file size
         uint32_t SizeAfterAudioROM = ROMHeader.AudioROMLocation.StartOffset + ROMHeader.AudioROMLocation.Length;
         
         if( FileBytes != SizeAfterAudioROM )
-          Callbacks::ThrowException( "Incorrect V32 file format (file size does not match indicated ROM contents)" );
+          Callbacks->ThrowException( "Incorrect V32 file format (file size does not match indicated ROM contents)" );
         
         // - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - -
-        // STEP 3: Load program rom
+        // STEP 2: Load program rom
         // - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - -
         
-        Callbacks::LogLine( "Loading cartridge program ROM" );
+        Callbacks->LogLine( "Loading cartridge program ROM" );
         
         // load a binary file signature
         BinaryFileFormat::Header BinaryHeader;
@@ -576,13 +697,13 @@ namespace V32
         
         // check signature for embedded binary
         if( !CheckSignature( BinaryHeader.Signature, BinaryFileFormat::Signature ) )
-          Callbacks::ThrowException( "Cartridge binary does not have a valid signature" );
+          Callbacks->ThrowException( "Cartridge binary does not have a valid signature" );
         
-        Callbacks::LogLine( "-> Program ROM is " + to_string( BinaryHeader.NumberOfWords ) + " words" );
+        Callbacks->LogLine( "-> Program ROM is " + to_string( BinaryHeader.NumberOfWords ) + " words" );
         
         // check program rom size limitations
         if( !IsBetween( BinaryHeader.NumberOfWords, 1, Constants::MaximumCartridgeProgramROM ) )
-          Callbacks::ThrowException( "Cartridge program ROM does not have a correct size (from 1 word up to 128M words)" );
+          Callbacks->ThrowException( "Cartridge program ROM does not have a correct size (from 1 word up to 128M words)" );
         
         // load the binary contents
         vector< V32Word > LoadedBinary;
@@ -594,12 +715,19 @@ namespace V32
         LoadedBinary.clear();
         
         // - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - -
-        // STEP 4: Load video rom
+        // STEP 3: Load video rom
         // - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - -
         
-        Callbacks::LogLine( "Loading cartridge video ROM" );
+        Callbacks->LogLine( "Loading cartridge video ROM" );
+        
+        // textures will be decoded in the background and
+        // uploaded on first use, so for now just check them
+        // and register their locations within the file; this
+        // only reads small headers, and the position of each
+        // one depends on the previous ones, so it is not split
+        // among the loader threads (they need its results)
+        CartridgeController.TextureLocations.resize( ROMHeader.NumberOfTextures );
         
-        // load all textures in sequence
         for( unsigned i = 0; i < ROMHeader.NumberOfTextures; i++ )
         {
             // load a texture file signature
@@ -608,42 +736,46 @@ namespace V32
             
             // check signature for embedded texture
             if( !CheckSignature( TextureHeader.Signature, TextureFileFormat::Signature ) )
-              Callbacks::ThrowException( "Cartridge texture does not have a valid signature" );
+              Callbacks->ThrowException( "Cartridge texture does not have a valid signature" );
             
             // report texture size
-            Callbacks::LogLine( "-> Texture " + to_string( i ) + ": " + to_string( TextureHeader.TextureWidth )
+            Callbacks->LogLine( "-> Texture " + to_string( i ) + ": " + to_string( TextureHeader.TextureWidth )
                + " x " + to_string( TextureHeader.TextureHeight ) + " pixels" );
             
             // check texture size limitations
             if( !IsBetween( TextureHeader.TextureWidth , 1, Constants::GPUTextureSize )
             ||  !IsBetween( TextureHeader.TextureHeight, 1, Constants::GPUTextureSize ) )
-              Callbacks::ThrowException( "Cartridge texture does not have correct dimensions (1x1 up to 1024x1024 pixels)" );
-            
-            // clear all texture pixels
-            memset( LoadedTexture, 0, sizeof(LoadedTexture) );
+              Callbacks->ThrowException( "Cartridge texture does not have correct dimensions (1x1 up to 1024x1024 pixels)" );
             
-            // load the texture pixels line by line,
-            // in order to expand it to full size
-            for( unsigned y = 0; y < TextureHeader.TextureHeight; y++ )
-              InputFile.read( (char*)(LoadedTexture[ y ]), TextureHeader.TextureWidth * 4 );
+            // register where the pixels are located
+            CartridgeTextureLocation& Location = CartridgeController.TextureLocations[ i ];
+            Location.FileOffset = InputFile.tellg();
+            Location.Width = TextureHeader.TextureWidth;
+            Location.Height = TextureHeader.TextureHeight;
+            Location.StoredLength = Location.Width * Location.Height * 4;
+            Location.Codec = (uint32_t)CompressedROMFileFormat::Codecs::Raw;
             
-            // send this texture to the video library
-            Callbacks::LoadTexture( i, LoadedTexture );
+            // skip the texture pixels
+            InputFile.seekg( Location.Width * Location.Height * 4, ios_base::cur );
         }
         
         // now update GPU with the inserted textures
         GPU.InsertCartridgeTextures( ROMHeader.NumberOfTextures );
         
         // - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - -
-        // STEP 5: Load audio rom
+        // STEP 4: Load audio rom
         // - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - -
         
-        Callbacks::LogLine( "Loading cartridge audio ROM" );
+        Callbacks->LogLine( "Loading cartridge audio ROM" );
+        
+        // sound samples will be read in the background
+        // so for now just check them and register their
+        // locations within the file
+        CartridgeController.SoundLocations.resize( ROMHeader.NumberOfSounds );
         
         // keep count of the total sound samples
         uint32_t TotalSPUSamples = 0;
         
-        // load all sounds in sequence
         for( unsigned i = 0; i < ROMHeader.NumberOfSounds; i++ )
         {
             // load a sound file signature
@@ -652,65 +784,304 @@ namespace V32
             
             // check signature for embedded sound
             if( !CheckSignature( SoundHeader.Signature, SoundFileFormat::Signature ) )
-              Callbacks::ThrowException( "Cartridge sound does not have a valid signature" );
+              Callbacks->ThrowException( "Cartridge sound does not have a valid signature" );
             
             // report sound length
-            Callbacks::LogLine( "-> Sound " + to_string( i ) + ": " + to_string( SoundHeader.SoundSamples )
+            Callbacks->LogLine( "-> Sound " + to_string( i ) + ": " + to_string( SoundHeader.SoundSamples )
                + " samples (" + to_string( SoundHeader.SoundSamples/44100.0f ) + " seconds)" );
             
             // check length limitations for this sound
             if( !IsBetween( SoundHeader.SoundSamples, 1, Constants::SPUMaximumCartridgeSamples ) )
-              Callbacks::ThrowException( "Cartridge sound does not have correct length (1 up to 256M samples)" );
+              Callbacks->ThrowException( "Cartridge sound does not have correct length (1 up to 256M samples)" );
             
             // check length limitations for the whole SPU
             TotalSPUSamples += SoundHeader.SoundSamples;
             
             if( TotalSPUSamples > (uint32_t)Constants::SPUMaximumCartridgeSamples )
-              Callbacks::ThrowException( "Cartridge sounds contain too many total samples (Vircon SPU only allows up to 256M total samples)" );
+              Callbacks->ThrowException( "Cartridge sounds contain too many total samples (Vircon SPU only allows up to 256M total samples)" );
             
-            // load the sound samples
-            vector< SPUSample > LoadedSound;
-            LoadedSound.resize( SoundHeader.SoundSamples );
-            InputFile.read( (char*)(&LoadedSound[ 0 ]), SoundHeader.SoundSamples * 4 );
+            // register where the samples are located
+            CartridgeSoundLocation& Location = CartridgeController.SoundLocations[ i ];
+            Location.FileOffset = InputFile.tellg();
+            Location.Samples = SoundHeader.SoundSamples;
+            Location.StoredLength = Location.Samples * 4;
+            Location.Codec = (uint32_t)CompressedROMFileFormat::Codecs::Raw;
             
-            // create a new SPU sound and load data into it
-            SPU.LoadSound( SPU.CartridgeSounds[ i ], &LoadedSound[ 0 ], SoundHeader.SoundSamples );
+            // create a new SPU sound, still without samples
+            SPU.DeclareSound( SPU.CartridgeSounds[ i ], SoundHeader.SoundSamples );
             
-            // discard the temporary buffer
-            LoadedSound.clear();
+            // skip the sound samples
+            InputFile.seekg( Location.Samples * 4, ios_base::cur );
         }
         
         SPU.LoadedCartridgeSounds = ROMHeader.NumberOfSounds;
+        SPU.SetCartridgeSoundsPending( ROMHeader.NumberOfSounds );
+    }
+    
+    // -----------------------------------------------------------------------------
+    
+    // loads contents for the compressed cartridge format; only
+    // the embedded file headers are read here, while the data
+    // for textures and sounds will be decoded when needed
+    void V32Console::LoadCompressedCartridgeROMs( std::ifstream& InputFile, uint32_t FileBytes, ROMFileFormat::Header& ROMHeader )
+    {
+        // both formats share the header layout up to the ROM locations
+        CompressedROMFileFormat::Header CompressedHeader;
+        memcpy( &CompressedHeader, &ROMHeader, sizeof(CompressedROMFileFormat::Header) );
         
         // - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - -
-        // STEP 5: General Vircon setup
+        // STEP 1: Load table of contents
         // - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - -
         
-        // only when loading was successful:
-        // copy cartridge contents information
-        CartridgeController.NumberOfTextures = ROMHeader.NumberOfTextures;
-        CartridgeController.NumberOfSounds = ROMHeader.NumberOfSounds;
+        Callbacks->LogLine( "Cartridge uses the compressed format" );
         
-        // copy cartridge metadata
-        CartridgeController.CartridgeTitle = ROMHeader.Title;
-        CartridgeController.CartridgeVersion = ROMHeader.ROMVersion;
-        CartridgeController.CartridgeRevision = ROMHeader.ROMRevision;
+        // there is a chunk for each of the embedded files
+        uint32_t NumberOfChunks = 1 + ROMHeader.NumberOfTextures + ROMHeader.NumberOfSounds;
+        const ROMFileFormat::SectionLocation& TOCLocation = CompressedHeader.TableOfContentsLocation;
         
-        // finally, close input file
-        InputFile.close();
+        if( TOCLocation.Length != NumberOfChunks * sizeof(CompressedROMFileFormat::ChunkLocation) )
+          Callbacks->ThrowException( "Incorrect V32 file format (table of contents does not match indicated ROM contents)" );
         
-        // save the file name
-        CartridgeController.CartridgeFileName = GetPathFileName( FilePath );
-        Callbacks::LogLine( "Finished loading cartridge" );
+        if( (uint64_t)TOCLocation.StartOffset + TOCLocation.Length > FileBytes )
+          Callbacks->ThrowException( "Incorrect V32 file format (table of contents is out of file limits)" );
+        
+        vector< CompressedROMFileFormat::ChunkLocation > Chunks;
+        Chunks.resize( NumberOfChunks );
+        InputFile.seekg( TOCLocation.StartOffset, ios_base::beg );
+        InputFile.read( (char*)(&Chunks[ 0 ]), TOCLocation.Length );
+        
+        // all chunks must be within the file and
+        // have room at least for their file header
+        for( const CompressedROMFileFormat::ChunkLocation& Chunk: Chunks )
+          if( (uint64_t)Chunk.StartOffset + Chunk.Length > FileBytes
+          ||  Chunk.Length < sizeof(BinaryFileFormat::Header) )
+            Callbacks->ThrowException( "Incorrect V32 file format (a chunk is out of file limits)" );
+        
+        // - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - -
+        // STEP 2: Load program rom
+        // - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - -
+        
+        Callbacks->LogLine( "Loading cartridge program ROM" );
+        
+        // load a binary file signature
+        const CompressedROMFileFormat::ChunkLocation& BinaryChunk = Chunks[ 0 ];
+        BinaryFileFormat::Header BinaryHeader;
+        InputFile.seekg( BinaryChunk.StartOffset, ios_base::beg );
+        InputFile.read( (char*)(&BinaryHeader), sizeof(BinaryFileFormat::Header) );
+        
+        // check signature for embedded binary
+        if( !CheckSignature( BinaryHeader.Signature, BinaryFileFormat::Signature ) )
+          Callbacks->ThrowException( "Cartridge binary does not have a valid signature" );
+        
+        Callbacks->LogLine( "-> Program ROM is " + to_string( BinaryHeader.NumberOfWords ) + " words" );
+        
+        // check program rom size limitations
+        if( !IsBetween( BinaryHeader.NumberOfWords, 1, Constants::MaximumCartridgeProgramROM )
+        ||  BinaryChunk.DecodedLength != BinaryHeader.NumberOfWords * 4 )
+          Callbacks->ThrowException( "Cartridge program ROM does not have a correct size (from 1 word up to 128M words)" );
+        
+        // decode the binary contents
+        vector< V32Word > LoadedBinary;
+        LoadedBinary.resize( BinaryHeader.NumberOfWords );
+        
+        if( !V32CartridgeController::ReadStoredData( InputFile, BinaryChunk.StartOffset + sizeof(BinaryFileFormat::Header),
+          BinaryChunk.Length - sizeof(BinaryFileFormat::Header), BinaryChunk.Codec, &LoadedBinary[ 0 ], BinaryChunk.DecodedLength ) )
+          Callbacks->ThrowException( "Cartridge program ROM cannot be decoded" );
+        
+        CartridgeController.Connect( &LoadedBinary[ 0 ], BinaryHeader.NumberOfWords );
+        
+        // discard the temporary buffer
+        LoadedBinary.clear();
+        
+        // - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - -
+        // STEP 3: Load video rom
+        // - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - -
+        
+        Callbacks->LogLine( "Loading cartridge video ROM" );
+        
+        // textures will be decoded in the background
+        // and uploaded on first use
+        CartridgeController.TextureLocations.resize( ROMHeader.NumberOfTextures );
+        
+        for( unsigned i = 0; i < ROMHeader.NumberOfTextures; i++ )
+        {
+            const CompressedROMFileFormat::ChunkLocation& TextureChunk = Chunks[ 1 + i ];
+            
+            if( TextureChunk.Length < sizeof(TextureFileFormat::Header) )
+              Callbacks->ThrowException( "Incorrect V32 file format (a chunk is out of file limits)" );
+            
+            // load a texture file signature
+            TextureFileFormat::Header TextureHeader;
+            InputFile.seekg( TextureChunk.StartOffset, ios_base::beg );
+            InputFile.read( (char*)(&TextureHeader), sizeof(TextureFileFormat::Header) );
+            
+            // check signature for embedded texture
+            if( !CheckSignature( TextureHeader.Signature, TextureFileFormat::Signature ) )
+              Callbacks->ThrowException( "Cartridge texture does not have a valid signature" );
+            
+            // report texture size
+            Callbacks->LogLine( "-> Texture " + to_string( i ) + ": " + to_string( TextureHeader.TextureWidth )
+               + " x " + to_string( TextureHeader.TextureHeight ) + " pixels" );
+            
+            // check texture size limitations
+            if( !IsBetween( TextureHeader.TextureWidth , 1, Constants::GPUTextureSize )
+            ||  !IsBetween( TextureHeader.TextureHeight, 1, Constants::GPUTextureSize )
+            ||  TextureChunk.DecodedLength != TextureHeader.TextureWidth * TextureHeader.TextureHeight * 4 )
+              Callbacks->ThrowException( "Cartridge texture does not have correct dimensions (1x1 up to 1024x1024 pixels)" );
+            
+            // register where the encoded pixels are located
+            CartridgeTextureLocation& Location = CartridgeController.TextureLocations[ i ];
+            Location.FileOffset = TextureChunk.StartOffset + sizeof(TextureFileFormat::Header);
+            Location.StoredLength = TextureChunk.Length - sizeof(TextureFileFormat::Header);
+            Location.Codec = TextureChunk.Codec;
+            Location.Width = TextureHeader.TextureWidth;
+            Location.Height = TextureHeader.TextureHeight;
+        }
+        
+        // now update GPU with the inserted textures
+        GPU.InsertCartridgeTextures( ROMHeader.NumberOfTextures );
+        
+        // - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - -
+        // STEP 4: Load audio rom
+        // - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - -
+        
+        Callbacks->LogLine( "Loading cartridge audio ROM" );
+        
+        // sound samples will be decoded in the background
+        CartridgeController.SoundLocations.resize( ROMHeader.NumberOfSounds );
+        
+        // keep count of the total sound samples
+        uint32_t TotalSPUSamples = 0;
+        
+        for( unsigned i = 0; i < ROMHeader.NumberOfSounds; i++ )
+        {
+            const CompressedROMFileFormat::ChunkLocation& SoundChunk = Chunks[ 1 + ROMHeader.NumberOfTextures + i ];
+            
+            // load a sound file signature
+            SoundFileFormat::Header SoundHeader;
+            InputFile.seekg( SoundChunk.StartOffset, ios_base::beg );
+            InputFile.read( (char*)(&SoundHeader), sizeof(SoundFileFormat::Header) );
+            
+            // check signature for embedded sound
+            if( !CheckSignature( SoundHeader.Signature, SoundFileFormat::Signature ) )
+              Callbacks->ThrowException( "Cartridge sound does not have a valid signature" );
+            
+            // report sound length
+            Callbacks->LogLine( "-> Sound " + to_string( i ) + ": " + to_string( SoundHeader.SoundSamples )
+               + " samples (" + to_string( SoundHeader.SoundSamples/44100.0f ) + " seconds)" );
+            
+            // check length limitations for this sound
+            if( !IsBetween( SoundHeader.SoundSamples, 1, Constants::SPUMaximumCartridgeSamples )
+            ||  SoundChunk.DecodedLength != SoundHeader.SoundSamples * 4 )
+              Callbacks->ThrowException( "Cartridge sound does not have correct length (1 up to 256M samples)" );
+            
+            // check length limitations for the whole SPU
+            TotalSPUSamples += SoundHeader.SoundSamples;
+            
+            if( TotalSPUSamples > (uint32_t)Constants::SPUMaximumCartridgeSamples )
+              Callbacks->ThrowException( "Cartridge sounds contain too many total samples (Vircon SPU only allows up to 256M total samples)" );
+            
+            // register where the encoded samples are located
+            CartridgeSoundLocation& Location = CartridgeController.SoundLocations[ i ];
+            Location.FileOffset = SoundChunk.StartOffset + sizeof(SoundFileFormat::Header);
+            Location.StoredLength = SoundChunk.Length - sizeof(SoundFileFormat::Header);
+            Location.Codec = SoundChunk.Codec;
+            Location.Samples = SoundHeader.SoundSamples;
+            
+            // create a new SPU sound, still without samples
+            SPU.DeclareSound( SPU.CartridgeSounds[ i ], SoundHeader.SoundSamples );
+        }
+        
+        SPU.LoadedCartridgeSounds = ROMHeader.NumberOfSounds;
+        SPU.SetCartridgeSoundsPending( ROMHeader.NumberOfSounds );
+    }
+
+    // -----------------------------------------------------------------------------
+    
+    // runs on each of the background loader threads; every
+    // one of them takes the next texture not taken, and then
+    // the next sound; only pixels and samples are decoded
+    // here, since the video library can only be used from
+    // the main thread when textures are first drawn
+    void V32Console::LoadCartridgeAssets( std::string FilePath )
+    {
+        ifstream InputFile;
+        OpenCartridgeFile( InputFile, FilePath );
+        
+        // textures go first, since games draw most of them early;
+        // when too much memory is used by decoded textures that
+        // were not drawn yet, the rest are read on demand
+        while( !AssetLoadersMustStop )
+        {
+            unsigned i = NextTextureToLoad++;
+            
+            if( i >= GPU.LoadedCartridgeTextures )
+              break;
+            
+            const CartridgeTextureLocation& Location = CartridgeController.TextureLocations[ i ];
+            uint32_t DecodedBytes = Location.Width * Location.Height * sizeof(GPUColor);
+            
+            // skip textures already read on demand, or
+            // that don't fit in the memory still available
+            if( !GPU.ClaimCartridgeTexture( i, DecodedBytes ) )
+              continue;
+            
+            // on failure the texture will just be transparent
+            vector< GPUColor > DecodedPixels;
+            
+            if( !CartridgeController.ReadTexture( i, DecodedPixels, InputFile ) )
+              Callbacks->LogLine( "ERROR: Cannot read cartridge texture " + to_string( i ) );
+            
+            GPU.FinishCartridgeTexture( i, DecodedPixels );
+        }
+        
+        while( !AssetLoadersMustStop )
+        {
+            unsigned i = NextSoundToLoad++;
+            
+            if( i >= SPU.LoadedCartridgeSounds )
+              return;
+            
+            // skip sounds already loaded on demand
+            if( !SPU.ClaimCartridgeSound( i ) )
+              continue;
+            
+            // on failure the sound will just be silent
+            vector< SPUSample > LoadedSound;
+            
+            if( !CartridgeController.ReadSound( i, LoadedSound, InputFile ) )
+              Callbacks->LogLine( "ERROR: Cannot read cartridge sound " + to_string( i ) );
+            
+            SPU.FinishCartridgeSound( i, LoadedSound );
+        }
+    }
+    
+    // -----------------------------------------------------------------------------
+    
+    void V32Console::StopLoadingCartridgeAssets()
+    {
+        AssetLoadersMustStop = true;
+        
+        for( thread& Loader: AssetLoaders )
+          Loader.join();
+        
+        AssetLoaders.clear();
     }
     
     // -----------------------------------------------------------------------------
     
     void V32Console::UnloadCartridge()
     {
-        // do nothing if a cartridge is not loaded
+        // a failed load can leave the file open with
+        // no cartridge, and then it could not be reopened
+        CartridgeController.LinkedFile.close();
+        
+        // do nothing else if a cartridge is not loaded
         if( !HasCartridge() ) return;
-        Callbacks::LogLine( "Unloading cartridge" );
+        Callbacks->LogLine( "Unloading cartridge" );
+        
+        // assets may still be loading
+        StopLoadingCartridgeAssets();
         
         // release cartridge program ROM
         CartridgeController.Disconnect();
@@ -721,12 +1092,15 @@ namespace V32
         
         // tell GPU to release all cartridge textures
         GPU.RemoveCartridgeTextures();
+        CartridgeController.TextureLocations.clear();
         
         // tell SPU to release all cartridge sounds
         for( int i = 0; i < Constants::SPUMaximumCartridgeSounds; i++ )
           SPU.UnloadSound( SPU.CartridgeSounds[ i ] );
         
         SPU.LoadedCartridgeSounds = 0;
+        SPU.SetCartridgeSoundsPending( 0 );
+        CartridgeController.SoundLocations.clear();
     }
     
     // -----------------------------------------------------------------------------
@@ -758,8 +1132,8 @@ namespace V32
     
     void V32Console::CreateMemoryCard( const std::string& FilePath )
     {
-        Callbacks::LogLine( "Creating memory card" );
-        Callbacks::LogLine( "File path: \"" + FilePath + "\"" );
+        Callbacks->LogLine( "Creating memory card" );
+        Callbacks->LogLine( "File path: \"" + FilePath + "\"" );
         
         // open the file
         ofstream OutputFile;
@@ -774,7 +1148,7 @@ namespace V32
         #endif
         
         if( OutputFile.fail() )
-          Callbacks::ThrowException( "Cannot create memory card file" );
+          Callbacks->ThrowException( "Cannot create memory card file" );
         
         // save the signature
         WriteSignature( OutputFile, MemoryCardFileFormat::Signature );
@@ -786,15 +1160,15 @@ namespace V32
         
         // close the file
         OutputFile.close();
-        Callbacks::LogLine( "Finished creating memory card" );
+        Callbacks->LogLine( "Finished creating memory card" );
     }
     
     // -----------------------------------------------------------------------------
     
     void V32Console::LoadMemoryCard( const std::string& FilePath )
     {
-        Callbacks::LogLine( "Loading memory card" );
-        Callbacks::LogLine( "File path: \"" + FilePath + "\"" );
+        Callbacks->LogLine( "Loading memory card" );
+        Callbacks->LogLine( "File path: \"" + FilePath + "\"" );
     
         // unload any previous card
         UnloadMemoryCard();
@@ -812,7 +1186,7 @@ namespace V32
         #endif
         
         if( InputFile.fail() )
-          Callbacks::ThrowException( "Cannot open memory card file" );
+          Callbacks->ThrowException( "Cannot open memory card file" );
         
         // check file size coherency
         int NumberOfBytes = InputFile.tellg();
@@ -821,7 +1195,7 @@ namespace V32
         if( NumberOfBytes != ExpectedBytes )
         {
             InputFile.close();
-            Callbacks::ThrowException( "Invalid memory card: File does not match the size of a Vircon memory card" );
+            Callbacks->ThrowException( "Invalid memory card: File does not match the size of a Vircon memory card" );
         }
         
         // read and check signature
@@ -830,7 +1204,7 @@ namespace V32
         InputFile.read( FileSignature, 8 );
         
         if( !CheckSignature( FileSignature, MemoryCardFileFormat::Signature ) )
-          Callbacks::ThrowException( "Memory card file does not have a valid signature" );
+          Callbacks->ThrowException( "Memory card file does not have a valid signature" );
         
         // connect the memory
         MemoryCardController.Connect( Constants::MemoryCardSize );
@@ -841,10 +1215,46 @@ namespace V32
         // do NOT close the file! leave it open until
         // card is unloaded or emulation is stopped,
         // so that it can be saved if card is modified
+        // (from now on, it is written in background)
+        MemoryCardController.StartWriter();
         
         // save the file name
         MemoryCardController.CardFileName = GetPathFileName( FilePath );
-        Callbacks::LogLine( "Finished loading memory card" );
+        Callbacks->LogLine( "Finished loading memory card" );
+    }
+    
+    // -----------------------------------------------------------------------------
+    
+    // connects an empty card that is not linked to any file;
+    // this is used when card contents are saved externally
+    void V32Console::ConnectMemoryCard()
+    {
+        Callbacks->LogLine( "Connecting memory card with no file" );
+        
+        // unload any previous card
+        UnloadMemoryCard();
+        
+        MemoryCardController.Connect( Constants::MemoryCardSize );
+        MemoryCardController.UnsavedPages.assign( MemoryCardController.WrittenPages.size(), 0 );
+        MemoryCardController.CardFileName = "";
+    }
+    
+    // -----------------------------------------------------------------------------
+    
+    // keeps the card connected with its current contents,
+    // but they will no longer be saved to the card file
+    void V32Console::UnlinkMemoryCardFile()
+    {
+        // do nothing if a card is not loaded
+        if( !HasMemoryCard() ) return;
+        
+        // save the card if it was modified
+        if( MemoryCardController.PendingSave )
+          SaveMemoryCard();
+        
+        MemoryCardController.StopWriter();
+        MemoryCardController.LinkedFile.close();
+        MemoryCardController.CardFileName = "";
     }
     
     // -----------------------------------------------------------------------------
@@ -853,40 +1263,46 @@ namespace V32
     {
         // do nothing if a card is not loaded
         if( !HasMemoryCard() ) return;
-        Callbacks::LogLine( "Unloading memory card" );
+        Callbacks->LogLine( "Unloading memory card" );
         
         // save the card if it was modified
         if( MemoryCardController.PendingSave )
           SaveMemoryCard();
         
+        // wait for all writes to reach the file
+        MemoryCardController.StopWriter();
+        
         // remove the card memory
         MemoryCardController.Disconnect();
         
         // close the open file
         MemoryCardController.LinkedFile.close();
-        Callbacks::LogLine( "Finished unloading memory card" );
+        Callbacks->LogLine( "Finished unloading memory card" );
     }
     
     // -----------------------------------------------------------------------------
     
     void V32Console::SaveMemoryCard()
     {
-        // do nothing if a card is not loaded
-        if( !HasMemoryCard() ) return;
-        
-        // check the file
-        fstream& OutputFile = MemoryCardController.LinkedFile;
-        
-        if( !OutputFile.is_open() || OutputFile.fail() )
-          Callbacks::ThrowException( "Cannot save memory card file" );
+        TRACE_SCOPE( "V32Console::SaveMemoryCard" );
         
-        // save the signature
-        OutputFile.seekp( ios_base::beg );
-        WriteSignature( OutputFile, MemoryCardFileFormat::Signature );
+        // do nothing if a card is not loaded,
+        // or if it is not linked to a file
+        if( !HasMemoryCard() ) return;
+        if( !MemoryCardController.IsWriterRunning() ) return;
         
-        // now save all contents
-        OutputFile.write( (char*)(&MemoryCardController.Memory[ 0 ]), Constants::MemoryCardSize * 4 );
+        // only modified pages are saved, and the
+        // file is written by a background thread
+        MemoryCardController.QueueUnsavedPages();
         MemoryCardController.PendingSave = false;
+        MemoryCardController.FramesSinceModified = 0;
+    }
+    
+    // -----------------------------------------------------------------------------
+    
+    void V32Console::SetMemoryCardSaveDelay( int32_t Frames )
+    {
+        MemoryCardController.SaveDelayFrames = max( 0, Frames );
     }
     
     // -----------------------------------------------------------------------------
@@ -3,6 +3,9 @@
     #ifndef V32CONSOLE_HPP
     #define V32CONSOLE_HPP
     
+    // include common Vircon32 headers
+    #include "../VirconDefinitions/FileFormats.hpp"
+    
     // include console logic headers
     #include "V32CPU.hpp"
     #include "V32GPU.hpp"
@@ -14,9 +17,14 @@
     #include "V32CartridgeController.hpp"
     #include "V32MemoryCardController.hpp"
     #include "V32NullController.hpp"
+    #include "V32Digest.hpp"
     
     // include C/C++ headers
     #include <string>         // [ C++ STL ] Strings
+    #include <fstream>        // [ C++ STL ] File streams
+    #include <vector>         // [ C++ STL ] Vectors
+    #include <thread>         // [ C++ STL ] Threads
+    #include <atomic>         // [ C++ STL ] Atomic variables
 // *****************************************************************************
 
 
@@ -50,6 +58,9 @@ namespace V32
             V32RAM RAM;
             V32ROM BiosProgramROM;
             
+            // connection with the program running the console
+            ConsoleCallbacks* Callbacks;
+            
             // internal state
             bool PowerIsOn;
             
@@ -57,12 +68,22 @@ namespace V32
             float LastCPULoads[ 2 ];
             float LastGPULoads[ 2 ];
             
+            // background loading of cartridge assets
+            std::vector< std::thread > AssetLoaders;
+            std::atomic< unsigned > NextTextureToLoad;
+            std::atomic< unsigned > NextSoundToLoad;
+            std::atomic< bool > AssetLoadersMustStop;
+            
         public:
             
             // instance handling
             V32Console();
            ~V32Console();
             
+            // must be called before any other function
+            // (it can also be changed at any later time)
+            void SetCallbacks( ConsoleCallbacks* NewCallbacks );
+            
             // - - - - - - - - - - - - - - - - - - - - - - - -
             //   EXTERNAL INTERFACES: API FUNCTIONS
             // - - - - - - - - - - - - - - - - - - - - - - - -
@@ -72,11 +93,20 @@ namespace V32
             void Reset();
             void RunNextFrame( bool FrameSkipped );
             
+            // while set, frames run normally but the screen
+            // is neither cleared nor drawn to (for frameskip)
+            void SetDrawingSuppressed( bool Suppressed );
+            
+            // while set, frames run normally but the memory
+            // card is not saved to its file (for run-ahead)
+            void SetMemoryCardSavesSuppressed( bool Suppressed );
+            
             // general status queries
             bool IsPowerOn();
             bool IsCPUHalted();
             float GetCPULoad();
             float GetGPULoad();
+            FrameDigest GetFrameDigest();
             
             // bios management
             // (bios cannot be unloaded, but some implementations may need it)
@@ -93,11 +123,22 @@ namespace V32
             std::string GetCartridgeFileName();
             std::string GetCartridgeTitle();
             
+            // cartridge loading for each format
+            void LoadCartridgeROMs( std::ifstream& InputFile, uint32_t FileBytes, ROMFileFormat::Header& ROMHeader );
+            void LoadCompressedCartridgeROMs( std::ifstream& InputFile, uint32_t FileBytes, ROMFileFormat::Header& ROMHeader );
+            
+            // cartridge loading in background
+            void LoadCartridgeAssets( std::string FilePath );
+            void StopLoadingCartridgeAssets();
+            
             // memory card management
             void CreateMemoryCard( const std::string& FilePath );
             void LoadMemoryCard( const std::string& FilePath );
+            void ConnectMemoryCard();
+            void UnlinkMemoryCardFile();
             void UnloadMemoryCard();
             void SaveMemoryCard();
+            void SetMemoryCardSaveDelay( int32_t Frames );
             bool HasMemoryCard();
             bool WasMemoryCardModified();
             std::string GetMemoryCardFileName();
@@ -0,0 +1,280 @@
+// *****************************************************************************
+    // include console logic headers
+    #include "V32Console.hpp"
+    #include "V32Digest.hpp"
+    
+    // include C/C++ headers
+    #include <cstring>          // [ ANSI C ] Strings
+    #include <vector>           // [ C++ STL ] Vectors
+    
+    // include SIMD headers for the available instruction set
+    #if defined(__SSE2__) || defined(_M_X64)
+      #include <emmintrin.h>    // [ x86 ] SSE2 intrinsics
+      #define DIGEST_SSE2
+    #elif defined(__ARM_NEON) && defined(__aarch64__)
+      #include <arm_neon.h>     // [ ARM ] NEON intrinsics
+      #define DIGEST_NEON
+    #endif
+    
+    // declare used namespaces
+    using namespace std;
+// *****************************************************************************
+
+
+namespace V32
+{
+    // =============================================================================
+    //      HASH CONSTANTS
+    // =============================================================================
+    
+    
+    const uint64_t Prime1 = 0x9E3779B185EBCA87ULL;
+    const uint64_t Prime2 = 0xC2B2AE3D27D4EB4FULL;
+    const uint64_t Prime3 = 0x165667B19E3779F9ULL;
+    const uint64_t Prime4 = 0x85EBCA77C2B2AE63ULL;
+    const uint64_t Prime5 = 0x27D4EB2F165667C5ULL;
+    
+    // -----------------------------------------------------------------------------
+    
+    // each lane of a stripe is mixed with its own key
+    alignas( 16 ) static const uint64_t StripeKeys[ 8 ] =
+    {
+        0xBE4BA423396CFEB8ULL, 0x1CAD21F72C81017CULL,
+        0xDB979083E96DD4DEULL, 0x1F67B3B7A4A44072ULL,
+        0x78E5C0CC4EE679CBULL, 0x2172FFCC7DD05A82ULL,
+        0x8E2443F7744608B8ULL, 0x4C263A81E69035E0ULL
+    };
+    
+    // lanes are scrambled after each block of stripes
+    const size_t StripeBytes = 64;
+    const size_t StripesPerBlock = 16;
+    
+    
+    // =============================================================================
+    //      HASH KERNELS
+    // =============================================================================
+    
+    
+    static inline uint64_t RotateLeft( uint64_t Value, int Bits )
+    {
+        return (Value << Bits) | (Value >> (64 - Bits));
+    }
+    
+    // -----------------------------------------------------------------------------
+    
+    // for each lane: add the data to the neighbour lane,
+    // and the product of the 2 halves of data ^ key
+    static void AccumulateStripes( uint64_t* Lanes, const uint8_t* Data, size_t Stripes )
+    {
+        #if defined(DIGEST_SSE2)
+        
+          __m128i Accumulators[ 4 ];
+          
+          for( int i = 0; i < 4; i++ )
+            Accumulators[ i ] = _mm_loadu_si128( (const __m128i*)(Lanes + 2*i) );
+          
+          for( size_t s = 0; s < Stripes; s++, Data += StripeBytes )
+            for( int i = 0; i < 4; i++ )
+            {
+                __m128i Words = _mm_loadu_si128( (const __m128i*)(Data + 16*i) );
+                __m128i Keyed = _mm_xor_si128( Words, _mm_load_si128( (const __m128i*)(StripeKeys + 2*i) ) );
+                __m128i KeyedHigh = _mm_shuffle_epi32( Keyed, _MM_SHUFFLE( 0, 3, 0, 1 ) );
+                __m128i Product = _mm_mul_epu32( Keyed, KeyedHigh );
+                __m128i Swapped = _mm_shuffle_epi32( Words, _MM_SHUFFLE( 1, 0, 3, 2 ) );
+                Accumulators[ i ] = _mm_add_epi64( Accumulators[ i ], _mm_add_epi64( Product, Swapped ) );
+            }
+          
+          for( int i = 0; i < 4; i++ )
+            _mm_storeu_si128( (__m128i*)(Lanes + 2*i), Accumulators[ i ] );
+        
+        #elif defined(DIGEST_NEON)
+        
+          uint64x2_t Accumulators[ 4 ];
+          
+          for( int i = 0; i < 4; i++ )
+            Accumulators[ i ] = vld1q_u64( Lanes + 2*i );
+          
+          for( size_t s = 0; s < Stripes; s++, Data += StripeBytes )
+            for( int i = 0; i < 4; i++ )
+            {
+                uint64x2_t Words = vreinterpretq_u64_u8( vld1q_u8( Data + 16*i ) );
+                uint64x2_t Keyed = veorq_u64( Words, vld1q_u64( StripeKeys + 2*i ) );
+                uint64x2_t Product = vmull_u32( vmovn_u64( Keyed ), vshrn_n_u64( Keyed, 32 ) );
+                uint64x2_t Swapped = vextq_u64( Words, Words, 1 );
+                Accumulators[ i ] = vaddq_u64( Accumulators[ i ], vaddq_u64( Product, Swapped ) );
+            }
+          
+          for( int i = 0; i < 4; i++ )
+            vst1q_u64( Lanes + 2*i, Accumulators[ i ] );
+        
+        #else
+        
+          for( size_t s = 0; s < Stripes; s++, Data += StripeBytes )
+            for( int i = 0; i < 8; i++ )
+            {
+                uint64_t Word;
+                memcpy( &Word, Data + 8*i, sizeof(uint64_t) );
+                
+                uint64_t Keyed = Word ^ StripeKeys[ i ];
+                Lanes[ i ^ 1 ] += Word;
+                Lanes[ i ] += (Keyed & 0xFFFFFFFF) * (Keyed >> 32);
+            }
+        
+        #endif
+    }
+    
+    // -----------------------------------------------------------------------------
+    
+    // keeps the high bits of lanes in play, since
+    // accumulation only propagates carries upwards
+    static void ScrambleLanes( uint64_t* Lanes )
+    {
+        for( int i = 0; i < 8; i++ )
+        {
+            uint64_t Lane = Lanes[ i ];
+            Lane ^= Lane >> 47;
+            Lane ^= RotateLeft( StripeKeys[ i ], 32 );
+            Lanes[ i ] = Lane * 0x9E3779B1ULL;
+        }
+    }
+    
+    // -----------------------------------------------------------------------------
+    
+    static uint64_t Avalanche( uint64_t Hash )
+    {
+        Hash ^= Hash >> 33;
+        Hash *= Prime2;
+        Hash ^= Hash >> 29;
+        Hash *= Prime3;
+        Hash ^= Hash >> 32;
+        return Hash;
+    }
+    
+    
+    // =============================================================================
+    //      HASH FUNCTION
+    // =============================================================================
+    
+    
+    uint64_t HashBytes( const void* Data, size_t Bytes, uint64_t Seed )
+    {
+        uint64_t Lanes[ 8 ] =
+        {
+            Prime1 + Seed, Prime2, Prime3, Prime4,
+            Prime5, Prime1 ^ Seed, Prime2 ^ Seed, Prime3 - Seed
+        };
+        
+        const uint8_t* Position = (const uint8_t*)Data;
+        size_t Stripes = Bytes / StripeBytes;
+        
+        // full blocks
+        while( Stripes >= StripesPerBlock )
+        {
+            AccumulateStripes( Lanes, Position, StripesPerBlock );
+            ScrambleLanes( Lanes );
+            Position += StripesPerBlock * StripeBytes;
+            Stripes -= StripesPerBlock;
+        }
+        
+        // remaining full stripes
+        AccumulateStripes( Lanes, Position, Stripes );
+        Position += Stripes * StripeBytes;
+        
+        // the last partial stripe is padded with zeroes
+        // (the length is part of the result, so padding
+        // cannot be confused with actual zeroes)
+        size_t RemainingBytes = Bytes % StripeBytes;
+        
+        if( RemainingBytes > 0 )
+        {
+            uint8_t LastStripe[ StripeBytes ] = { 0 };
+            memcpy( LastStripe, Position, RemainingBytes );
+            AccumulateStripes( Lanes, LastStripe, 1 );
+        }
+        
+        // merge all lanes
+        uint64_t Hash = Seed + Bytes * Prime5;
+        
+        for( int i = 0; i < 8; i++ )
+        {
+            Hash ^= RotateLeft( Lanes[ i ] * Prime2, 31 ) * Prime1;
+            Hash = RotateLeft( Hash, 27 ) * Prime1 + Prime4;
+        }
+        
+        return Avalanche( Hash );
+    }
+    
+    
+    // =============================================================================
+    //      V32 CONSOLE: STATE DIGESTS
+    // =============================================================================
+    
+    
+    // pages never written since RAM was cleared are all
+    // zeroes, so their hash is only calculated once
+    static uint64_t GetZeroPageHash()
+    {
+        static const vector< V32Word > ZeroPage( RAMPageSize );
+        static const uint64_t ZeroPageHash = HashBytes( &ZeroPage[ 0 ], RAMPageSize * sizeof(V32Word) );
+        return ZeroPageHash;
+    }
+    
+    // -----------------------------------------------------------------------------
+    
+    FrameDigest V32Console::GetFrameDigest()
+    {
+        FrameDigest Digest;
+        
+        // RAM is hashed by pages, and then all page hashes
+        // are hashed in order to get the one for all RAM
+        RAM.SyncExposedMemory();
+        vector< uint64_t > PageHashes( RAM.NumberOfPages );
+        uint64_t ZeroPageHash = GetZeroPageHash();
+        
+        for( int32_t Page = 0; Page < RAM.NumberOfPages; Page++ )
+        {
+            if( RAM.IsPageDirty( Page ) )
+              PageHashes[ Page ] = HashBytes( &RAM.Memory[ Page * RAMPageSize ], RAMPageSize * sizeof(V32Word) );
+            else
+              PageHashes[ Page ] = ZeroPageHash;
+        }
+        
+        Digest.RAM = HashBytes( &PageHashes[ 0 ], PageHashes.size() * sizeof(uint64_t) );
+        
+        // all CPU fields, from registers to flags, are adjacent
+        const uint8_t* CPUStart = (const uint8_t*)CPU.Registers;
+        const uint8_t* CPUEnd = (const uint8_t*)(&CPU.Waiting + 1);
+        Digest.CPU = HashBytes( CPUStart, CPUEnd - CPUStart );
+        
+        // the 12 exposed GPU registers are adjacent, and
+        // region registers are read from the selected region
+        V32Word GPURegisters[ 12 + 6 ];
+        memcpy( GPURegisters, &GPU.Command, 12 * sizeof(V32Word) );
+        memcpy( GPURegisters + 12, GPU.PointedRegion, 6 * sizeof(V32Word) );
+        Digest.GPU = HashBytes( GPURegisters, sizeof(GPURegisters) );
+        
+        // channels are hashed by fields to skip their padding
+        V32Word SPURegisters[ 4 + 7 * Constants::SPUSoundChannels ];
+        memcpy( SPURegisters, &SPU.Command, 4 * sizeof(V32Word) );
+        V32Word* ChannelFields = SPURegisters + 4;
+        
+        for( int c = 0; c < Constants::SPUSoundChannels; c++ )
+        {
+            SPUChannel& Channel = SPU.Channels[ c ];
+            ChannelFields[ 0 ].AsInteger = (int32_t)Channel.State;
+            ChannelFields[ 1 ].AsInteger = Channel.AssignedSound;
+            ChannelFields[ 2 ].AsFloat = Channel.Volume;
+            ChannelFields[ 3 ].AsFloat = Channel.Speed;
+            ChannelFields[ 4 ].AsInteger = Channel.LoopEnabled;
+            memcpy( ChannelFields + 5, &Channel.Position, sizeof(double) );
+            ChannelFields += 7;
+        }
+        
+        Digest.SPU = HashBytes( SPURegisters, sizeof(SPURegisters) );
+        Digest.SoundOutput = HashBytes( SPU.OutputBuffer.Samples, sizeof(SPU.OutputBuffer.Samples) );
+        
+        // combine the previous hashes
+        Digest.Combined = HashBytes( &Digest, 5 * sizeof(uint64_t) );
+        return Digest;
+    }
+}
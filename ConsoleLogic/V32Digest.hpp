@@ -0,0 +1,46 @@
+// *****************************************************************************
+    // start include guard
+    #ifndef V32DIGEST_HPP
+    #define V32DIGEST_HPP
+    
+    // include C/C++ headers
+    #include <cstddef>          // [ ANSI C ] Standard definitions
+    #include <cstdint>          // [ ANSI C ] Standard integer types
+// *****************************************************************************
+
+
+namespace V32
+{
+    // =============================================================================
+    //      STATE DIGESTS
+    // =============================================================================
+    
+    
+    // hashes for each part of the console state, so
+    // that a mismatch also shows which part differs
+    typedef struct
+    {
+        uint64_t RAM;
+        uint64_t CPU;               // all registers and flags
+        uint64_t GPU;               // exposed registers and selected region
+        uint64_t SPU;               // exposed registers and all channels
+        uint64_t SoundOutput;       // samples for the last frame
+        uint64_t Combined;          // all of the above
+    }
+    FrameDigest;
+    
+    // -----------------------------------------------------------------------------
+    
+    // A 64-bit hash built like xxHash: data is read in stripes of 64
+    // bytes, each accumulated into 8 lanes with a 32x32 bit multiply,
+    // and lanes are merged at the end. Stripes are processed with SSE2
+    // or NEON when available. All paths give the same results, so that
+    // digests from different hosts (with the same endianness) match.
+    uint64_t HashBytes( const void* Data, size_t Bytes, uint64_t Seed = 0 );
+}
+
+
+// *****************************************************************************
+    // end include guard
+    #endif
+// *****************************************************************************
@@ -5,10 +5,12 @@
     
     // include console logic headers
     #include "V32GPU.hpp"
+    #include "V32CartridgeController.hpp"
     #include "ExternalInterfaces.hpp"
     
     // include C/C++ headers
     #include <cmath>            // [ ANSI C ] Mathematics
+    #include <cstring>          // [ ANSI C ] Strings
     
     // declare used namespaces
     using namespace std;
@@ -50,6 +52,94 @@ namespace V32
     };
     
     
+    // =============================================================================
+    //      GPU REGION TABLES
+    // =============================================================================
+    
+    
+    GPURegion GPURegionTable::EmptyPage[ GPURegionPageSize ] = {};
+    
+    // -----------------------------------------------------------------------------
+    
+    GPURegion* GPURegionTable::GetRegion( int32_t RegionID )
+    {
+        GPURegion* Page = Pages[ RegionID >> GPURegionPageSizeBits ].get();
+        
+        if( !Page )
+          Page = EmptyPage;
+        
+        return &Page[ RegionID & (GPURegionPageSize - 1) ];
+    }
+    
+    // -----------------------------------------------------------------------------
+    
+    GPURegion* GPURegionTable::GetWritableRegion( int32_t RegionID )
+    {
+        GPURegion* Page = GetWritablePage( RegionID >> GPURegionPageSizeBits );
+        return &Page[ RegionID & (GPURegionPageSize - 1) ];
+    }
+    
+    // -----------------------------------------------------------------------------
+    
+    bool GPURegionTable::IsPageAllocated( int32_t Page ) const
+    {
+        return (bool)Pages[ Page ];
+    }
+    
+    // -----------------------------------------------------------------------------
+    
+    const GPURegion* GPURegionTable::GetPage( int32_t Page ) const
+    {
+        if( !Pages[ Page ] )
+          return EmptyPage;
+        
+        return Pages[ Page ].get();
+    }
+    
+    // -----------------------------------------------------------------------------
+    
+    GPURegion* GPURegionTable::GetWritablePage( int32_t Page )
+    {
+        // new pages start as all zeroes
+        if( !Pages[ Page ] )
+          Pages[ Page ].reset( new GPURegion[ GPURegionPageSize ]() );
+        
+        return Pages[ Page ].get();
+    }
+    
+    // -----------------------------------------------------------------------------
+    
+    void GPURegionTable::SaveToTexture( GPUTexture& Texture ) const
+    {
+        for( int32_t Page = 0; Page < GPURegionPagesPerTexture; Page++ )
+          memcpy( &Texture.Regions[ Page * GPURegionPageSize ], GetPage( Page ), sizeof(EmptyPage) );
+    }
+    
+    // -----------------------------------------------------------------------------
+    
+    void GPURegionTable::LoadFromTexture( const GPUTexture& Texture )
+    {
+        // allocate only pages that are not all zeroes
+        for( int32_t Page = 0; Page < GPURegionPagesPerTexture; Page++ )
+        {
+            const GPURegion* LoadedRegions = &Texture.Regions[ Page * GPURegionPageSize ];
+            
+            if( !memcmp( LoadedRegions, EmptyPage, sizeof(EmptyPage) ) )
+              Pages[ Page ].reset();
+            else
+              memcpy( GetWritablePage( Page ), LoadedRegions, sizeof(EmptyPage) );
+        }
+    }
+    
+    // -----------------------------------------------------------------------------
+    
+    void GPURegionTable::Clear()
+    {
+        for( int32_t Page = 0; Page < GPURegionPagesPerTexture; Page++ )
+          Pages[ Page ].reset();
+    }
+    
+    
     // =============================================================================
     //      V32 GPU: INSTANCE HANDLING
     // =============================================================================
@@ -60,12 +150,25 @@ namespace V32
         // no entities were pointed yet
         PointedTexture = nullptr;
         PointedRegion = nullptr;
+        CartridgeController = nullptr;
+        Callbacks = nullptr;
+        
+        // draw normally unless told otherwise
+        DrawingSuppressed = false;
         
         // size the array
         CartridgeTextures.resize( Constants::GPUMaximumCartridgeTextures );
         
         // no cartridge loaded yet
         LoadedCartridgeTextures = 0;
+        
+        for( int i = 0; i < Constants::GPUMaximumCartridgeTextures; i++ )
+        {
+            UploadedCartridgeTextures[ i ] = false;
+            ModifiedCartridgeTextures[ i ] = false;
+        }
+        
+        SetCartridgeTexturesPending( 0 );
     }
     
     // -----------------------------------------------------------------------------
@@ -85,9 +188,10 @@ namespace V32
     void V32GPU::InsertCartridgeTextures( uint32_t NumberOfCartridgeTextures )
     {
         if( NumberOfCartridgeTextures > Constants::GPUMaximumCartridgeTextures )
-          Callbacks::ThrowException( "Attempting to insert too many cartridge textures" );
+          Callbacks->ThrowException( "Attempting to insert too many cartridge textures" );
         
         LoadedCartridgeTextures = NumberOfCartridgeTextures;
+        SetCartridgeTexturesPending( NumberOfCartridgeTextures );
     }
     
     // -----------------------------------------------------------------------------
@@ -95,7 +199,120 @@ namespace V32
     void V32GPU::RemoveCartridgeTextures()
     {
         LoadedCartridgeTextures = 0;
-        Callbacks::UnloadCartridgeTextures();
+        Callbacks->UnloadCartridgeTextures();
+        
+        for( int i = 0; i < Constants::GPUMaximumCartridgeTextures; i++ )
+          UploadedCartridgeTextures[ i ] = false;
+        
+        // release any textures that were never drawn
+        SetCartridgeTexturesPending( 0 );
+    }
+    
+    // -----------------------------------------------------------------------------
+    
+    // many textures are never used, or only used late in
+    // a game; so each texture is sent to the video library
+    // only when first drawn (decoding can happen before)
+    void V32GPU::UploadCartridgeTexture( int32_t GPUTextureID )
+    {
+        vector< GPUColor > Pixels;
+        TakeCartridgeTexture( GPUTextureID, Pixels );
+        
+        const CartridgeTextureLocation& Location = CartridgeController->TextureLocations[ GPUTextureID ];
+        Callbacks->LoadTexture( GPUTextureID, Location.Width, Location.Height, &Pixels[ 0 ] );
+        UploadedCartridgeTextures[ GPUTextureID ] = true;
+    }
+    
+    
+    // =============================================================================
+    //      V32 GPU: BACKGROUND DECODING OF CARTRIDGE TEXTURES
+    // =============================================================================
+    
+    
+    // marks the first textures as not decoded yet; must
+    // be called before starting any background decoding
+    void V32GPU::SetCartridgeTexturesPending( unsigned NumberOfTextures )
+    {
+        std::lock_guard< std::mutex > Lock( TextureLoadMutex );
+        
+        for( int i = 0; i < Constants::GPUMaximumCartridgeTextures; i++ )
+        {
+            CartridgeTextureStates[ i ] = ((unsigned)i < NumberOfTextures? GPUTextureLoadState::Pending : GPUTextureLoadState::Taken);
+            vector< GPUColor >().swap( DecodedCartridgeTextures[ i ] );
+        }
+        
+        DecodedTextureBytes = 0;
+    }
+    
+    // -----------------------------------------------------------------------------
+    
+    // whoever claims a pending texture becomes responsible
+    // for decoding its pixels and then finishing it; memory
+    // for the pixels is reserved here, so that loaders running
+    // at the same time can never go over the limit together
+    bool V32GPU::ClaimCartridgeTexture( int32_t GPUTextureID, uint32_t DecodedBytes )
+    {
+        std::lock_guard< std::mutex > Lock( TextureLoadMutex );
+        
+        if( CartridgeTextureStates[ GPUTextureID ] != GPUTextureLoadState::Pending )
+          return false;
+        
+        // textures that don't fit stay pending, to be read on demand
+        if( DecodedTextureBytes + DecodedBytes > GPUMaximumDecodedTextureBytes )
+          return false;
+        
+        DecodedTextureBytes += DecodedBytes;
+        CartridgeTextureStates[ GPUTextureID ] = GPUTextureLoadState::Decoding;
+        return true;
+    }
+    
+    // -----------------------------------------------------------------------------
+    
+    void V32GPU::FinishCartridgeTexture( int32_t GPUTextureID, std::vector< GPUColor >& Pixels )
+    {
+        {
+            std::lock_guard< std::mutex > Lock( TextureLoadMutex );
+            
+            // take the pixels without copying them; their
+            // memory was already reserved when claiming them
+            DecodedCartridgeTextures[ GPUTextureID ].swap( Pixels );
+            CartridgeTextureStates[ GPUTextureID ] = GPUTextureLoadState::Decoded;
+        }
+        
+        // wake up anyone waiting for this texture
+        TextureLoadCondition.notify_all();
+    }
+    
+    // -----------------------------------------------------------------------------
+    
+    // gives the pixels decoded in the background if there are
+    // any; otherwise the texture is read right away instead of
+    // waiting for the loaders to reach it (this is also the
+    // case when a texture needs to be uploaded again)
+    void V32GPU::TakeCartridgeTexture( int32_t GPUTextureID, std::vector< GPUColor >& Pixels )
+    {
+        {
+            std::unique_lock< std::mutex > Lock( TextureLoadMutex );
+            GPUTextureLoadState& State = CartridgeTextureStates[ GPUTextureID ];
+            
+            while( State == GPUTextureLoadState::Decoding )
+              TextureLoadCondition.wait( Lock );
+            
+            if( State == GPUTextureLoadState::Decoded )
+            {
+                Pixels.swap( DecodedCartridgeTextures[ GPUTextureID ] );
+                DecodedTextureBytes -= Pixels.size() * sizeof(GPUColor);
+                State = GPUTextureLoadState::Taken;
+                return;
+            }
+            
+            State = GPUTextureLoadState::Taken;
+        }
+        
+        // on failure just log it: the texture will
+        // still be created, but it will be transparent
+        if( !CartridgeController->ReadTexture( GPUTextureID, Pixels, CartridgeController->LinkedFile ) )
+          Callbacks->LogLine( "ERROR: Cannot read cartridge texture " + to_string( GPUTextureID ) );
     }
     
     
@@ -179,40 +396,25 @@ namespace V32
         SelectedRegion = 0;
         
         // notify video library of parameter changes
-        Callbacks::SelectTexture( SelectedTexture );
-        Callbacks::SetMultiplyColor( MultiplyColor );
-        Callbacks::SetBlendingMode( ActiveBlending );
-        
-        // reset pointed entities
-        PointedTexture = &BiosTexture;
-        PointedRegion = &BiosTexture.Regions[ 0 ];
+        Callbacks->SelectTexture( SelectedTexture );
+        Callbacks->SetMultiplyColor( MultiplyColor );
+        Callbacks->SetBlendingMode( ActiveBlending );
         
         // reset all regions for every textures
         // (but keep all existent textures reloaded!)
         for( int i = 0; i < Constants::GPUMaximumCartridgeTextures; i++ )
-        for( int j = 0; j < Constants::GPURegionsPerTexture; j++ )
-        {
-            CartridgeTextures[ i ].Regions[ j ].MinX     = 0;
-            CartridgeTextures[ i ].Regions[ j ].MinX     = 0;
-            CartridgeTextures[ i ].Regions[ j ].MaxX     = 0;
-            CartridgeTextures[ i ].Regions[ j ].MaxY     = 0;
-            CartridgeTextures[ i ].Regions[ j ].HotspotX = 0;
-            CartridgeTextures[ i ].Regions[ j ].HotspotY = 0;
-        }
+          CartridgeTextures[ i ].Clear();
         
         // same for BIOS texture
-        for( int j = 0; j < Constants::GPURegionsPerTexture; j++ )
-        {
-            BiosTexture.Regions[ j ].MinX     = 0;
-            BiosTexture.Regions[ j ].MinX     = 0;
-            BiosTexture.Regions[ j ].MaxX     = 0;
-            BiosTexture.Regions[ j ].MaxY     = 0;
-            BiosTexture.Regions[ j ].HotspotX = 0;
-            BiosTexture.Regions[ j ].HotspotY = 0;
-        }
+        BiosTexture.Clear();
+        
+        // reset pointed entities
+        // (only after regions are released)
+        PointedTexture = &BiosTexture;
+        PointedRegion = BiosTexture.GetRegion( 0 );
         
         // initial screen clear to black
-        Callbacks::ClearScreen( ClearColor );
+        Callbacks->ClearScreen( ClearColor );
     }
     
     
@@ -240,8 +442,12 @@ namespace V32
             return;
         }
         
+        // capacity was already used even if not drawing
+        if( DrawingSuppressed )
+          return;
+        
         // clear the screen
-        Callbacks::ClearScreen( ClearColor );
+        Callbacks->ClearScreen( ClearColor );
     }
     
     // -----------------------------------------------------------------------------
@@ -290,6 +496,15 @@ namespace V32
             return;
         }
         
+        // capacity was already used even if not drawing;
+        // texture upload is delayed until actually drawn
+        if( DrawingSuppressed )
+          return;
+        
+        // make sure the video library has this texture
+        if( SelectedTexture >= 0 && !UploadedCartridgeTextures[ SelectedTexture ] )
+          UploadCartridgeTexture( SelectedTexture );
+        
         // calculate absolute texture coordinates
         // (initially, they are pixel-centered and uncorrected)
         float TextureMinX = Region.MinX + 0.5;
@@ -420,6 +635,6 @@ namespace V32
         }
         
         // draw rectangle defined as a quad (4-vertex polygon)
-        Callbacks::DrawQuad( RegionQuad );
+        Callbacks->DrawQuad( RegionQuad );
     }
 }
@@ -9,11 +9,19 @@
     
     // include C/C++ headers
     #include <vector>           // [ C++ STL ] Vectors
+    #include <memory>           // [ C++ STL ] Smart pointers
+    #include <mutex>            // [ C++ STL ] Mutexes
+    #include <condition_variable>   // [ C++ STL ] Condition variables
 // *****************************************************************************
 
 
 namespace V32
 {
+    // forward declaration, since the GPU will
+    // read cartridge textures only when needed
+    class V32CartridgeController;
+    
+    
     // =============================================================================
     //      GPU DEFINITIONS
     // =============================================================================
@@ -65,12 +73,72 @@ namespace V32
     
     // -----------------------------------------------------------------------------
     
+    // full layout for the regions of a texture;
+    // the GPU itself stores them in region tables
     typedef struct
     {
         GPURegion Regions[ Constants::GPURegionsPerTexture ];
     }
     GPUTexture;
     
+    // -----------------------------------------------------------------------------
+    
+    // regions are grouped in pages, that are
+    // only allocated when first written to
+    const int32_t GPURegionPageSize = 64;
+    const int32_t GPURegionPageSizeBits = 6;
+    const int32_t GPURegionPagesPerTexture = Constants::GPURegionsPerTexture / GPURegionPageSize;
+    
+    // -----------------------------------------------------------------------------
+    
+    // Most games only define a few regions in each texture,
+    // so allocating all 4096 of them would waste memory.
+    // Regions in non-allocated pages are all zeroes, and
+    // reads for them return a shared page of zeroes that
+    // must never be written to. Both reads and writes
+    // still need only a constant time lookup.
+    class GPURegionTable
+    {
+        private:
+            
+            std::unique_ptr< GPURegion[] > Pages[ GPURegionPagesPerTexture ];
+            static GPURegion EmptyPage[ GPURegionPageSize ];
+            
+        public:
+            
+            // access to single regions
+            GPURegion* GetRegion( int32_t RegionID );
+            GPURegion* GetWritableRegion( int32_t RegionID );
+            
+            // access to whole pages
+            bool IsPageAllocated( int32_t Page ) const;
+            const GPURegion* GetPage( int32_t Page ) const;
+            GPURegion* GetWritablePage( int32_t Page );
+            
+            // conversion to full layout
+            void SaveToTexture( GPUTexture& Texture ) const;
+            void LoadFromTexture( const GPUTexture& Texture );
+            
+            // releases all pages, leaving all zeroes
+            void Clear();
+    };
+    
+    // -----------------------------------------------------------------------------
+    
+    // cartridge textures can be decoded in the background
+    // and then kept in memory until they are first drawn
+    enum class GPUTextureLoadState: int32_t
+    {
+        Pending = 0,
+        Decoding,
+        Decoded,
+        Taken           // was uploaded, or is being read on demand
+    };
+    
+    // decoded textures waiting to be drawn can use
+    // this much memory; others are read on demand
+    const uint32_t GPUMaximumDecodedTextureBytes = 32 * 1024 * 1024;
+    
     
     // =============================================================================
     //      V32 GPU CLASS
@@ -82,12 +150,21 @@ namespace V32
         public:
             
             // textures loaded into GPU
-            GPUTexture BiosTexture;
-            std::vector< GPUTexture > CartridgeTextures;    // do not use a plain array: it is too large to hold in stack
+            GPURegionTable BiosTexture;
+            std::vector< GPURegionTable > CartridgeTextures;
             unsigned LoadedCartridgeTextures;
             
+            // cartridge textures are sent to the
+            // video library only when first drawn
+            bool UploadedCartridgeTextures[ Constants::GPUMaximumCartridgeTextures ];
+            
+            // set when regions of a cartridge texture may no
+            // longer be all zeroes; this allows savestates
+            // to include only the textures that need it
+            bool ModifiedCartridgeTextures[ Constants::GPUMaximumCartridgeTextures ];
+            
             // accessors to active entities
-            GPUTexture* PointedTexture;
+            GPURegionTable* PointedTexture;
             GPURegion*  PointedRegion;
             
             // GPU registers: GPU control
@@ -111,6 +188,26 @@ namespace V32
             // quad coordinates for drawing regions
             GPUQuad RegionQuad;
             
+            // background decoding of cartridge textures
+            GPUTextureLoadState CartridgeTextureStates[ Constants::GPUMaximumCartridgeTextures ];
+            std::vector< GPUColor > DecodedCartridgeTextures[ Constants::GPUMaximumCartridgeTextures ];
+            uint32_t DecodedTextureBytes;   // guarded by TextureLoadMutex
+            std::mutex TextureLoadMutex;
+            std::condition_variable TextureLoadCondition;
+            
+            // when set, commands still use GPU capacity but
+            // nothing is sent to the video library; this is
+            // not part of the console state
+            bool DrawingSuppressed;
+            
+        public:
+            
+            // connection with the cartridge video ROM
+            V32CartridgeController* CartridgeController;
+            
+            // connection with the video library
+            ConsoleCallbacks* Callbacks;
+            
         public:
             
             // instance handling
@@ -120,6 +217,13 @@ namespace V32
             // handling video resources
             void InsertCartridgeTextures( uint32_t NumberOfCartridgeTextures );
             void RemoveCartridgeTextures();
+            void UploadCartridgeTexture( int32_t GPUTextureID );
+            
+            // background decoding of cartridge textures
+            void SetCartridgeTexturesPending( unsigned NumberOfTextures );
+            bool ClaimCartridgeTexture( int32_t GPUTextureID, uint32_t DecodedBytes );
+            void FinishCartridgeTexture( int32_t GPUTextureID, std::vector< GPUColor >& Pixels );
+            void TakeCartridgeTexture( int32_t GPUTextureID, std::vector< GPUColor >& Pixels );
             
             // connection to control bus
             virtual bool ReadPort( int32_t LocalPort, V32Word& Result );
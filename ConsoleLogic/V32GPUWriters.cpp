@@ -16,6 +16,20 @@
 
 namespace V32
 {
+    // =============================================================================
+    //      AUXILIARY FUNCTIONS FOR GPU WRITERS
+    // =============================================================================
+    
+    
+    // keep track of cartridge textures whose regions were
+    // modified, so that savestates only need to store those
+    static void MarkSelectedTextureModified( V32GPU& GPU )
+    {
+        if( GPU.SelectedTexture >= 0 )
+          GPU.ModifiedCartridgeTextures[ GPU.SelectedTexture ] = true;
+    }
+    
+    
     // =============================================================================
     //      PORT WRITE FUNCTIONS FOR V32 GPU
     // =============================================================================
@@ -81,7 +95,7 @@ namespace V32
         GPU.MultiplyColor = Value.AsColor;
         
         // notify the video library
-        Callbacks::SetMultiplyColor( Value.AsColor );
+        GPU.Callbacks->SetMultiplyColor( Value.AsColor );
         return true;
     }
     
@@ -115,7 +129,7 @@ namespace V32
         }
         
         // for valid modes, notify the video library
-        Callbacks::SetBlendingMode( Value.AsInteger );
+        GPU.Callbacks->SetBlendingMode( Value.AsInteger );
         return true;
     }
     
@@ -131,20 +145,20 @@ namespace V32
         GPU.SelectedTexture = Value.AsInteger;
         
         // notify the video library
-        Callbacks::SelectTexture( Value.AsInteger );
+        GPU.Callbacks->SelectTexture( Value.AsInteger );
         
         // now update the pointed entities
         if( Value.AsInteger == -1 )
         {
             // special case for BIOS texture
             GPU.PointedTexture = &GPU.BiosTexture;
-            GPU.PointedRegion = &GPU.PointedTexture->Regions[ GPU.SelectedRegion ];
+            GPU.PointedRegion = GPU.PointedTexture->GetRegion( GPU.SelectedRegion );
         }
         else
         {
             // regular cartridge textures
             GPU.PointedTexture = &GPU.CartridgeTextures[ GPU.SelectedTexture ];
-            GPU.PointedRegion = &GPU.PointedTexture->Regions[ GPU.SelectedRegion ];
+            GPU.PointedRegion = GPU.PointedTexture->GetRegion( GPU.SelectedRegion );
         }
         
         return true;
@@ -162,7 +176,7 @@ namespace V32
         GPU.SelectedRegion = Value.AsInteger;
         
         // update pointed entity
-        GPU.PointedRegion = &GPU.PointedTexture->Regions[ GPU.SelectedRegion ];
+        GPU.PointedRegion = GPU.PointedTexture->GetRegion( GPU.SelectedRegion );
         return true;
     }
     
@@ -235,7 +249,12 @@ namespace V32
         // out of texture values are accepted,
         // but they are clamped to texture limits
         Clamp( Value.AsInteger, 0, Constants::GPUTextureSize-1 );
+        
+        // the region may not be allocated yet
+        GPU.PointedRegion = GPU.PointedTexture->GetWritableRegion( GPU.SelectedRegion );
         GPU.PointedRegion->MinX = Value.AsInteger;
+        
+        MarkSelectedTextureModified( GPU );
         return true;
     }
     
@@ -246,7 +265,12 @@ namespace V32
         // out of texture values are accepted,
         // but they are clamped to texture limits
         Clamp( Value.AsInteger, 0, Constants::GPUTextureSize-1 );
+        
+        // the region may not be allocated yet
+        GPU.PointedRegion = GPU.PointedTexture->GetWritableRegion( GPU.SelectedRegion );
         GPU.PointedRegion->MinY = Value.AsInteger;
+        
+        MarkSelectedTextureModified( GPU );
         return true;
     }
     
@@ -259,7 +283,11 @@ namespace V32
         int32_t ValidX = Value.AsInteger;
         Clamp( ValidX, 0, Constants::GPUTextureSize-1 );
         
+        // the region may not be allocated yet
+        GPU.PointedRegion = GPU.PointedTexture->GetWritableRegion( GPU.SelectedRegion );
         GPU.PointedRegion->MaxX = ValidX;
+        
+        MarkSelectedTextureModified( GPU );
         return true;
     }
     
@@ -270,7 +298,12 @@ namespace V32
         // out of texture values are accepted,
         // but they are clamped to texture limits
         Clamp( Value.AsInteger, 0, Constants::GPUTextureSize-1 );
+        
+        // the region may not be allocated yet
+        GPU.PointedRegion = GPU.PointedTexture->GetWritableRegion( GPU.SelectedRegion );
         GPU.PointedRegion->MaxY = Value.AsInteger;
+        
+        MarkSelectedTextureModified( GPU );
         return true;
     }
     
@@ -281,7 +314,12 @@ namespace V32
         // out of texture values are valid up to
         // a certain range, then they get clamped
         Clamp( Value.AsInteger, -Constants::GPUTextureSize, (2*Constants::GPUTextureSize)-1 );
+        
+        // the region may not be allocated yet
+        GPU.PointedRegion = GPU.PointedTexture->GetWritableRegion( GPU.SelectedRegion );
         GPU.PointedRegion->HotspotX = Value.AsInteger;
+        
+        MarkSelectedTextureModified( GPU );
         return true;
     }
     
@@ -291,7 +329,12 @@ namespace V32
     {
         // out of texture values are valid
         Clamp( Value.AsInteger, -Constants::GPUTextureSize, (2*Constants::GPUTextureSize)-1 );
+        
+        // the region may not be allocated yet
+        GPU.PointedRegion = GPU.PointedTexture->GetWritableRegion( GPU.SelectedRegion );
         GPU.PointedRegion->HotspotY = Value.AsInteger;
+        
+        MarkSelectedTextureModified( GPU );
         return true;
     }
 }
@@ -4,6 +4,7 @@
     
     // include C/C++ headers
     #include <cstring>          // [ ANSI C ] Strings
+    #include <algorithm>        // [ C++ STL ] Algorithms
 // *****************************************************************************
 
 
@@ -17,6 +18,8 @@ namespace V32
     V32RAM::V32RAM()
     {
         MemorySize = 0;
+        NumberOfPages = 0;
+        IsExposed = false;
     }
     
     // -----------------------------------------------------------------------------
@@ -30,6 +33,12 @@ namespace V32
         Memory.resize( NumberOfWords );
         MemorySize = NumberOfWords;
         
+        // size dirty page bits, rounding up
+        NumberOfPages = (NumberOfWords + RAMPageSize - 1) >> RAMPageSizeBits;
+        DirtyPages.resize( (NumberOfPages + 63) / 64 );
+        WrittenPages.resize( (NumberOfPages + 63) / 64 );
+        ChangedPages.resize( (NumberOfPages + 63) / 64 );
+        
         // initially, set to zeroes
         ClearContents();
     }
@@ -40,6 +49,14 @@ namespace V32
     {
         Memory.clear();
         MemorySize = 0;
+        
+        DirtyPages.clear();
+        WrittenPages.clear();
+        ChangedPages.clear();
+        NumberOfPages = 0;
+        
+        // any given pointer is no longer valid
+        EndExposure();
     }
     
     // -----------------------------------------------------------------------------
@@ -47,6 +64,151 @@ namespace V32
     void V32RAM::ClearContents()
     {
         memset( &Memory[ 0 ], 0, Memory.size() * 4 );
+        
+        // all pages are now known to be zeroes
+        memset( &DirtyPages[ 0 ], 0, DirtyPages.size() * 8 );
+        
+        if( IsExposed )
+          memset( &ExposedContents[ 0 ], 0, ExposedContents.size() * 4 );
+        
+        // but any of them may have been changed
+        MarkAllPagesChanged();
+    }
+    
+    // -----------------------------------------------------------------------------
+    
+    bool V32RAM::IsPageDirty( int32_t Page )
+    {
+        return (DirtyPages[ Page >> 6 ] >> (Page & 63)) & 1;
+    }
+    
+    // -----------------------------------------------------------------------------
+    
+    void V32RAM::SetPageDirty( int32_t Page, bool Dirty )
+    {
+        if( Dirty )
+          DirtyPages[ Page >> 6 ] |= ((uint64_t)1 << (Page & 63));
+        else
+          DirtyPages[ Page >> 6 ] &= ~((uint64_t)1 << (Page & 63));
+    }
+    
+    // -----------------------------------------------------------------------------
+    
+    void V32RAM::MarkAllPagesDirty()
+    {
+        for( int32_t Page = 0; Page < NumberOfPages; Page++ )
+          SetPageDirty( Page, true );
+    }
+    
+    // -----------------------------------------------------------------------------
+    
+    bool V32RAM::IsPageWritten( int32_t Page )
+    {
+        return (WrittenPages[ Page >> 6 ] >> (Page & 63)) & 1;
+    }
+    
+    // -----------------------------------------------------------------------------
+    
+    void V32RAM::MarkAllPagesWritten()
+    {
+        std::fill( WrittenPages.begin(), WrittenPages.end(), ~(uint64_t)0 );
+    }
+    
+    // -----------------------------------------------------------------------------
+    
+    void V32RAM::ClearWrittenPages()
+    {
+        std::fill( WrittenPages.begin(), WrittenPages.end(), 0 );
+    }
+    
+    // -----------------------------------------------------------------------------
+    
+    // must be called for pages whose contents are
+    // replaced directly, such as when loading states
+    void V32RAM::MarkPageChanged( int32_t Page )
+    {
+        uint64_t PageBit = (uint64_t)1 << (Page & 63);
+        WrittenPages[ Page >> 6 ] |= PageBit;
+        ChangedPages[ Page >> 6 ] |= PageBit;
+    }
+    
+    // -----------------------------------------------------------------------------
+    
+    void V32RAM::MarkAllPagesChanged()
+    {
+        std::fill( WrittenPages.begin(), WrittenPages.end(), ~(uint64_t)0 );
+        std::fill( ChangedPages.begin(), ChangedPages.end(), ~(uint64_t)0 );
+    }
+    
+    // -----------------------------------------------------------------------------
+    
+    // adds the pages changed since the last call to the
+    // given bits, which must have one bit for each page
+    void V32RAM::CollectChangedPages( std::vector< uint64_t >& Pages )
+    {
+        for( size_t i = 0; i < ChangedPages.size(); i++ )
+        {
+            Pages[ i ] |= ChangedPages[ i ];
+            ChangedPages[ i ] = 0;
+        }
+    }
+    
+    // -----------------------------------------------------------------------------
+    
+    // gives a pointer that can be used to write to
+    // memory directly; writes through it are only
+    // tracked after calling SyncExposedMemory
+    V32Word* V32RAM::ExposeMemory()
+    {
+        if( Memory.empty() )
+          return nullptr;
+        
+        if( !IsExposed )
+        {
+            IsExposed = true;
+            ExposedContents = Memory;
+        }
+        
+        return &Memory[ 0 ];
+    }
+    
+    // -----------------------------------------------------------------------------
+    
+    // marks as dirty and written the pages that were changed
+    // through the exposed pointer since the last sync; pages
+    // are compared as a whole, so this is cheap when nothing
+    // has changed and only costs a copy for changed pages
+    void V32RAM::SyncExposedMemory()
+    {
+        if( !IsExposed )
+          return;
+        
+        for( int32_t Page = 0; Page < NumberOfPages; Page++ )
+        {
+            int32_t FirstWord = Page << RAMPageSizeBits;
+            int32_t PageBytes = std::min( RAMPageSize, MemorySize - FirstWord ) * sizeof(V32Word);
+            
+            if( !memcmp( &Memory[ FirstWord ], &ExposedContents[ FirstWord ], PageBytes ) )
+              continue;
+            
+            memcpy( &ExposedContents[ FirstWord ], &Memory[ FirstWord ], PageBytes );
+            SetPageDirty( Page, true );
+            MarkPageChanged( Page );
+        }
+    }
+    
+    // -----------------------------------------------------------------------------
+    
+    // must only be called when the given pointer is no
+    // longer used; writes made through it since the last
+    // sync are still tracked before the copy is released
+    void V32RAM::EndExposure()
+    {
+        SyncExposedMemory();
+        IsExposed = false;
+        
+        ExposedContents.clear();
+        ExposedContents.shrink_to_fit();
     }
     
     // -----------------------------------------------------------------------------
@@ -72,6 +234,18 @@ namespace V32
         
         // write value
         Memory[ LocalAddress ] = Value;
+        
+        // keep the exposed copy up to date so that
+        // syncing only finds writes from outside
+        if( IsExposed )
+          ExposedContents[ LocalAddress ] = Value;
+        
+        // mark its page as dirty, written and changed
+        int32_t Page = LocalAddress >> RAMPageSizeBits;
+        uint64_t PageBit = (uint64_t)1 << (Page & 63);
+        DirtyPages[ Page >> 6 ] |= PageBit;
+        WrittenPages[ Page >> 6 ] |= PageBit;
+        ChangedPages[ Page >> 6 ] |= PageBit;
         return true;
     }
     
@@ -18,6 +18,12 @@ namespace V32
     // =============================================================================
     
     
+    // RAM is tracked in pages of 4 KB
+    const int32_t RAMPageSize = 1024;
+    const int32_t RAMPageSizeBits = 10;
+    
+    // -----------------------------------------------------------------------------
+    
     class V32RAM: public VirconMemoryInterface
     {
         public:
@@ -25,6 +31,29 @@ namespace V32
             std::vector< V32Word > Memory;
             int32_t MemorySize;
             
+            // one bit per page, set when it may no longer be all
+            // zeroes (i.e. pages written since RAM was cleared);
+            // this allows savestates to include only those pages
+            std::vector< uint64_t > DirtyPages;
+            int32_t NumberOfPages;
+            
+            // one bit per page, set when written since the
+            // last checkpoint; this allows run-ahead to only
+            // save and restore the pages that were changed
+            std::vector< uint64_t > WrittenPages;
+            
+            // same as written pages, but only cleared when
+            // collected by incremental savestates, since
+            // run-ahead clears written pages every frame
+            std::vector< uint64_t > ChangedPages;
+            
+            // set while other code holds a pointer to memory and can
+            // write without going through the bus; those writes are
+            // found by comparing memory against a copy of what it had
+            // when last synced, since the tracking bits would miss them
+            bool IsExposed;
+            std::vector< V32Word > ExposedContents;
+            
         public:
             
             // instance handling
@@ -37,6 +66,26 @@ namespace V32
             // memory contents
             void ClearContents();
             
+            // dirty page tracking
+            bool IsPageDirty( int32_t Page );
+            void SetPageDirty( int32_t Page, bool Dirty );
+            void MarkAllPagesDirty();
+            
+            // written page tracking
+            bool IsPageWritten( int32_t Page );
+            void MarkAllPagesWritten();
+            void ClearWrittenPages();
+            
+            // changes made without using the bus
+            void MarkPageChanged( int32_t Page );
+            void MarkAllPagesChanged();
+            void CollectChangedPages( std::vector< uint64_t >& Pages );
+            
+            // direct access from outside the console
+            V32Word* ExposeMemory();
+            void SyncExposedMemory();
+            void EndExposure();
+            
             // bus connection
             virtual bool ReadAddress( int32_t LocalAddress, V32Word& Result );
             virtual bool WriteAddress( int32_t LocalAddress, V32Word Value );
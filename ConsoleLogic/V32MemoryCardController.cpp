@@ -1,6 +1,14 @@
 // *****************************************************************************
     // include console logic headers
     #include "V32MemoryCardController.hpp"
+    #include "ExternalInterfaces.hpp"
+    #include "V32Tracing.hpp"
+    
+    // include C/C++ headers
+    #include <algorithm>        // [ C++ STL ] Algorithms
+    
+    // declare used namespaces
+    using namespace std;
 // *****************************************************************************
 
 
@@ -14,12 +22,20 @@ namespace V32
     V32MemoryCardController::V32MemoryCardController()
     {
         PendingSave = false;
+        SaveDelayFrames = 0;
+        FramesSinceModified = 0;
+        SavesSuppressed = false;
+        WriterMustStop = false;
+        Callbacks = nullptr;
     }
     
     // -----------------------------------------------------------------------------
     
     V32MemoryCardController::~V32MemoryCardController()
     {
+        // queued writes must finish before closing
+        StopWriter();
+        
         // ensure we always close the file
         if( LinkedFile.is_open() )
           LinkedFile.close();
@@ -63,6 +79,160 @@ namespace V32
         // data is now pending to save
         PendingSave = true;
         
+        int32_t Page = LocalAddress >> RAMPageSizeBits;
+        UnsavedPages[ Page >> 6 ] |= ((uint64_t)1 << (Page & 63));
         return true;
     }
+    
+    
+    // =============================================================================
+    //      V32 MEMORY CARD CONTROLLER: UNSAVED PAGE TRACKING
+    // =============================================================================
+    
+    
+    bool V32MemoryCardController::IsPageUnsaved( int32_t Page )
+    {
+        return (UnsavedPages[ Page >> 6 ] >> (Page & 63)) & 1;
+    }
+    
+    // -----------------------------------------------------------------------------
+    
+    // used when contents are changed by means other
+    // than the memory bus; pages use the same layout
+    // as the page tracking bits in RAM
+    void V32MemoryCardController::MarkPagesUnsaved( const vector< uint64_t >& Pages )
+    {
+        for( size_t i = 0; i < UnsavedPages.size() && i < Pages.size(); i++ )
+          UnsavedPages[ i ] |= Pages[ i ];
+    }
+    
+    
+    // =============================================================================
+    //      V32 MEMORY CARD CONTROLLER: FILE WRITING
+    // =============================================================================
+    
+    
+    // must be called after the card is connected
+    // and its file is open; from then on, only the
+    // writer thread will access the file
+    void V32MemoryCardController::StartWriter()
+    {
+        StopWriter();
+        
+        UnsavedPages.assign( (NumberOfPages + 63) / 64, 0 );
+        QueuedWrites.clear();
+        FramesSinceModified = 0;
+        WriterMustStop = false;
+        WriterThread = thread( &V32MemoryCardController::RunWriter, this );
+    }
+    
+    // -----------------------------------------------------------------------------
+    
+    // all queued writes are completed before returning
+    void V32MemoryCardController::StopWriter()
+    {
+        if( !WriterThread.joinable() )
+          return;
+        
+        {
+            lock_guard< mutex > Lock( WriterMutex );
+            WriterMustStop = true;
+        }
+        
+        WriterCondition.notify_one();
+        WriterThread.join();
+    }
+    
+    // -----------------------------------------------------------------------------
+    
+    // when not running, the card is not linked to a file
+    bool V32MemoryCardController::IsWriterRunning()
+    {
+        return WriterThread.joinable();
+    }
+    
+    // -----------------------------------------------------------------------------
+    
+    // groups consecutive unsaved pages into ranges and
+    // queues a copy of their contents for the writer
+    void V32MemoryCardController::QueueUnsavedPages()
+    {
+        vector< MemoryCardWrite > Writes;
+        
+        for( int32_t Page = 0; Page < NumberOfPages; Page++ )
+        {
+            // skip 64 saved pages at once
+            if( !UnsavedPages[ Page >> 6 ] )
+            {
+                Page |= 63;
+                continue;
+            }
+            
+            if( !IsPageUnsaved( Page ) )
+              continue;
+            
+            int32_t FirstPage = Page;
+            
+            while( Page + 1 < NumberOfPages && IsPageUnsaved( Page + 1 ) )
+              Page++;
+            
+            // the last page may be incomplete
+            int32_t FirstWord = FirstPage << RAMPageSizeBits;
+            int32_t EndWord = min( MemorySize, (Page + 1) << RAMPageSizeBits );
+            
+            MemoryCardWrite Write;
+            Write.FirstWord = FirstWord;
+            Write.Words.assign( Memory.begin() + FirstWord, Memory.begin() + EndWord );
+            Writes.push_back( std::move( Write ) );
+        }
+        
+        fill( UnsavedPages.begin(), UnsavedPages.end(), 0 );
+        
+        if( Writes.empty() )
+          return;
+        
+        {
+            lock_guard< mutex > Lock( WriterMutex );
+            
+            for( MemoryCardWrite& Write: Writes )
+              QueuedWrites.push_back( std::move( Write ) );
+        }
+        
+        WriterCondition.notify_one();
+    }
+    
+    // -----------------------------------------------------------------------------
+    
+    // runs on the writer thread; when asked to
+    // stop, it still completes all queued writes
+    void V32MemoryCardController::RunWriter()
+    {
+        while( true )
+        {
+            MemoryCardWrite Write;
+            
+            {
+                unique_lock< mutex > Lock( WriterMutex );
+                WriterCondition.wait( Lock, [this]{ return WriterMustStop || !QueuedWrites.empty(); } );
+                
+                if( QueuedWrites.empty() )
+                  return;
+                
+                Write = std::move( QueuedWrites.front() );
+                QueuedWrites.pop_front();
+            }
+            
+            // skip the file signature, which is never modified
+            TRACE_SCOPE( "MemoryCardWrite" );
+            LinkedFile.seekp( 8 + Write.FirstWord * 4, ios_base::beg );
+            LinkedFile.write( (char*)(&Write.Words[ 0 ]), Write.Words.size() * 4 );
+            LinkedFile.flush();
+            
+            if( LinkedFile.fail() )
+            {
+                Callbacks->LogLine( "ERROR: Cannot save memory card file" );
+                LinkedFile.clear();
+            }
+        }
+    }
 }
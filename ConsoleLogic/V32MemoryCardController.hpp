@@ -6,10 +6,16 @@
     // include console logic headers
     #include "V32Buses.hpp"
     #include "V32Memory.hpp"
+    #include "ExternalInterfaces.hpp"
     
     // include C/C++ headers
     #include <string>           // [ C++ STL ] Strings
     #include <fstream>          // [ C++ STL ] File streams
+    #include <vector>           // [ C++ STL ] Vectors
+    #include <deque>            // [ C++ STL ] Double-ended queues
+    #include <thread>           // [ C++ STL ] Threads
+    #include <mutex>            // [ C++ STL ] Mutexes
+    #include <condition_variable>   // [ C++ STL ] Condition variables
 // *****************************************************************************
 
 
@@ -31,6 +37,22 @@ namespace V32
     const int32_t MEM_LastPort = (int32_t)MEM_LocalPorts::Connected;
     
     
+    // =============================================================================
+    //      MEMORY CARD FILE WRITES
+    // =============================================================================
+    
+    
+    // a range of consecutive words to be written to the
+    // card file; contents are copied when the write is
+    // queued, so the writer thread never accesses memory
+    typedef struct
+    {
+        int32_t FirstWord;
+        std::vector< V32Word > Words;
+    }
+    MemoryCardWrite;
+    
+    
     // =============================================================================
     //      MEMORY CARD CONTROLLER CLASS
     // =============================================================================
@@ -44,9 +66,33 @@ namespace V32
             std::fstream LinkedFile;
             bool PendingSave;
             
+            // one bit per page, set when written since the
+            // card was last saved; only those are written
+            std::vector< uint64_t > UnsavedPages;
+            
+            // saving waits this many frames after the card
+            // is modified, so that consecutive writes from
+            // the game are grouped into a single save
+            int32_t SaveDelayFrames;
+            int32_t FramesSinceModified;
+            
+            // while set, frames don't advance the save delay
+            // (their changes are going to be undone anyway)
+            bool SavesSuppressed;
+            
+            // background thread that writes to the file
+            std::thread WriterThread;
+            std::mutex WriterMutex;
+            std::condition_variable WriterCondition;
+            std::deque< MemoryCardWrite > QueuedWrites;
+            bool WriterMustStop;
+            
             // displayed file name for GUI
             std::string CardFileName;
             
+            // connection with the log library
+            ConsoleCallbacks* Callbacks;
+            
         public:
             
             // instance handling
@@ -59,6 +105,17 @@ namespace V32
             
             // connection to memory bus (overriden)
             virtual bool WriteAddress( int32_t LocalAddress, V32Word Value );
+            
+            // unsaved page tracking
+            bool IsPageUnsaved( int32_t Page );
+            void MarkPagesUnsaved( const std::vector< uint64_t >& Pages );
+            
+            // file writing
+            void StartWriter();
+            void StopWriter();
+            bool IsWriterRunning();
+            void QueueUnsavedPages();
+            void RunWriter();
     };
 }
 
@@ -1,6 +1,8 @@
 // *****************************************************************************
     // include console logic headers
     #include "V32SPU.hpp"
+    #include "V32CartridgeController.hpp"
+    #include "V32Tracing.hpp"
     
     // include C/C++ headers
     #include <cstring>          // [ ANSI C ] Strings
@@ -50,9 +52,12 @@ namespace V32
         // no entities were pointed yet
         PointedChannel = nullptr;
         PointedSound = nullptr;
+        CartridgeController = nullptr;
+        Callbacks = nullptr;
         
         // no cartridge loaded yet
         LoadedCartridgeSounds = 0;
+        SetCartridgeSoundsPending( 0 );
     }
     
     // -----------------------------------------------------------------------------
@@ -75,6 +80,16 @@ namespace V32
         TargetSound.Samples.resize( NumberOfSamples );
         memcpy( &TargetSound.Samples[ 0 ], Samples, NumberOfSamples * 4 );
         
+        // set the rest of sound properties
+        DeclareSound( TargetSound, NumberOfSamples );
+    }
+    
+    // -----------------------------------------------------------------------------
+    
+    // sets sound properties without providing the actual samples;
+    // this is enough for programs to read the sound ports
+    void V32SPU::DeclareSound( SPUSound& TargetSound, unsigned NumberOfSamples )
+    {
         // update sound length
         TargetSound.Length = NumberOfSamples;
         
@@ -93,6 +108,86 @@ namespace V32
     }
     
     
+    // =============================================================================
+    //      V32 SPU: BACKGROUND LOADING OF CARTRIDGE SOUNDS
+    // =============================================================================
+    
+    
+    // marks the first sounds as not having their samples yet;
+    // must be called before starting any background loading
+    void V32SPU::SetCartridgeSoundsPending( unsigned NumberOfSounds )
+    {
+        std::lock_guard< std::mutex > Lock( SoundLoadMutex );
+        
+        for( int i = 0; i < Constants::SPUMaximumCartridgeSounds; i++ )
+          CartridgeSoundStates[ i ] = ((unsigned)i < NumberOfSounds? SPUSoundLoadState::Pending : SPUSoundLoadState::Ready);
+        
+        PendingCartridgeSounds = NumberOfSounds;
+    }
+    
+    // -----------------------------------------------------------------------------
+    
+    // whoever claims a pending sound becomes responsible
+    // for loading its samples and then finishing it
+    bool V32SPU::ClaimCartridgeSound( int32_t SoundID )
+    {
+        std::lock_guard< std::mutex > Lock( SoundLoadMutex );
+        
+        if( CartridgeSoundStates[ SoundID ] != SPUSoundLoadState::Pending )
+          return false;
+        
+        CartridgeSoundStates[ SoundID ] = SPUSoundLoadState::Loading;
+        return true;
+    }
+    
+    // -----------------------------------------------------------------------------
+    
+    void V32SPU::FinishCartridgeSound( int32_t SoundID, std::vector< SPUSample >& Samples )
+    {
+        {
+            std::lock_guard< std::mutex > Lock( SoundLoadMutex );
+            
+            // take the samples without copying them
+            CartridgeSounds[ SoundID ].Samples.swap( Samples );
+            CartridgeSoundStates[ SoundID ] = SPUSoundLoadState::Ready;
+            PendingCartridgeSounds--;
+        }
+        
+        // wake up anyone waiting for this sound
+        SoundLoadCondition.notify_all();
+    }
+    
+    // -----------------------------------------------------------------------------
+    
+    // blocks only until this particular sound is ready; if the
+    // background loader has not reached it yet, it is loaded
+    // right away instead of waiting for the previous sounds
+    void V32SPU::WaitForCartridgeSound( int32_t SoundID )
+    {
+        // fast path once everything has been loaded
+        if( PendingCartridgeSounds == 0 )
+          return;
+        
+        if( ClaimCartridgeSound( SoundID ) )
+        {
+            std::vector< SPUSample > Samples;
+            
+            // on failure the sound will just be silent
+            if( !CartridgeController->ReadSound( SoundID, Samples, CartridgeController->LinkedFile ) )
+              Callbacks->LogLine( "ERROR: Cannot read cartridge sound " + std::to_string( SoundID ) );
+            
+            FinishCartridgeSound( SoundID, Samples );
+            return;
+        }
+        
+        // otherwise wait for whoever is loading it
+        std::unique_lock< std::mutex > Lock( SoundLoadMutex );
+        
+        while( CartridgeSoundStates[ SoundID ] != SPUSoundLoadState::Ready )
+          SoundLoadCondition.wait( Lock );
+    }
+    
+    
     // =============================================================================
     //      V32 SPU: I/O BUS CONNECTION
     // =============================================================================
@@ -308,9 +403,18 @@ namespace V32
     
     void V32SPU::UpdateOutputBuffer()
     {
+        TRACE_SCOPE( "SPU.UpdateOutputBuffer" );
+        PERF_SCOPE( SPUMix );
+        
         // assign the next sequence number to the buffer
         OutputBuffer.SequenceNumber++;
         
+        // playing sounds need to have their samples
+        if( PendingCartridgeSounds > 0 )
+          for( int c = 0; c < Constants::SPUSoundChannels; c++ )
+            if( Channels[ c ].State == IOPortValues::SPUChannelState_Playing && Channels[ c ].AssignedSound >= 0 )
+              WaitForCartridgeSound( Channels[ c ].AssignedSound );
+        
         // determine the value for each sample in the buffer
         for( int s = 0; s < Constants::SPUSamplesPerFrame; s++ )
         {
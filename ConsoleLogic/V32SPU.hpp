@@ -12,11 +12,19 @@
     
     // include C/C++ headers
     #include <vector>           // [ C++ STL ] Vectors
+    #include <atomic>           // [ C++ STL ] Atomic variables
+    #include <mutex>            // [ C++ STL ] Mutexes
+    #include <condition_variable>   // [ C++ STL ] Condition variables
 // *****************************************************************************
 
 
 namespace V32
 {
+    // forward declaration, since the SPU may need
+    // to read cartridge sounds that are not loaded
+    class V32CartridgeController;
+    
+    
     // =============================================================================
     //      SPU DEFINITIONS
     // =============================================================================
@@ -82,6 +90,17 @@ namespace V32
     }
     SPUChannel;
     
+    // -----------------------------------------------------------------------------
+    
+    // cartridge sound samples are loaded in the
+    // background, after the console has started
+    enum class SPUSoundLoadState: int32_t
+    {
+        Ready = 0,
+        Pending,
+        Loading
+    };
+    
     
     // =============================================================================
     //      V32 SPU CLASS
@@ -113,6 +132,18 @@ namespace V32
             // sound buffer configuration
             SPUOutputBuffer OutputBuffer;
             
+            // background loading of cartridge sounds
+            SPUSoundLoadState CartridgeSoundStates[ Constants::SPUMaximumCartridgeSounds ];
+            std::atomic< unsigned > PendingCartridgeSounds;
+            std::mutex SoundLoadMutex;
+            std::condition_variable SoundLoadCondition;
+            
+            // connection with the cartridge audio ROM
+            V32CartridgeController* CartridgeController;
+            
+            // connection with the log library
+            ConsoleCallbacks* Callbacks;
+            
         public:
             
             // instance handling
@@ -122,6 +153,13 @@ namespace V32
             // handling of audio resources
             void LoadSound( SPUSound& TargetSound, SPUSample* Samples, unsigned NumberOfSamples );
             void UnloadSound( SPUSound& TargetSound );
+            void DeclareSound( SPUSound& TargetSound, unsigned NumberOfSamples );
+            
+            // background loading of cartridge sounds
+            void SetCartridgeSoundsPending( unsigned NumberOfSounds );
+            bool ClaimCartridgeSound( int32_t SoundID );
+            void FinishCartridgeSound( int32_t SoundID, std::vector< SPUSample >& Samples );
+            void WaitForCartridgeSound( int32_t SoundID );
             
             // I/O bus connection
             virtual bool ReadPort( int32_t LocalPort, V32Word& Result );
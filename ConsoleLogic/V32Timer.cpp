@@ -19,10 +19,18 @@ namespace V32
     
     V32Timer::V32Timer()
     {
-        // obtain current time
+        // obtain current time (localtime is not used, since
+        // consoles may be created from different threads)
         time_t CreationTime;
         time( &CreationTime );
-        struct tm* CreationTimeInfo = localtime( &CreationTime );
+        struct tm LocalTime;
+        struct tm* CreationTimeInfo = &LocalTime;
+        
+        #if defined(__WIN32__)
+          localtime_s( &LocalTime, &CreationTime );
+        #else
+          localtime_r( &CreationTime, &LocalTime );
+        #endif
         
         // store current date as (year|days)
         // (Careful! C gives year counting from 1900)
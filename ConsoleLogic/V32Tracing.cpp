@@ -0,0 +1,147 @@
+// *****************************************************************************
+    // include console logic headers
+    #include "V32Tracing.hpp"
+    
+    // include C/C++ headers
+    #include <cstdio>           // [ ANSI C ] Standard I/O
+    #include <chrono>           // [ C++ STL ] Time
+    #include <thread>           // [ C++ STL ] Threads
+    #include <fstream>          // [ C++ STL ] File streams
+    
+    // declare used namespaces
+    using namespace std;
+// *****************************************************************************
+
+
+namespace V32
+{
+    // =============================================================================
+    //      TRACE BUFFER: INSTANCE HANDLING
+    // =============================================================================
+    
+    
+    TraceBuffer Tracer;
+    
+    // -----------------------------------------------------------------------------
+    
+    TraceBuffer::TraceBuffer()
+    {
+        NextEvent = 0;
+        Enabled = false;
+    }
+    
+    
+    // =============================================================================
+    //      TRACE BUFFER: CONFIGURATION
+    // =============================================================================
+    
+    
+    // capacity is a power of 2, so that ring positions
+    // can be found with a bit mask; the buffer is only
+    // allocated once, so threads never see it moved
+    void TraceBuffer::Enable( uint32_t CapacityBits )
+    {
+        if( Events.empty() )
+          Events.assign( (size_t)1 << CapacityBits, TraceEvent{ nullptr, 0, 0, 0 } );
+        
+        // discard any previous events
+        for( TraceEvent& Event: Events )
+          Event.Name = nullptr;
+        
+        NextEvent = 0;
+        Enabled = true;
+    }
+    
+    // -----------------------------------------------------------------------------
+    
+    // events are kept so they can still be exported
+    void TraceBuffer::Disable()
+    {
+        Enabled = false;
+    }
+    
+    
+    // =============================================================================
+    //      TRACE BUFFER: OPERATION
+    // =============================================================================
+    
+    
+    uint64_t TraceBuffer::GetMicroseconds()
+    {
+        auto Elapsed = chrono::steady_clock::now().time_since_epoch();
+        return chrono::duration_cast< chrono::microseconds >( Elapsed ).count();
+    }
+    
+    // -----------------------------------------------------------------------------
+    
+    void TraceBuffer::AddEvent( const char* Name, uint64_t StartMicroseconds, uint64_t EndMicroseconds )
+    {
+        uint64_t Position = NextEvent.fetch_add( 1, memory_order_relaxed );
+        TraceEvent& Event = Events[ Position & (Events.size() - 1) ];
+        
+        Event.Name = Name;
+        Event.StartMicroseconds = StartMicroseconds;
+        Event.DurationMicroseconds = EndMicroseconds - StartMicroseconds;
+        Event.ThreadID = (uint32_t)hash< thread::id >()( this_thread::get_id() );
+    }
+    
+    // -----------------------------------------------------------------------------
+    
+    bool TraceBuffer::ExportJSON( const string& FilePath )
+    {
+        ofstream OutputFile( FilePath );
+        
+        if( !OutputFile )
+          return false;
+        
+        // when the ring wrapped, start from the oldest event
+        uint64_t LastEvent = NextEvent.load();
+        uint64_t FirstEvent = 0;
+        
+        if( LastEvent > Events.size() )
+          FirstEvent = LastEvent - Events.size();
+        
+        // names are C++ identifiers, so they need no escaping
+        OutputFile << "{\"traceEvents\":[\n";
+        bool FirstWritten = true;
+        
+        for( uint64_t Position = FirstEvent; Position < LastEvent; Position++ )
+        {
+            const TraceEvent& Event = Events[ Position & (Events.size() - 1) ];
+            
+            if( !Event.Name )
+              continue;
+            
+            char Line[ 200 ];
+            
+            snprintf
+            (
+                Line, sizeof(Line),
+                "%s{\"name\":\"%s\",\"ph\":\"X\",\"ts\":%llu,\"dur\":%llu,\"pid\":1,\"tid\":%u}",
+                FirstWritten? "" : ",\n",
+                Event.Name,
+                (unsigned long long)Event.StartMicroseconds,
+                (unsigned long long)Event.DurationMicroseconds,
+                (unsigned)Event.ThreadID
+            );
+            
+            OutputFile << Line;
+            FirstWritten = false;
+        }
+        
+        OutputFile << "\n]}\n";
+        return (bool)OutputFile;
+    }
+    
+    
+    // =============================================================================
+    //      EXTERNAL PERFORMANCE COUNTERS
+    // =============================================================================
+    
+    
+    namespace PerfCounters
+    {
+        void( *Start )( PerfSections ) = nullptr;
+        void( *Stop )( PerfSections ) = nullptr;
+    }
+}
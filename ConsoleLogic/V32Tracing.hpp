@@ -0,0 +1,189 @@
+// *****************************************************************************
+    // start include guard
+    #ifndef V32TRACING_HPP
+    #define V32TRACING_HPP
+    
+    // include C/C++ headers
+    #include <cstdint>          // [ ANSI C ] Standard integer types
+    #include <string>           // [ C++ STL ] Strings
+    #include <vector>           // [ C++ STL ] Vectors
+    #include <atomic>           // [ C++ STL ] Atomic variables
+// *****************************************************************************
+
+
+namespace V32
+{
+    // =============================================================================
+    //      TRACE EVENTS
+    // =============================================================================
+    
+    
+    // a completed timed scope; names must be string
+    // literals, since only their pointers are stored
+    typedef struct
+    {
+        const char* Name;
+        uint64_t StartMicroseconds;
+        uint64_t DurationMicroseconds;
+        uint32_t ThreadID;
+    }
+    TraceEvent;
+    
+    
+    // =============================================================================
+    //      TRACE BUFFER
+    // =============================================================================
+    
+    
+    // Events are stored in a ring buffer that overwrites the
+    // oldest events. Any thread can add events without locks,
+    // since each one atomically takes the next slot. Export
+    // should be done after disabling, once traced scopes end.
+    class TraceBuffer
+    {
+        private:
+        
+            std::vector< TraceEvent > Events;
+            std::atomic< uint64_t > NextEvent;
+            std::atomic< bool > Enabled;
+        
+        public:
+        
+            // instance handling
+            TraceBuffer();
+            
+            // configuration (capacity is only
+            // set the first time it is enabled)
+            void Enable( uint32_t CapacityBits );
+            void Disable();
+            bool IsEnabled()
+            {
+                return Enabled.load( std::memory_order_relaxed );
+            }
+            
+            // operation
+            static uint64_t GetMicroseconds();
+            void AddEvent( const char* Name, uint64_t StartMicroseconds, uint64_t EndMicroseconds );
+            
+            // saves events in Chrome trace format, which
+            // can be opened in chrome://tracing or Perfetto
+            bool ExportJSON( const std::string& FilePath );
+    };
+    
+    // -----------------------------------------------------------------------------
+    
+    // a single buffer is shared by all traced code, even
+    // with several consoles in the same process: all of
+    // them go to the same timeline, told apart by thread
+    extern TraceBuffer Tracer;
+    
+    
+    // =============================================================================
+    //      SCOPED TIMERS
+    // =============================================================================
+    
+    
+    // adds an event for its own lifetime, if tracing
+    // was enabled when it was created; otherwise it
+    // only costs checking the enabled flag
+    class ScopedTrace
+    {
+        private:
+        
+            const char* Name;
+            uint64_t StartMicroseconds;
+            bool Active;
+        
+        public:
+        
+            ScopedTrace( const char* ScopeName )
+            {
+                Name = ScopeName;
+                Active = Tracer.IsEnabled();
+                
+                if( Active )
+                  StartMicroseconds = TraceBuffer::GetMicroseconds();
+            }
+            
+            ~ScopedTrace()
+            {
+                if( Active )
+                  Tracer.AddEvent( Name, StartMicroseconds, TraceBuffer::GetMicroseconds() );
+            }
+    };
+    
+    
+    // =============================================================================
+    //      EXTERNAL PERFORMANCE COUNTERS
+    // =============================================================================
+    
+    
+    // hot sections that can be measured by the
+    // performance counters of the frontend
+    enum class PerfSections
+    {
+        CPULoop = 0,
+        SPUMix,
+        QuadFlush,
+        Serialize,
+        Unserialize,
+        CartridgeLoad,
+        
+        Count
+    };
+    
+    // -----------------------------------------------------------------------------
+    
+    // unlike other callbacks these are optional: when
+    // not provided, sections are simply not measured;
+    // they are global like the frontend counters, so
+    // programs running several consoles must not set them
+    namespace PerfCounters
+    {
+        extern void( *Start )( PerfSections );
+        extern void( *Stop )( PerfSections );
+    }
+    
+    // -----------------------------------------------------------------------------
+    
+    // measures a section for its own lifetime
+    class ScopedPerfCounter
+    {
+        private:
+        
+            PerfSections Section;
+        
+        public:
+        
+            ScopedPerfCounter( PerfSections MeasuredSection )
+            {
+                Section = MeasuredSection;
+                
+                if( PerfCounters::Start )
+                  PerfCounters::Start( Section );
+            }
+            
+            ~ScopedPerfCounter()
+            {
+                if( PerfCounters::Stop )
+                  PerfCounters::Stop( Section );
+            }
+    };
+}
+
+// -----------------------------------------------------------------------------
+
+// traces the rest of the current block
+#define TRACE_CONCATENATE( A, B ) A##B
+#define TRACE_VARIABLE( Line ) TRACE_CONCATENATE( ScopedTrace, Line )
+#define TRACE_SCOPE( Name ) V32::ScopedTrace TRACE_VARIABLE( __LINE__ )( Name )
+
+// measures the rest of the current block
+#define PERF_VARIABLE( Line ) TRACE_CONCATENATE( ScopedPerfCounter, Line )
+#define PERF_SCOPE( Section ) V32::ScopedPerfCounter PERF_VARIABLE( __LINE__ )( V32::PerfSections::Section )
+
+
+// *****************************************************************************
+    // end include guard
+    #endif
+// *****************************************************************************
@@ -4,6 +4,11 @@
     
     // include emulator headers
     #include "VideoOutput.hpp"
+    #include "Rewind.hpp"
+    #include "RunAhead.hpp"
+    #include "Savestates.hpp"
+    #include "Cheats.hpp"
+    #include "Movies.hpp"
     #include "Globals.hpp"
     #include "Logging.hpp"
     
@@ -19,6 +24,7 @@
 
 // instance of the Vircon virtual machine
 V32::V32Console Console;
+CoreCallbacks Callbacks;
 
 // wrappers for console I/O operation
 VideoOutput Video;
@@ -26,6 +32,19 @@ V32::SPUOutputBuffer AudioBuffer;
 string LoadedCartridgePath;
 string LoadedMemoryCardPath;
 
+// optional in-core rewind and run-ahead
+RewindBuffer Rewind;
+RunAheadSnapshot RunAhead;
+
+// bases for incremental savestates
+IncrementalStateBases IncrementalBases;
+
+// cheats set by the frontend
+CheatEngine Cheats( Console );
+
+// input recording and replay
+InputMovie Movie( Console );
+
 // libretro data structures
 struct retro_hw_render_callback hw_render;
 
@@ -44,88 +63,94 @@ retro_input_state_t input_state_cb = nullptr;
 // =============================================================================
 
 
-namespace CallbackFunctions
+void CoreCallbacks::ClearScreen( V32::GPUColor ClearColor )
 {
-    void ClearScreen( V32::GPUColor ClearColor )
-    {
-        Video.ClearScreen( ClearColor );
-    }
-    
-    // -----------------------------------------------------------------------------
-    
-    void DrawQuad( V32::GPUQuad& DrawnQuad )
-    {
-        Video.AddQuadToQueue( DrawnQuad );
-    }
-    
-    // -----------------------------------------------------------------------------
-    
-    void SetMultiplyColor( V32::GPUColor NewMultiplyColor )
-    {
-        // GPU colors are not directly comparable so use words
-        V32::V32Word New, Old;
-        New.AsColor = NewMultiplyColor;
-        Old.AsColor = Video.GetMultiplyColor();
-        
-        // set multiply color only when needed, so that
-        // quad groups are not broken without need
-        if( New.AsInteger != Old.AsInteger )
-          Video.SetMultiplyColor( NewMultiplyColor );
-    }
-    
-    // -----------------------------------------------------------------------------
-    
-    void SetBlendingMode( int NewBlendingMode )
-    {
-        // set blending mode only when needed, so that
-        // quad groups are not broken without need
-        if( NewBlendingMode != (int)Video.GetBlendingMode() )
-          Video.SetBlendingMode( (V32::IOPortValues)NewBlendingMode );
-    }
-    
-    // -----------------------------------------------------------------------------
-    
-    void SelectTexture( int GPUTextureID )
-    {
-        // select texture only when needed, so that
-        // quad groups are not broken without need
-        if( GPUTextureID != Video.GetSelectedTexture() )
-          Video.SelectTexture( GPUTextureID );
-    }
-    
-    // -----------------------------------------------------------------------------
-    
-    void LoadTexture( int GPUTextureID, void* Pixels )
-    {
-        Video.LoadTexture( GPUTextureID, Pixels );
-    }
-    
-    // -----------------------------------------------------------------------------
-    
-    void UnloadCartridgeTextures()
-    {
-        for( int i = 0; i < V32::Constants::GPUMaximumCartridgeTextures; i++ )
-          Video.UnloadTexture( i );
-    }
-    
-    // -----------------------------------------------------------------------------
-    
-    void UnloadBiosTexture()
-    {
-        Video.UnloadTexture( -1 );
-    }
-    
-    // -----------------------------------------------------------------------------
-    
-    void LogLine( const string& Message )
-    {
-        LOG( Message );
-    }
-    
-    // -----------------------------------------------------------------------------
-    
-    void ThrowException( const string& Message )
-    {
-        THROW( Message );
-    }
+    Video.ClearScreen( ClearColor );
+}
+
+// -----------------------------------------------------------------------------
+
+void CoreCallbacks::DrawQuad( V32::GPUQuad& DrawnQuad )
+{
+    Video.AddQuadToQueue( DrawnQuad );
+}
+
+// -----------------------------------------------------------------------------
+
+void CoreCallbacks::SetMultiplyColor( V32::GPUColor NewMultiplyColor )
+{
+    // GPU colors are not directly comparable so use words
+    V32::V32Word New, Old;
+    New.AsColor = NewMultiplyColor;
+    Old.AsColor = Video.GetMultiplyColor();
+    
+    // set multiply color only when needed, so that
+    // quad groups are not broken without need
+    if( New.AsInteger != Old.AsInteger )
+      Video.SetMultiplyColor( NewMultiplyColor );
+}
+
+// -----------------------------------------------------------------------------
+
+void CoreCallbacks::SetBlendingMode( int NewBlendingMode )
+{
+    // set blending mode only when needed, so that
+    // quad groups are not broken without need
+    if( NewBlendingMode != (int)Video.GetBlendingMode() )
+      Video.SetBlendingMode( (V32::IOPortValues)NewBlendingMode );
+}
+
+// -----------------------------------------------------------------------------
+
+void CoreCallbacks::SelectTexture( int GPUTextureID )
+{
+    // select texture only when needed, so that
+    // quad groups are not broken without need
+    if( GPUTextureID != Video.GetSelectedTexture() )
+      Video.SelectTexture( GPUTextureID );
+}
+
+// -----------------------------------------------------------------------------
+
+void CoreCallbacks::LoadTexture( int GPUTextureID, int Width, int Height, void* Pixels )
+{
+    Video.LoadTexture( GPUTextureID, Width, Height, Pixels );
+}
+
+// -----------------------------------------------------------------------------
+
+void CoreCallbacks::UnloadCartridgeTextures()
+{
+    for( int i = 0; i < V32::Constants::GPUMaximumCartridgeTextures; i++ )
+      Video.UnloadTexture( i );
+}
+
+// -----------------------------------------------------------------------------
+
+void CoreCallbacks::UnloadBiosTexture()
+{
+    Video.UnloadTexture( -1 );
+}
+
+// -----------------------------------------------------------------------------
+
+// video output will apply these updates only when
+// needed, so loading states does not depend on OpenGL
+void CoreCallbacks::RestoreRenderState( int GPUTextureID, V32::GPUColor NewMultiplyColor, int NewBlendingMode )
+{
+    Video.SetRenderStateLazily( GPUTextureID, NewMultiplyColor, (V32::IOPortValues)NewBlendingMode );
+}
+
+// -----------------------------------------------------------------------------
+
+void CoreCallbacks::LogLine( const string& Message )
+{
+    LOG( Message );
+}
+
+// -----------------------------------------------------------------------------
+
+void CoreCallbacks::ThrowException( const string& Message )
+{
+    THROW( Message );
 }
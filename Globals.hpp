@@ -18,6 +18,11 @@
     // (to avoid needing to include all headers here)
     namespace V32{ class V32Console; }
     class VideoOutput;
+    class RewindBuffer;
+    class RunAheadSnapshot;
+    class IncrementalStateBases;
+    class CheatEngine;
+    class InputMovie;
 // *****************************************************************************
 
 
@@ -35,6 +40,19 @@ extern V32::SPUOutputBuffer AudioBuffer;
 extern std::string LoadedCartridgePath;
 extern std::string LoadedMemoryCardPath;
 
+// optional in-core rewind and run-ahead
+extern RewindBuffer Rewind;
+extern RunAheadSnapshot RunAhead;
+
+// bases for incremental savestates
+extern IncrementalStateBases IncrementalBases;
+
+// cheats set by the frontend
+extern CheatEngine Cheats;
+
+// input recording and replay
+extern InputMovie Movie;
+
 // libretro data structures
 extern struct retro_hw_render_callback hw_render;
 
@@ -53,22 +71,32 @@ extern retro_input_state_t input_state_cb;
 // =============================================================================
 
 
-namespace CallbackFunctions
+// the core runs a single console, and it is
+// connected to the global video output
+class CoreCallbacks: public V32::ConsoleCallbacks
 {
-    // video functions callable by the console
-    void ClearScreen( V32::GPUColor ClearColor );
-    void DrawQuad( V32::GPUQuad& DrawnQuad );
-    void SetMultiplyColor( V32::GPUColor NewMultiplyColor );
-    void SetBlendingMode( int NewBlendingMode );
-    void SelectTexture( int GPUTextureID );
-    void LoadTexture( int GPUTextureID, void* Pixels );
-    void UnloadCartridgeTextures();
-    void UnloadBiosTexture();
-    
-    // log functions callable by the console
-    void LogLine( const std::string& Message );
-    void ThrowException( const std::string& Message );
-}
+    public:
+        
+        // video functions callable by the console
+        virtual void ClearScreen( V32::GPUColor ClearColor ) override;
+        virtual void DrawQuad( V32::GPUQuad& DrawnQuad ) override;
+        virtual void SetMultiplyColor( V32::GPUColor NewMultiplyColor ) override;
+        virtual void SetBlendingMode( int NewBlendingMode ) override;
+        virtual void SelectTexture( int GPUTextureID ) override;
+        virtual void LoadTexture( int GPUTextureID, int Width, int Height, void* Pixels ) override;
+        virtual void UnloadCartridgeTextures() override;
+        virtual void UnloadBiosTexture() override;
+        virtual void RestoreRenderState( int GPUTextureID, V32::GPUColor NewMultiplyColor, int NewBlendingMode ) override;
+        
+        // log functions callable by the console
+        virtual void LogLine( const std::string& Message ) override;
+        virtual void ThrowException( const std::string& Message ) override;
+};
+
+// -----------------------------------------------------------------------------
+
+// callbacks used by the console
+extern CoreCallbacks Callbacks;
 
 
 // *****************************************************************************
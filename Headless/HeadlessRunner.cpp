@@ -0,0 +1,447 @@
+// *****************************************************************************
+    // include Vircon32 headers
+    #include "ConsoleLogic/V32Console.hpp"
+    
+    // include emulator headers
+    #include "Cheats.hpp"
+    #include "Movies.hpp"
+    
+    // include the autogenerated embedded bios file
+    #include <embedded/StandardBios.h>
+    
+    // include C/C++ headers
+    #include <cstdio>           // [ ANSI C ] Standard I/O
+    #include <cstdlib>          // [ ANSI C ] Standard library
+    #include <cstring>          // [ ANSI C ] Strings
+    #include <algorithm>        // [ C++ STL ] Algorithms
+    #include <chrono>           // [ C++ STL ] Time
+    #include <sstream>          // [ C++ STL ] String streams
+    #include <stdexcept>        // [ C++ STL ] Exceptions
+    #include <string>           // [ C++ STL ] Strings
+    #include <vector>           // [ C++ STL ] Vectors
+    
+    // declare used namespaces
+    using namespace std;
+    using namespace V32;
+// *****************************************************************************
+
+
+// =============================================================================
+//      HEADLESS CALLBACKS
+// =============================================================================
+
+
+// console messages are only shown on request
+static bool ShowConsoleLog = false;
+
+class LoggingCallbacks: public HeadlessCallbacks
+{
+    public:
+        
+        virtual void LogLine( const string& Message ) override
+        {
+            if( ShowConsoleLog )
+              printf( "  [console] %s\n", Message.c_str() );
+        }
+};
+
+// -----------------------------------------------------------------------------
+
+// nothing is drawn: only the emulated GPU does
+// its work, so results don't depend on OpenGL
+static LoggingCallbacks HeadlessOutput;
+
+// -----------------------------------------------------------------------------
+
+// a single console is run, with its movie
+static V32Console Console;
+static InputMovie Movie( Console );
+static SPUOutputBuffer AudioBuffer;
+
+// RAM can be searched while running
+static RAMSearch Search( Console );
+
+
+// =============================================================================
+//      RUN CONFIGURATION
+// =============================================================================
+
+
+// a RAM search step, applied after running a frame;
+// a step with no comparison (re)starts the search
+typedef struct
+{
+    int Frame;
+    bool Restarts;
+    RAMSearchComparisons Comparison;
+    int32_t Value;
+}
+SearchStep;
+
+// -----------------------------------------------------------------------------
+
+typedef struct
+{
+    string CartridgePath;
+    string BiosPath;
+    string MoviePath;
+    string DigestPath;
+    int Frames;
+    int ReportedSpikes;
+    vector< SearchStep > SearchSteps;
+}
+RunOptions;
+
+// -----------------------------------------------------------------------------
+
+typedef struct
+{
+    int FrameNumber;
+    double Milliseconds;
+}
+FrameTime;
+
+
+// =============================================================================
+//      RAM SEARCH
+// =============================================================================
+
+
+// steps have the form <frame>:<comparison>[:<value>]; the
+// value is only used (and needed) for "equal" comparisons
+bool ParseSearchStep( const string& Text, SearchStep& Step )
+{
+    const char* Position = Text.c_str();
+    char* End;
+    
+    Step.Frame = (int)strtol( Position, &End, 10 );
+    Step.Restarts = false;
+    Step.Comparison = RAMSearchComparisons::Unchanged;
+    Step.Value = 0;
+    
+    if( End == Position || *End != ':' || Step.Frame < 0 )
+      return false;
+    
+    string Comparison = End + 1;
+    size_t ValueStart = Comparison.find( ':' );
+    
+    if( ValueStart != string::npos )
+    {
+        string Value = Comparison.substr( ValueStart + 1 );
+        Comparison = Comparison.substr( 0, ValueStart );
+        
+        // values can be given in decimal or hexadecimal
+        Step.Value = (int32_t)strtoll( Value.c_str(), &End, 0 );
+        
+        if( Value.empty() || *End || Comparison != "equal" )
+          return false;
+    }
+    
+    else if( Comparison == "equal" )
+      return false;
+    
+    if( Comparison == "start" )          Step.Restarts = true;
+    else if( Comparison == "equal" )     Step.Comparison = RAMSearchComparisons::EqualToValue;
+    else if( Comparison == "changed" )   Step.Comparison = RAMSearchComparisons::Changed;
+    else if( Comparison == "unchanged" ) Step.Comparison = RAMSearchComparisons::Unchanged;
+    else if( Comparison == "increased" ) Step.Comparison = RAMSearchComparisons::Increased;
+    else if( Comparison == "decreased" ) Step.Comparison = RAMSearchComparisons::Decreased;
+    else return false;
+    
+    return true;
+}
+
+// -----------------------------------------------------------------------------
+
+void ApplySearchStep( const SearchStep& Step )
+{
+    if( Step.Restarts )
+    {
+        Search.Start();
+        printf( "RAM search started after frame %d\n", Step.Frame );
+        return;
+    }
+    
+    uint32_t Candidates = Search.Filter( Step.Comparison, Step.Value );
+    printf( "RAM search after frame %d: %u candidates\n", Step.Frame, Candidates );
+}
+
+// -----------------------------------------------------------------------------
+
+// shows the first candidates, along with their current values
+void ReportSearchCandidates( uint32_t MaximumResults )
+{
+    uint32_t Candidates = Search.CountCandidates();
+    printf( "RAM search candidates: %u\n", Candidates );
+    
+    for( int32_t Address: Search.GetCandidates( MaximumResults ) )
+      printf( "  0x%08X = %d\n", (unsigned)Address, Console.RAM.Memory[ Address ].AsInteger );
+    
+    if( Candidates > MaximumResults )
+      printf( "  (%u more)\n", Candidates - MaximumResults );
+}
+
+
+// =============================================================================
+//      RUNNING THE CONSOLE
+// =============================================================================
+
+
+void StartConsole( const RunOptions& Options )
+{
+    if( Options.BiosPath.empty() )
+    {
+        stringstream BiosData;
+        BiosData.write( (const char*)embedded_StandardBios, sizeof( embedded_StandardBios ) );
+        Console.LoadBiosData( BiosData );
+    }
+    
+    else Console.LoadBiosFile( Options.BiosPath );
+    
+    if( !Options.CartridgePath.empty() )
+      Console.LoadCartridge( Options.CartridgePath );
+    
+    // with no movie, the first gamepad is connected
+    // as in the core, but no controls are pressed
+    Console.SetGamepadConnection( 0, true );
+    Console.SetPower( true );
+    
+    if( !Options.MoviePath.empty() )
+      if( !Movie.StartReplay( Options.MoviePath ) )
+        throw runtime_error( "cannot replay movie \"" + Options.MoviePath + "\"" );
+    
+    // unless restarted later, searches
+    // compare with the initial RAM contents
+    if( !Options.SearchSteps.empty() )
+      Search.Start();
+}
+
+// -----------------------------------------------------------------------------
+
+// one line per frame: frame number, then the combined
+// digest and the ones for RAM, CPU, GPU, SPU and sound;
+// logs from 2 runs can be compared with a plain diff
+void WriteFrameDigest( FILE* DigestFile, int FrameNumber )
+{
+    FrameDigest Digest = Console.GetFrameDigest();
+    
+    fprintf
+    (
+        DigestFile, "%d %016llx %016llx %016llx %016llx %016llx %016llx\n", FrameNumber,
+        (unsigned long long)Digest.Combined, (unsigned long long)Digest.RAM,
+        (unsigned long long)Digest.CPU, (unsigned long long)Digest.GPU,
+        (unsigned long long)Digest.SPU, (unsigned long long)Digest.SoundOutput
+    );
+}
+
+// -----------------------------------------------------------------------------
+
+// frames run as fast as possible; a replay runs
+// all of its frames unless a number is given
+vector< FrameTime > RunFrames( const RunOptions& Options, FILE* DigestFile )
+{
+    vector< FrameTime > FrameTimes;
+    int FrameNumber = 0;
+    
+    while( true )
+    {
+        if( Options.Frames > 0 && FrameNumber >= Options.Frames )
+          break;
+        
+        // without a movie, inputs are kept as they are
+        MovieFrame Inputs;
+        memset( &Inputs, 0, sizeof(MovieFrame) );
+        
+        for( int Port = 0; Port < Constants::GamepadPorts; Port++ )
+          if( Console.HasGamepad( Port ) )
+            Inputs.ConnectedGamepads |= (1 << Port);
+        
+        bool Replaying = (Movie.GetMode() == MovieModes::Replaying);
+        Movie.ProcessFrame( Inputs );
+        
+        if( Replaying && Movie.GetMode() != MovieModes::Replaying )
+          break;
+        
+        auto FrameStart = chrono::steady_clock::now();
+        ApplyMovieFrame( Console, Inputs );
+        Console.RunNextFrame( false );
+        Console.GetFrameSoundOutput( AudioBuffer );
+        auto FrameEnd = chrono::steady_clock::now();
+        
+        // digests and searches are not part of the measured time
+        if( DigestFile )
+          WriteFrameDigest( DigestFile, FrameNumber );
+        
+        for( const SearchStep& Step: Options.SearchSteps )
+          if( Step.Frame == FrameNumber )
+            ApplySearchStep( Step );
+        
+        FrameTime Time;
+        Time.FrameNumber = FrameNumber++;
+        Time.Milliseconds = chrono::duration< double, milli >( FrameEnd - FrameStart ).count();
+        FrameTimes.push_back( Time );
+    }
+    
+    return FrameTimes;
+}
+
+// -----------------------------------------------------------------------------
+
+void ReportFrameTimes( vector< FrameTime >& FrameTimes, int ReportedSpikes )
+{
+    if( FrameTimes.empty() )
+    {
+        printf( "No frames were run\n" );
+        return;
+    }
+    
+    double TotalMilliseconds = 0;
+    
+    for( const FrameTime& Time: FrameTimes )
+      TotalMilliseconds += Time.Milliseconds;
+    
+    double MeanMilliseconds = TotalMilliseconds / FrameTimes.size();
+    double RealTimeSpeed = (1000.0 / Constants::FramesPerSecond) / MeanMilliseconds;
+    
+    printf( "Frames run:      %u\n", (unsigned)FrameTimes.size() );
+    printf( "Total time:      %.3f s\n", TotalMilliseconds / 1000 );
+    printf( "Mean frame time: %.3f ms\n", MeanMilliseconds );
+    printf( "Speed:           %.1f fps (%.1fx real time)\n", 1000 / MeanMilliseconds, RealTimeSpeed );
+    
+    // the slowest frames show where to look for spikes
+    sort
+    (
+        FrameTimes.begin(), FrameTimes.end(),
+        []( const FrameTime& A, const FrameTime& B ){ return A.Milliseconds > B.Milliseconds; }
+    );
+    
+    int Spikes = min( ReportedSpikes, (int)FrameTimes.size() );
+    
+    if( Spikes > 0 )
+      printf( "Slowest frames:\n" );
+    
+    for( int i = 0; i < Spikes; i++ )
+      printf( "  frame %-8d %9.3f ms\n", FrameTimes[ i ].FrameNumber, FrameTimes[ i ].Milliseconds );
+}
+
+
+// =============================================================================
+//      MAIN FUNCTION
+// =============================================================================
+
+
+void PrintUsage()
+{
+    printf( "USAGE: vircon32_headless [options] [cartridge file]\n" );
+    printf( "Options:\n" );
+    printf( "  --bios <file>     Use this bios instead of the standard one\n" );
+    printf( "  --replay <file>   Replay an input movie, until it ends\n" );
+    printf( "  --frames <N>      Number of frames to run (default: 600 with no movie)\n" );
+    printf( "  --spikes <N>      Number of slowest frames to report (default: 5)\n" );
+    printf( "  --digest <file>   Write a state digest for every frame to a file\n" );
+    printf( "  --search <step>   Filter RAM words after a frame, as <frame>:<comparison>[:<value>]\n" );
+    printf( "                    Comparisons: changed, unchanged, increased, decreased, equal\n" );
+    printf( "                    (equal needs a value), or start to restart the search\n" );
+    printf( "  --log             Show console log messages\n" );
+    printf( "With no cartridge, only the bios is run.\n" );
+}
+
+// -----------------------------------------------------------------------------
+
+int main( int NumberOfArguments, char* Arguments[] )
+{
+    RunOptions Options;
+    Options.Frames = 0;
+    Options.ReportedSpikes = 5;
+    
+    // process command line arguments
+    for( int i = 1; i < NumberOfArguments; i++ )
+    {
+        string Argument = Arguments[ i ];
+        
+        if( Argument == "--bios" && i + 1 < NumberOfArguments )
+          Options.BiosPath = Arguments[ ++i ];
+        
+        else if( Argument == "--replay" && i + 1 < NumberOfArguments )
+          Options.MoviePath = Arguments[ ++i ];
+        
+        else if( Argument == "--frames" && i + 1 < NumberOfArguments )
+          Options.Frames = max( 1, atoi( Arguments[ ++i ] ) );
+        
+        else if( Argument == "--spikes" && i + 1 < NumberOfArguments )
+          Options.ReportedSpikes = max( 0, atoi( Arguments[ ++i ] ) );
+        
+        else if( Argument == "--digest" && i + 1 < NumberOfArguments )
+          Options.DigestPath = Arguments[ ++i ];
+        
+        else if( Argument == "--search" && i + 1 < NumberOfArguments )
+        {
+            SearchStep Step;
+            
+            if( !ParseSearchStep( Arguments[ ++i ], Step ) )
+            {
+                PrintUsage();
+                return 1;
+            }
+            
+            Options.SearchSteps.push_back( Step );
+        }
+        
+        else if( Argument == "--log" )
+          ShowConsoleLog = true;
+        
+        else if( Argument[ 0 ] == '-' || !Options.CartridgePath.empty() )
+        {
+            PrintUsage();
+            return 1;
+        }
+        
+        else Options.CartridgePath = Argument;
+    }
+    
+    // without a movie there is no natural end
+    if( Options.MoviePath.empty() && Options.Frames == 0 )
+      Options.Frames = 600;
+    
+    // the console needs all callbacks
+    Console.SetCallbacks( &HeadlessOutput );
+    
+    FILE* DigestFile = nullptr;
+    
+    if( !Options.DigestPath.empty() )
+    {
+        DigestFile = fopen( Options.DigestPath.c_str(), "w" );
+        
+        if( !DigestFile )
+        {
+            printf( "FAILED: cannot create digest file \"%s\"\n", Options.DigestPath.c_str() );
+            return 1;
+        }
+    }
+    
+    try
+    {
+        StartConsole( Options );
+        vector< FrameTime > FrameTimes = RunFrames( Options, DigestFile );
+        Movie.Stop();
+        
+        if( DigestFile )
+          fclose( DigestFile );
+        
+        ReportFrameTimes( FrameTimes, Options.ReportedSpikes );
+        
+        if( Search.IsActive() )
+          ReportSearchCandidates( 16 );
+    }
+    
+    catch( exception& e )
+    {
+        if( DigestFile )
+          fclose( DigestFile );
+        
+        printf( "FAILED: %s\n", e.what() );
+        return 1;
+    }
+    
+    return 0;
+}
@@ -0,0 +1,617 @@
+// *****************************************************************************
+    // include Vircon32 headers
+    #include "ConsoleLogic/V32Console.hpp"
+    
+    // include emulator headers
+    #include "Movies.hpp"
+    
+    // include the autogenerated embedded bios file
+    #include <embedded/StandardBios.h>
+    
+    // include C/C++ headers
+    #include <cstdio>           // [ ANSI C ] Standard I/O
+    #include <cstdlib>          // [ ANSI C ] Standard library
+    #include <cstring>          // [ ANSI C ] Strings
+    #include <algorithm>        // [ C++ STL ] Algorithms
+    #include <atomic>           // [ C++ STL ] Atomic variables
+    #include <chrono>           // [ C++ STL ] Time
+    #include <fstream>          // [ C++ STL ] File streams
+    #include <memory>           // [ C++ STL ] Smart pointers
+    #include <mutex>            // [ C++ STL ] Mutexes
+    #include <sstream>          // [ C++ STL ] String streams
+    #include <stdexcept>        // [ C++ STL ] Exceptions
+    #include <string>           // [ C++ STL ] Strings
+    #include <thread>           // [ C++ STL ] Threads
+    #include <vector>           // [ C++ STL ] Vectors
+    
+    // include system headers for folders and memory usage
+    #if defined(__WIN32__)
+      #include <windows.h>
+    #else
+      #include <dirent.h>
+      #include <sys/resource.h>
+    #endif
+    
+    // declare used namespaces
+    using namespace std;
+    using namespace V32;
+// *****************************************************************************
+
+
+// =============================================================================
+//      RUN CONFIGURATION
+// =============================================================================
+
+
+typedef struct
+{
+    string CartridgeFolder;
+    string BiosPath;
+    string OutputPath;
+    int Frames;
+    int Jobs;
+    
+    // each cartridge runs in its own process, so that
+    // peak memory usage can be measured per cartridge
+    bool Isolated;
+}
+RunOptions;
+
+// -----------------------------------------------------------------------------
+
+// all runs use the same bios, read only once
+static string BiosBytes;
+
+// -----------------------------------------------------------------------------
+
+// cartridge messages are ignored, but hardware
+// errors are counted since they are faults
+class RegressionCallbacks: public HeadlessCallbacks
+{
+    public:
+    
+        int HardwareErrors;
+        int FirstErrorCode;
+    
+    public:
+    
+        RegressionCallbacks()
+        {
+            HardwareErrors = 0;
+            FirstErrorCode = -1;
+        }
+        
+        virtual void HardwareErrorRaised( CPUErrorCodes Code ) override
+        {
+            if( HardwareErrors++ == 0 )
+              FirstErrorCode = (int)Code;
+        }
+};
+
+
+// =============================================================================
+//      AUXILIARY FUNCTIONS
+// =============================================================================
+
+
+// only files with the cartridge extension are run,
+// and they are sorted to always get the same order
+vector< string > ListCartridges( const string& FolderPath )
+{
+    vector< string > FileNames;
+    
+    #if defined(__WIN32__)
+    
+      WIN32_FIND_DATAA FileData;
+      HANDLE Search = FindFirstFileA( (FolderPath + "\\*.v32").c_str(), &FileData );
+      
+      if( Search == INVALID_HANDLE_VALUE )
+        return FileNames;
+      
+      do FileNames.push_back( FileData.cFileName );
+      while( FindNextFileA( Search, &FileData ) );
+      
+      FindClose( Search );
+    
+    #else
+    
+      DIR* Folder = opendir( FolderPath.c_str() );
+      
+      if( !Folder )
+        throw runtime_error( "cannot open folder \"" + FolderPath + "\"" );
+      
+      while( dirent* Entry = readdir( Folder ) )
+      {
+          string FileName = Entry->d_name;
+          
+          if( FileName.size() > 4 && FileName.compare( FileName.size() - 4, 4, ".v32" ) == 0 )
+            FileNames.push_back( FileName );
+      }
+      
+      closedir( Folder );
+    
+    #endif
+    
+    sort( FileNames.begin(), FileNames.end() );
+    return FileNames;
+}
+
+// -----------------------------------------------------------------------------
+
+static bool FileExists( const string& FilePath )
+{
+    ifstream TestedFile( FilePath );
+    return TestedFile.good();
+}
+
+// -----------------------------------------------------------------------------
+
+// peak resident memory of this whole process, or
+// 0 where the system does not provide it
+long GetPeakMemoryKilobytes()
+{
+    #if defined(__WIN32__)
+      return 0;
+    #else
+      struct rusage Usage;
+      getrusage( RUSAGE_SELF, &Usage );
+      
+      // macOS gives bytes instead of kilobytes
+      #if defined(__APPLE__)
+        return Usage.ru_maxrss / 1024;
+      #else
+        return Usage.ru_maxrss;
+      #endif
+    #endif
+}
+
+// -----------------------------------------------------------------------------
+
+string JSONString( const string& Text )
+{
+    string Result = "\"";
+    
+    for( unsigned char Character: Text )
+    {
+        if( Character == '"' || Character == '\\' )
+        {
+            Result += '\\';
+            Result += (char)Character;
+        }
+        
+        else if( Character < 32 )
+        {
+            char Escaped[ 8 ];
+            snprintf( Escaped, sizeof(Escaped), "\\u%04x", Character );
+            Result += Escaped;
+        }
+        
+        else Result += (char)Character;
+    }
+    
+    return Result + "\"";
+}
+
+
+// =============================================================================
+//      RUNNING A CARTRIDGE
+// =============================================================================
+
+
+typedef struct
+{
+    string FileName;
+    string Status;              // "ok", "fault" or "error"
+    string ErrorMessage;
+    int FramesRun;
+    double LoadMilliseconds;
+    double FramesPerSecond;
+    double CPULoad;
+    double GPULoad;
+    int HardwareErrors;
+    int FirstErrorCode;
+    long PeakMemoryKilobytes;
+    FrameDigest FinalDigest;
+}
+CartridgeResult;
+
+// -----------------------------------------------------------------------------
+
+// each run has its own console, so runs from
+// different threads don't interfere at all;
+// a movie next to the cartridge, with the same
+// name, provides the inputs for its first frames
+CartridgeResult RunCartridge( const RunOptions& Options, const string& FileName )
+{
+    CartridgeResult Result;
+    memset( &Result.FinalDigest, 0, sizeof(FrameDigest) );
+    Result.FileName = FileName;
+    Result.Status = "ok";
+    Result.FramesRun = 0;
+    Result.LoadMilliseconds = 0;
+    Result.FramesPerSecond = 0;
+    Result.CPULoad = 0;
+    Result.GPULoad = 0;
+    
+    RegressionCallbacks Callbacks;
+    string CartridgePath = Options.CartridgeFolder + "/" + FileName;
+    string MoviePath = CartridgePath.substr( 0, CartridgePath.size() - 4 ) + ".v32movie";
+    
+    try
+    {
+        // consoles are too large for the stack
+        unique_ptr< V32Console > Console( new V32Console );
+        Console->SetCallbacks( &Callbacks );
+        
+        stringstream BiosData( BiosBytes );
+        Console->LoadBiosData( BiosData );
+        
+        auto LoadStart = chrono::steady_clock::now();
+        Console->LoadCartridge( CartridgePath );
+        Console->SetGamepadConnection( 0, true );
+        Console->SetPower( true );
+        auto LoadEnd = chrono::steady_clock::now();
+        Result.LoadMilliseconds = chrono::duration< double, milli >( LoadEnd - LoadStart ).count();
+        
+        InputMovie Movie( *Console );
+        
+        if( FileExists( MoviePath ) && !Movie.StartReplay( MoviePath ) )
+          throw runtime_error( "cannot replay movie \"" + MoviePath + "\"" );
+        
+        SPUOutputBuffer SoundOutput;
+        auto RunStart = chrono::steady_clock::now();
+        
+        for( int Frame = 0; Frame < Options.Frames; Frame++ )
+        {
+            // after the movie ends inputs are kept as they are
+            MovieFrame Inputs;
+            memset( &Inputs, 0, sizeof(MovieFrame) );
+            
+            for( int Port = 0; Port < Constants::GamepadPorts; Port++ )
+              if( Console->HasGamepad( Port ) )
+                Inputs.ConnectedGamepads |= (1 << Port);
+            
+            Movie.ProcessFrame( Inputs );
+            ApplyMovieFrame( *Console, Inputs );
+            Console->RunNextFrame( false );
+            Console->GetFrameSoundOutput( SoundOutput );
+            
+            Result.CPULoad += Console->LastCPULoads[ 0 ];
+            Result.GPULoad += Console->LastGPULoads[ 0 ];
+            Result.FramesRun++;
+        }
+        
+        auto RunEnd = chrono::steady_clock::now();
+        double RunSeconds = chrono::duration< double >( RunEnd - RunStart ).count();
+        
+        if( Result.FramesRun > 0 )
+        {
+            Result.FramesPerSecond = Result.FramesRun / max( RunSeconds, 1e-9 );
+            Result.CPULoad /= Result.FramesRun;
+            Result.GPULoad /= Result.FramesRun;
+        }
+        
+        Result.FinalDigest = Console->GetFrameDigest();
+        Movie.Stop();
+        Console->SetPower( false );
+    }
+    
+    catch( exception& e )
+    {
+        Result.Status = "error";
+        Result.ErrorMessage = e.what();
+    }
+    
+    Result.HardwareErrors = Callbacks.HardwareErrors;
+    Result.FirstErrorCode = Callbacks.FirstErrorCode;
+    Result.PeakMemoryKilobytes = GetPeakMemoryKilobytes();
+    
+    if( Result.Status == "ok" && Result.HardwareErrors > 0 )
+      Result.Status = "fault";
+    
+    return Result;
+}
+
+// -----------------------------------------------------------------------------
+
+// results are a single line, so that isolated
+// runs can just print them for the main process
+string FormatResult( const CartridgeResult& Result )
+{
+    char Numbers[ 512 ];
+    
+    snprintf
+    (
+        Numbers, sizeof(Numbers),
+        "\"frames\": %d, \"load_ms\": %.3f, \"fps\": %.1f, \"cpu_load\": %.2f, \"gpu_load\": %.2f, "
+        "\"hardware_errors\": %d, \"first_error_code\": %d, \"peak_rss_kb\": %ld, "
+        "\"digest\": \"%016llx\", \"ram_digest\": \"%016llx\", \"cpu_digest\": \"%016llx\", "
+        "\"gpu_digest\": \"%016llx\", \"spu_digest\": \"%016llx\", \"sound_digest\": \"%016llx\"",
+        Result.FramesRun, Result.LoadMilliseconds, Result.FramesPerSecond, Result.CPULoad, Result.GPULoad,
+        Result.HardwareErrors, Result.FirstErrorCode, Result.PeakMemoryKilobytes,
+        (unsigned long long)Result.FinalDigest.Combined, (unsigned long long)Result.FinalDigest.RAM,
+        (unsigned long long)Result.FinalDigest.CPU, (unsigned long long)Result.FinalDigest.GPU,
+        (unsigned long long)Result.FinalDigest.SPU, (unsigned long long)Result.FinalDigest.SoundOutput
+    );
+    
+    return "{ \"cartridge\": " + JSONString( Result.FileName )
+         + ", \"status\": " + JSONString( Result.Status )
+         + ", \"error\": " + JSONString( Result.ErrorMessage )
+         + ", " + Numbers + " }";
+}
+
+// -----------------------------------------------------------------------------
+
+// the same program is run again for a single
+// cartridge, and its printed result is read
+string RunIsolatedCartridge( const RunOptions& Options, const string& ProgramPath, const string& FileName )
+{
+    // on windows paths are quoted with "" and elsewhere
+    // with '', which needs no other escaping for shells
+    #if defined(__WIN32__)
+      auto Quote = []( const string& Text ){ return "\"" + Text + "\""; };
+    #else
+      auto Quote = []( const string& Text )
+      {
+          string Result = "'";
+          
+          for( char Character: Text )
+            Result += (Character == '\''? string( "'\\''" ) : string( 1, Character ));
+          
+          return Result + "'";
+      };
+    #endif
+    
+    string Command = Quote( ProgramPath ) + " --single " + Quote( FileName )
+                   + " --frames " + to_string( Options.Frames );
+    
+    if( !Options.BiosPath.empty() )
+      Command += " --bios " + Quote( Options.BiosPath );
+    
+    Command += " " + Quote( Options.CartridgeFolder );
+    
+    #if defined(__WIN32__)
+      FILE* Output = _popen( Command.c_str(), "r" );
+    #else
+      FILE* Output = popen( Command.c_str(), "r" );
+    #endif
+    
+    string Line;
+    
+    if( Output )
+    {
+        char Buffer[ 1024 ];
+        
+        while( fgets( Buffer, sizeof(Buffer), Output ) )
+          Line += Buffer;
+        
+        #if defined(__WIN32__)
+          _pclose( Output );
+        #else
+          pclose( Output );
+        #endif
+    }
+    
+    // keep only the last line, with the result
+    while( !Line.empty() && (Line.back() == '\n' || Line.back() == '\r') )
+      Line.pop_back();
+    
+    size_t LastLineStart = Line.find_last_of( '\n' );
+    
+    if( LastLineStart != string::npos )
+      Line = Line.substr( LastLineStart + 1 );
+    
+    // a crashed process gives no result
+    if( Line.empty() || Line[ 0 ] != '{' )
+    {
+        CartridgeResult Failed;
+        memset( &Failed.FinalDigest, 0, sizeof(FrameDigest) );
+        Failed.FileName = FileName;
+        Failed.Status = "error";
+        Failed.ErrorMessage = "process ended with no result";
+        Failed.FramesRun = 0;
+        Failed.LoadMilliseconds = Failed.FramesPerSecond = 0;
+        Failed.CPULoad = Failed.GPULoad = 0;
+        Failed.HardwareErrors = 0;
+        Failed.FirstErrorCode = -1;
+        Failed.PeakMemoryKilobytes = 0;
+        return FormatResult( Failed );
+    }
+    
+    return Line;
+}
+
+
+// =============================================================================
+//      RUNNING ALL CARTRIDGES
+// =============================================================================
+
+
+// the pool has a fixed number of threads, each of
+// them taking the next cartridge when it finishes
+bool RunAllCartridges( const RunOptions& Options, const string& ProgramPath )
+{
+    vector< string > FileNames = ListCartridges( Options.CartridgeFolder );
+    
+    if( FileNames.empty() )
+      throw runtime_error( "no cartridges found in \"" + Options.CartridgeFolder + "\"" );
+    
+    vector< string > Results( FileNames.size() );
+    atomic< unsigned > NextCartridge( 0 );
+    atomic< unsigned > FinishedCartridges( 0 );
+    atomic< bool > AllPassed( true );
+    mutex ProgressMutex;
+    
+    auto Worker = [&]()
+    {
+        while( true )
+        {
+            unsigned Index = NextCartridge++;
+            
+            if( Index >= FileNames.size() )
+              return;
+            
+            string StatusText;
+            
+            if( Options.Isolated )
+            {
+                Results[ Index ] = RunIsolatedCartridge( Options, ProgramPath, FileNames[ Index ] );
+                bool Passed = (Results[ Index ].find( "\"status\": \"ok\"" ) != string::npos);
+                StatusText = (Passed? "ok" : "failed");
+                
+                if( !Passed )
+                  AllPassed = false;
+            }
+            
+            else
+            {
+                CartridgeResult Result = RunCartridge( Options, FileNames[ Index ] );
+                Results[ Index ] = FormatResult( Result );
+                StatusText = Result.Status + ", " + to_string( (int)Result.FramesPerSecond ) + " fps";
+                
+                if( Result.Status != "ok" )
+                  AllPassed = false;
+            }
+            
+            lock_guard< mutex > Lock( ProgressMutex );
+            printf( "[%u/%u] %s: %s\n", ++FinishedCartridges, (unsigned)FileNames.size(), FileNames[ Index ].c_str(), StatusText.c_str() );
+            fflush( stdout );
+        }
+    };
+    
+    auto RunStart = chrono::steady_clock::now();
+    vector< thread > Workers;
+    
+    for( int i = 0; i < min( Options.Jobs, (int)FileNames.size() ); i++ )
+      Workers.emplace_back( Worker );
+    
+    for( thread& Worker: Workers )
+      Worker.join();
+    
+    auto RunEnd = chrono::steady_clock::now();
+    double TotalSeconds = chrono::duration< double >( RunEnd - RunStart ).count();
+    
+    // write all results in a single JSON file
+    ofstream OutputFile( Options.OutputPath );
+    
+    if( !OutputFile.is_open() )
+      throw runtime_error( "cannot create results file \"" + Options.OutputPath + "\"" );
+    
+    OutputFile << "{\n";
+    OutputFile << "  \"frames_per_cartridge\": " << Options.Frames << ",\n";
+    OutputFile << "  \"jobs\": " << Options.Jobs << ",\n";
+    OutputFile << "  \"isolated\": " << (Options.Isolated? "true" : "false") << ",\n";
+    OutputFile << "  \"total_seconds\": " << TotalSeconds << ",\n";
+    OutputFile << "  \"process_peak_rss_kb\": " << GetPeakMemoryKilobytes() << ",\n";
+    OutputFile << "  \"all_passed\": " << (AllPassed? "true" : "false") << ",\n";
+    OutputFile << "  \"cartridges\":\n  [\n";
+    
+    for( unsigned i = 0; i < Results.size(); i++ )
+      OutputFile << "    " << Results[ i ] << (i + 1 < Results.size()? ",\n" : "\n");
+    
+    OutputFile << "  ]\n}\n";
+    
+    printf( "%u cartridges run in %.2f s, results saved to \"%s\"\n", (unsigned)FileNames.size(), TotalSeconds, Options.OutputPath.c_str() );
+    return AllPassed;
+}
+
+
+// =============================================================================
+//      MAIN FUNCTION
+// =============================================================================
+
+
+void PrintUsage()
+{
+    printf( "USAGE: vircon32_regression [options] <cartridge folder>\n" );
+    printf( "Options:\n" );
+    printf( "  --frames <N>      Number of frames to run per cartridge (default: 3600)\n" );
+    printf( "  --jobs <N>        Number of cartridges run at the same time (default: all cores)\n" );
+    printf( "  --isolate         Run each cartridge in its own process\n" );
+    printf( "  --bios <file>     Use this bios instead of the standard one\n" );
+    printf( "  --output <file>   Results file (default: regression.json)\n" );
+    printf( "A movie with the same name as a cartridge (.v32movie) gives\n" );
+    printf( "the inputs for its first frames. Peak memory is only measured\n" );
+    printf( "per cartridge with --isolate; otherwise it is for all runs.\n" );
+}
+
+// -----------------------------------------------------------------------------
+
+int main( int NumberOfArguments, char* Arguments[] )
+{
+    RunOptions Options;
+    Options.OutputPath = "regression.json";
+    Options.Frames = 3600;
+    Options.Jobs = max( 1u, thread::hardware_concurrency() );
+    Options.Isolated = false;
+    string SingleCartridge;
+    
+    // process command line arguments
+    for( int i = 1; i < NumberOfArguments; i++ )
+    {
+        string Argument = Arguments[ i ];
+        
+        if( Argument == "--frames" && i + 1 < NumberOfArguments )
+          Options.Frames = max( 1, atoi( Arguments[ ++i ] ) );
+        
+        else if( Argument == "--jobs" && i + 1 < NumberOfArguments )
+          Options.Jobs = max( 1, atoi( Arguments[ ++i ] ) );
+        
+        else if( Argument == "--isolate" )
+          Options.Isolated = true;
+        
+        else if( Argument == "--bios" && i + 1 < NumberOfArguments )
+          Options.BiosPath = Arguments[ ++i ];
+        
+        else if( Argument == "--output" && i + 1 < NumberOfArguments )
+          Options.OutputPath = Arguments[ ++i ];
+        
+        // used internally for isolated runs
+        else if( Argument == "--single" && i + 1 < NumberOfArguments )
+          SingleCartridge = Arguments[ ++i ];
+        
+        else if( Argument[ 0 ] == '-' || !Options.CartridgeFolder.empty() )
+        {
+            PrintUsage();
+            return 1;
+        }
+        
+        else Options.CartridgeFolder = Argument;
+    }
+    
+    if( Options.CartridgeFolder.empty() )
+    {
+        PrintUsage();
+        return 1;
+    }
+    
+    try
+    {
+        if( Options.BiosPath.empty() )
+          BiosBytes.assign( (const char*)embedded_StandardBios, sizeof( embedded_StandardBios ) );
+        
+        else
+        {
+            ifstream BiosFile( Options.BiosPath, ios_base::binary );
+            
+            if( !BiosFile.is_open() )
+              throw runtime_error( "cannot open bios \"" + Options.BiosPath + "\"" );
+            
+            BiosBytes.assign( istreambuf_iterator< char >( BiosFile ), istreambuf_iterator< char >() );
+        }
+        
+        if( !SingleCartridge.empty() )
+        {
+            printf( "%s\n", FormatResult( RunCartridge( Options, SingleCartridge ) ).c_str() );
+            return 0;
+        }
+        
+        return RunAllCartridges( Options, Arguments[ 0 ] )? 0 : 1;
+    }
+    
+    catch( exception& e )
+    {
+        printf( "FAILED: %s\n", e.what() );
+        return 1;
+    }
+}
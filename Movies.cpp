@@ -0,0 +1,313 @@
+// *****************************************************************************
+    // include Vircon32 headers
+    #include "ConsoleLogic/V32Console.hpp"
+    
+    // include emulator headers
+    #include "Movies.hpp"
+    
+    // include C/C++ headers
+    #include <cstring>          // [ ANSI C ] Strings
+    #include <fstream>          // [ C++ STL ] File streams
+    
+    // declare used namespaces
+    using namespace std;
+    using namespace V32;
+// *****************************************************************************
+
+
+// =============================================================================
+//      INPUT MOVIE: INSTANCE HANDLING
+// =============================================================================
+
+
+// increase this when the file format changes
+static const uint32_t MovieVersion = 1;
+
+// -----------------------------------------------------------------------------
+
+InputMovie::InputMovie( V32Console& MovieConsole ):
+    Console( MovieConsole )
+{
+    Mode = MovieModes::Disabled;
+    NextFrame = 0;
+    memset( &Header, 0, sizeof(MovieHeader) );
+}
+
+
+// =============================================================================
+//      INPUT MOVIE: FILE HANDLING
+// =============================================================================
+
+
+bool InputMovie::SaveFile()
+{
+    // join equal consecutive frames into blocks
+    vector< MovieBlock > Blocks;
+    
+    for( const MovieFrame& Frame: Frames )
+    {
+        if( !Blocks.empty() && Blocks.back().Frames < 0xFFFF && !memcmp( &Blocks.back().Inputs, &Frame, sizeof(MovieFrame) ) )
+        {
+            Blocks.back().Frames++;
+            continue;
+        }
+        
+        MovieBlock NewBlock;
+        NewBlock.Frames = 1;
+        NewBlock.Inputs = Frame;
+        Blocks.push_back( NewBlock );
+    }
+    
+    Header.NumberOfFrames = Frames.size();
+    Header.NumberOfBlocks = Blocks.size();
+    
+    // write the whole file
+    ofstream OutputFile( FilePath, ios_base::binary );
+    
+    if( !OutputFile.is_open() )
+      return false;
+    
+    OutputFile.write( (const char*)&Header, sizeof(MovieHeader) );
+    
+    if( !Blocks.empty() )
+      OutputFile.write( (const char*)&Blocks[ 0 ], Blocks.size() * sizeof(MovieBlock) );
+    
+    return OutputFile.good();
+}
+
+// -----------------------------------------------------------------------------
+
+bool InputMovie::LoadFile()
+{
+    ifstream InputFile( FilePath, ios_base::binary );
+    
+    if( !InputFile.is_open() )
+    {
+        Console.Callbacks->LogLine( "ERROR: Cannot open movie file \"" + FilePath + "\"" );
+        return false;
+    }
+    
+    // check the header
+    InputFile.read( (char*)&Header, sizeof(MovieHeader) );
+    
+    if( !InputFile.good() || memcmp( Header.Signature, "V32-MOVI", 8 ) )
+    {
+        Console.Callbacks->LogLine( "ERROR: File \"" + FilePath + "\" is not a Vircon32 movie" );
+        return false;
+    }
+    
+    if( Header.Version != MovieVersion )
+    {
+        Console.Callbacks->LogLine( "ERROR: Movie version " + to_string( Header.Version ) + " is not supported" );
+        return false;
+    }
+    
+    // movies from other games would not make sense
+    GameInfo CurrentGame;
+    SaveGameInfo( Console, CurrentGame );
+    
+    if( memcmp( &Header.Game, &CurrentGame, sizeof(GameInfo) ) )
+    {
+        Console.Callbacks->LogLine( "ERROR: Cannot play movie. Current cartridge is not the same one that was recorded" );
+        return false;
+    }
+    
+    // read and expand all blocks
+    vector< MovieBlock > Blocks( Header.NumberOfBlocks );
+    
+    if( !Blocks.empty() )
+      InputFile.read( (char*)&Blocks[ 0 ], Blocks.size() * sizeof(MovieBlock) );
+    
+    if( !InputFile.good() )
+    {
+        Console.Callbacks->LogLine( "ERROR: Movie file \"" + FilePath + "\" is truncated" );
+        return false;
+    }
+    
+    Frames.clear();
+    Frames.reserve( Header.NumberOfFrames );
+    
+    for( const MovieBlock& Block: Blocks )
+      Frames.insert( Frames.end(), Block.Frames, Block.Inputs );
+    
+    if( Frames.size() != Header.NumberOfFrames )
+    {
+        Console.Callbacks->LogLine( "ERROR: Movie file \"" + FilePath + "\" is corrupted" );
+        return false;
+    }
+    
+    return true;
+}
+
+
+// =============================================================================
+//      INPUT MOVIE: MOVIE CONTROL
+// =============================================================================
+
+
+void InputMovie::StartFromReset()
+{
+    if( Console.IsPowerOn() )
+      Console.Reset();
+    else
+      Console.SetPower( true );
+    
+    // a reset keeps the gamepad states, so disconnect all
+    // of them to get the same state for recording and replay
+    // (connections are restored by the first movie frame)
+    for( int Port = 0; Port < Constants::GamepadPorts; Port++ )
+      Console.SetGamepadConnection( Port, false );
+    
+    NextFrame = 0;
+}
+
+// -----------------------------------------------------------------------------
+
+bool InputMovie::StartRecording( const string& MoviePath )
+{
+    Stop();
+    
+    // connections are recorded from the console, so
+    // keep them through the reset to record them too
+    bool Connected[ Constants::GamepadPorts ];
+    
+    for( int Port = 0; Port < Constants::GamepadPorts; Port++ )
+      Connected[ Port ] = Console.HasGamepad( Port );
+    
+    StartFromReset();
+    
+    // a reset keeps the current date and time
+    memset( &Header, 0, sizeof(MovieHeader) );
+    memcpy( Header.Signature, "V32-MOVI", 8 );
+    Header.Version = MovieVersion;
+    SaveGameInfo( Console, Header.Game );
+    Header.StartDate = Console.Timer.CurrentDate;
+    Header.StartTime = Console.Timer.CurrentTime;
+    Header.RNGSeed = Console.RNG.CurrentValue;
+    
+    for( int Port = 0; Port < Constants::GamepadPorts; Port++ )
+      Console.SetGamepadConnection( Port, Connected[ Port ] );
+    
+    Frames.clear();
+    FilePath = MoviePath;
+    Mode = MovieModes::Recording;
+    
+    Console.Callbacks->LogLine( "Recording movie to \"" + FilePath + "\"" );
+    return true;
+}
+
+// -----------------------------------------------------------------------------
+
+bool InputMovie::StartReplay( const string& MoviePath )
+{
+    Stop();
+    FilePath = MoviePath;
+    
+    if( !LoadFile() )
+    {
+        Frames.clear();
+        return false;
+    }
+    
+    StartFromReset();
+    Console.Timer.CurrentDate = Header.StartDate;
+    Console.Timer.CurrentTime = Header.StartTime;
+    Console.RNG.CurrentValue = Header.RNGSeed;
+    Mode = MovieModes::Replaying;
+    
+    Console.Callbacks->LogLine( "Replaying movie \"" + FilePath + "\" (" + to_string( Frames.size() ) + " frames)" );
+    return true;
+}
+
+// -----------------------------------------------------------------------------
+
+// recordings are only saved when stopped
+void InputMovie::Stop()
+{
+    if( Mode == MovieModes::Recording )
+    {
+        if( SaveFile() )
+          Console.Callbacks->LogLine( "Movie saved to \"" + FilePath + "\" (" + to_string( Frames.size() ) + " frames)" );
+        else
+          Console.Callbacks->LogLine( "ERROR: Cannot save movie to \"" + FilePath + "\"" );
+    }
+    
+    else if( Mode == MovieModes::Replaying )
+      Console.Callbacks->LogLine( "Movie replay stopped at frame " + to_string( NextFrame ) );
+    
+    Mode = MovieModes::Disabled;
+    Frames.clear();
+    Frames.shrink_to_fit();
+}
+
+
+// =============================================================================
+//      INPUT MOVIE: STATUS
+// =============================================================================
+
+
+MovieModes InputMovie::GetMode()
+{
+    return Mode;
+}
+
+// -----------------------------------------------------------------------------
+
+uint32_t InputMovie::GetNumberOfFrames()
+{
+    return Frames.size();
+}
+
+// -----------------------------------------------------------------------------
+
+uint32_t InputMovie::GetCurrentFrame()
+{
+    return (Mode == MovieModes::Recording? Frames.size() : NextFrame);
+}
+
+
+// =============================================================================
+//      INPUT MOVIE: OPERATION
+// =============================================================================
+
+
+void InputMovie::ProcessFrame( MovieFrame& Inputs )
+{
+    if( Mode == MovieModes::Recording )
+      Frames.push_back( Inputs );
+    
+    else if( Mode == MovieModes::Replaying )
+    {
+        // at the end, give control back to the player
+        if( NextFrame >= Frames.size() )
+        {
+            Stop();
+            return;
+        }
+        
+        Inputs = Frames[ NextFrame++ ];
+    }
+}
+
+// -----------------------------------------------------------------------------
+
+void ApplyMovieFrame( V32Console& Console, const MovieFrame& Inputs )
+{
+    for( int Port = 0; Port < Constants::GamepadPorts; Port++ )
+    {
+        // a disconnection resets the gamepad,
+        // so only apply it when it changes
+        bool Connected = (Inputs.ConnectedGamepads >> Port) & 1;
+        
+        if( Connected != Console.HasGamepad( Port ) )
+          Console.SetGamepadConnection( Port, Connected );
+        
+        if( !Connected || !Inputs.ControlsRead )
+          continue;
+        
+        // controls are always given in the same order,
+        // since pressing a direction releases its opposite
+        for( int Control = 0; Control <= (int)GamepadControls::ButtonR; Control++ )
+          Console.SetGamepadControl( Port, (GamepadControls)Control, (Inputs.Controls[ Port ] >> Control) & 1 );
+    }
+}
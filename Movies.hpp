@@ -0,0 +1,137 @@
+// *****************************************************************************
+    // start include guard
+    #ifndef MOVIES_HPP
+    #define MOVIES_HPP
+    
+    // include emulator headers
+    #include "Savestates.hpp"
+    
+    // include C/C++ headers
+    #include <string>       // [ C++ STL ] Strings
+    #include <vector>       // [ C++ STL ] Vectors
+// *****************************************************************************
+
+
+// =============================================================================
+//      MOVIE FILE STRUCTURES
+// =============================================================================
+
+
+// inputs given to the console for a single frame
+typedef struct
+{
+    // bit N is set when port N has a gamepad
+    uint8_t ConnectedGamepads;
+    
+    // skipped frames don't poll the frontend,
+    // so their controls are left unchanged
+    uint8_t ControlsRead;
+    
+    // bit N is the state given for control N
+    // (in the order of enum GamepadControls)
+    uint16_t Controls[ V32::Constants::GamepadPorts ];
+}
+MovieFrame;
+
+// -----------------------------------------------------------------------------
+
+typedef struct
+{
+    char Signature[ 8 ];            // "V32-MOVI"
+    uint32_t Version;
+    uint32_t NumberOfFrames;
+    uint32_t NumberOfBlocks;
+    
+    // movies can only be played with the same game
+    GameInfo Game;
+    
+    // console state that is not set by a reset
+    int32_t StartDate;
+    int32_t StartTime;
+    int32_t RNGSeed;
+}
+MovieHeader;
+
+// -----------------------------------------------------------------------------
+
+// frames are stored run-length encoded, since
+// inputs usually stay the same for many frames
+typedef struct
+{
+    uint16_t Frames;
+    MovieFrame Inputs;
+}
+MovieBlock;
+
+
+// =============================================================================
+//      INPUT MOVIES
+// =============================================================================
+
+
+enum class MovieModes
+{
+    Disabled,
+    Recording,
+    Replaying
+};
+
+// -----------------------------------------------------------------------------
+
+// Movies start from a console reset and keep the inputs given for
+// every frame, so that replaying them gives the same emulation. Both
+// the recording and the replay begin with all gamepads reset to the
+// same state, and with the same date, time and RNG value. Memory card
+// contents are not part of the movie: replays that use a memory card
+// need to start with the same card contents that the recording had.
+class InputMovie
+{
+    private:
+    
+        // the movie is recorded or replayed on this console
+        V32::V32Console& Console;
+        
+        MovieModes Mode;
+        MovieHeader Header;
+        std::vector< MovieFrame > Frames;
+        uint32_t NextFrame;
+        std::string FilePath;
+        
+        // file handling
+        bool SaveFile();
+        bool LoadFile();
+        
+        // both modes start from the same console state
+        void StartFromReset();
+    
+    public:
+    
+        // instance handling
+        InputMovie( V32::V32Console& MovieConsole );
+        
+        // movie control
+        bool StartRecording( const std::string& MoviePath );
+        bool StartReplay( const std::string& MoviePath );
+        void Stop();
+        
+        // status
+        MovieModes GetMode();
+        uint32_t GetNumberOfFrames();
+        uint32_t GetCurrentFrame();
+        
+        // operation: before each frame this records
+        // the inputs, or replaces them on replays
+        void ProcessFrame( MovieFrame& Inputs );
+};
+
+// -----------------------------------------------------------------------------
+
+// live and replayed inputs are given to the console
+// with the same calls, so that the results match
+void ApplyMovieFrame( V32::V32Console& Console, const MovieFrame& Inputs );
+
+
+// *****************************************************************************
+    // end include guard
+    #endif
+// *****************************************************************************
@@ -0,0 +1,330 @@
+// *****************************************************************************
+    // include Vircon32 headers
+    #include "ConsoleLogic/V32Console.hpp"
+    
+    // include emulator headers
+    #include "Rewind.hpp"
+    #include "Globals.hpp"
+    #include "Logging.hpp"
+    
+    // include C/C++ headers
+    #include <cstddef>          // [ ANSI C ] Standard definitions
+    #include <cstring>          // [ ANSI C ] Strings
+    
+    // declare used namespaces
+    using namespace std;
+    using namespace V32;
+// *****************************************************************************
+
+
+// =============================================================================
+//      REWIND BUFFER: INSTANCE HANDLING
+// =============================================================================
+
+
+RewindBuffer::RewindBuffer()
+{
+    ImageIsValid = false;
+    DeltasBytes = 0;
+    MaximumBytes = 0;
+    
+    // temporary buffers must start with the same
+    // contents as the image, so that unused fields
+    // in them are never detected as changes
+    memset( &CurrentCPU, 0, sizeof(CPUState) );
+    memset( (void*)&CurrentSPU, 0, sizeof(SPUState) );
+    memset( &CurrentGamepadController, 0, sizeof(GamepadControllerState) );
+}
+
+
+// =============================================================================
+//      REWIND BUFFER: CONFIGURATION
+// =============================================================================
+
+
+void RewindBuffer::SetMaximumSize( size_t Bytes )
+{
+    if( Bytes == MaximumBytes )
+      return;
+    
+    MaximumBytes = Bytes;
+    Clear();
+    
+    // the image is only kept while enabled
+    if( !IsEnabled() )
+    {
+        Image.clear();
+        Image.shrink_to_fit();
+    }
+}
+
+// -----------------------------------------------------------------------------
+
+bool RewindBuffer::IsEnabled()
+{
+    return (MaximumBytes > 0);
+}
+
+// -----------------------------------------------------------------------------
+
+// must be called whenever the console state changes
+// by means other than running (reset, loading states)
+void RewindBuffer::Clear()
+{
+    Deltas.clear();
+    DeltasBytes = 0;
+    ImageIsValid = false;
+}
+
+
+// =============================================================================
+//      REWIND BUFFER: DELTA HANDLING
+// =============================================================================
+
+
+// Deltas are a sequence of records, each one formed by a start offset
+// within the image, a length in bytes and that many XORed bytes. Only
+// the compared ranges that differ are included, and short equal gaps
+// are merged into records to avoid a large number of tiny records.
+void RewindBuffer::CompareRange( size_t ImageOffset, const void* Current, size_t Length, vector< uint8_t >& Delta )
+{
+    // if the image was not valid, just take the current contents
+    uint8_t* ImageBytes = &Image[ ImageOffset ];
+    const uint8_t* CurrentBytes = (const uint8_t*)Current;
+    
+    if( !ImageIsValid )
+    {
+        memcpy( ImageBytes, CurrentBytes, Length );
+        return;
+    }
+    
+    // fast path for the most usual case
+    if( !memcmp( ImageBytes, CurrentBytes, Length ) )
+      return;
+    
+    const size_t MinimumGap = 16;
+    size_t Position = 0;
+    
+    while( Position < Length )
+    {
+        // skip equal bytes
+        if( ImageBytes[ Position ] == CurrentBytes[ Position ] )
+        {
+            Position++;
+            continue;
+        }
+        
+        // find the end of this differing stretch
+        size_t Start = Position;
+        size_t LastDifference = Position;
+        
+        while( Position < Length && (Position - LastDifference) < MinimumGap )
+        {
+            if( ImageBytes[ Position ] != CurrentBytes[ Position ] )
+              LastDifference = Position;
+            
+            Position++;
+        }
+        
+        // write the record header
+        uint32_t RecordOffset = ImageOffset + Start;
+        uint32_t RecordLength = LastDifference + 1 - Start;
+        size_t RecordStart = Delta.size();
+        
+        Delta.resize( RecordStart + 8 + RecordLength );
+        memcpy( &Delta[ RecordStart ], &RecordOffset, 4 );
+        memcpy( &Delta[ RecordStart + 4 ], &RecordLength, 4 );
+        
+        // write XORed bytes and update the image
+        uint8_t* RecordBytes = &Delta[ RecordStart + 8 ];
+        
+        for( uint32_t i = 0; i < RecordLength; i++ )
+        {
+            RecordBytes[ i ] = ImageBytes[ Start + i ] ^ CurrentBytes[ Start + i ];
+            ImageBytes[ Start + i ] = CurrentBytes[ Start + i ];
+        }
+        
+        Position = LastDifference + 1;
+    }
+}
+
+// -----------------------------------------------------------------------------
+
+// applies the delta to the image and to the console; since deltas
+// are XORs, the same delta is used to go in both directions
+void RewindBuffer::ApplyDelta( const vector< uint8_t >& Delta )
+{
+    const size_t RAMStart = offsetof( ConsoleState, Others.RAM );
+    const size_t RAMEnd = RAMStart + sizeof(OtherConsoleState::RAM);
+    const size_t TexturesStart = offsetof( ConsoleState, GPU.CartridgeTextures );
+    const size_t PageBytes = GPURegionPageSize * sizeof(GPURegion);
+    size_t Position = 0;
+    
+    while( Position < Delta.size() )
+    {
+        uint32_t RecordOffset, RecordLength;
+        memcpy( &RecordOffset, &Delta[ Position ], 4 );
+        memcpy( &RecordLength, &Delta[ Position + 4 ], 4 );
+        
+        const uint8_t* RecordBytes = &Delta[ Position + 8 ];
+        uint8_t* ImageBytes = &Image[ RecordOffset ];
+        
+        for( uint32_t i = 0; i < RecordLength; i++ )
+          ImageBytes[ i ] ^= RecordBytes[ i ];
+        
+        // records never cross RAM pages or region pages,
+        // so they can be copied to the console right away
+        if( RecordOffset >= RAMStart && RecordOffset < RAMEnd )
+        {
+            uint32_t RAMOffset = RecordOffset - RAMStart;
+            memcpy( (uint8_t*)&Console.RAM.Memory[ 0 ] + RAMOffset, ImageBytes, RecordLength );
+            
+            int32_t Page = (RAMOffset / 4) >> RAMPageSizeBits;
+            Console.RAM.SetPageDirty( Page, true );
+            Console.RAM.MarkPageChanged( Page );
+            ImagePages[ Page >> 6 ] |= ((uint64_t)1 << (Page & 63));
+        }
+        
+        else if( RecordOffset >= TexturesStart )
+        {
+            uint32_t TexturesOffset = RecordOffset - TexturesStart;
+            uint32_t TextureID = TexturesOffset / sizeof(GPUTexture);
+            uint32_t TextureOffset = TexturesOffset % sizeof(GPUTexture);
+            
+            uint32_t Page = TextureOffset / PageBytes;
+            uint8_t* PageRegions = (uint8_t*)Console.GPU.CartridgeTextures[ TextureID ].GetWritablePage( Page );
+            memcpy( PageRegions + TextureOffset % PageBytes, ImageBytes, RecordLength );
+            
+            Console.GPU.ModifiedCartridgeTextures[ TextureID ] = true;
+            ImageTextures[ TextureID ] = true;
+        }
+        
+        Position += 8 + RecordLength;
+    }
+}
+
+
+// =============================================================================
+//      REWIND BUFFER: OPERATION
+// =============================================================================
+
+
+// called after each frame to store the new state
+void RewindBuffer::CaptureState()
+{
+    if( !IsEnabled() || !Console.HasCartridge() )
+      return;
+    
+    V32RAM& RAM = Console.RAM;
+    V32GPU& GPU = Console.GPU;
+    
+    // on the first capture, reset the image
+    // so that it has the same layout as a
+    // full state with only the used textures
+    if( !ImageIsValid )
+    {
+        size_t UnusedTextures = Constants::GPUMaximumCartridgeTextures - GPU.LoadedCartridgeTextures;
+        Image.assign( sizeof(ConsoleState) - UnusedTextures * sizeof(GPUTexture), 0 );
+        ImagePages.assign( RAM.DirtyPages.size(), 0 );
+        ImageTextures.assign( GPU.LoadedCartridgeTextures, false );
+    }
+    
+    vector< uint8_t > Delta;
+    
+    // compare all small console parts
+    SaveCPUState( Console, CurrentCPU );
+    SaveSPUState( Console, CurrentSPU );
+    SaveGamepadControllerState( Console, CurrentGamepadController );
+    
+    CompareRange( offsetof( ConsoleState, CPU ), &CurrentCPU, sizeof(CPUState), Delta );
+    CompareRange( offsetof( ConsoleState, SPU ), &CurrentSPU, sizeof(SPUState), Delta );
+    CompareRange( offsetof( ConsoleState, GamepadController ), &CurrentGamepadController, sizeof(GamepadControllerState), Delta );
+    CompareRange( offsetof( ConsoleState, Others.TimerRegisters ), &Console.Timer.CurrentDate, sizeof(OtherConsoleState::TimerRegisters), Delta );
+    CompareRange( offsetof( ConsoleState, Others.RNGCurrentValue ), &Console.RNG.CurrentValue, sizeof(int32_t), Delta );
+    CompareRange( offsetof( ConsoleState, GPU.Registers ), &GPU.Command, sizeof(GPUState::Registers), Delta );
+    
+    // compare textures that may be non-zero,
+    // either in the console or in the image
+    // (each region page is compared separately)
+    const size_t RegionPageBytes = GPURegionPageSize * sizeof(GPURegion);
+    
+    for( unsigned TextureID = 0; TextureID < GPU.LoadedCartridgeTextures; TextureID++ )
+      if( GPU.ModifiedCartridgeTextures[ TextureID ] || ImageTextures[ TextureID ] )
+      {
+          size_t Offset = offsetof( ConsoleState, GPU.CartridgeTextures ) + TextureID * sizeof(GPUTexture);
+          
+          for( int32_t Page = 0; Page < GPURegionPagesPerTexture; Page++ )
+            CompareRange( Offset + Page * RegionPageBytes, GPU.CartridgeTextures[ TextureID ].GetPage( Page ), RegionPageBytes, Delta );
+          
+          ImageTextures[ TextureID ] = GPU.ModifiedCartridgeTextures[ TextureID ];
+      }
+    
+    // same for RAM pages, checking 64 of them at once
+    const size_t PageBytes = RAMPageSize * sizeof(V32Word);
+    
+    for( size_t Word = 0; Word < ImagePages.size(); Word++ )
+    {
+        uint64_t ComparedPages = RAM.DirtyPages[ Word ] | ImagePages[ Word ];
+        
+        for( int Bit = 0; ComparedPages; Bit++, ComparedPages >>= 1 )
+          if( ComparedPages & 1 )
+          {
+              int32_t Page = Word * 64 + Bit;
+              size_t Offset = offsetof( ConsoleState, Others.RAM ) + Page * PageBytes;
+              CompareRange( Offset, &RAM.Memory[ Page << RAMPageSizeBits ], PageBytes, Delta );
+          }
+        
+        ImagePages[ Word ] = RAM.DirtyPages[ Word ];
+    }
+    
+    // the first capture has nothing to go back to
+    if( !ImageIsValid )
+    {
+        ImageIsValid = true;
+        return;
+    }
+    
+    // store this delta, even if empty, so that
+    // each step back is always a single frame
+    DeltasBytes += Delta.size();
+    Deltas.push_back( std::move( Delta ) );
+    
+    // discard the oldest deltas when over budget
+    while( DeltasBytes > MaximumBytes && !Deltas.empty() )
+    {
+        DeltasBytes -= Deltas.front().size();
+        Deltas.pop_front();
+    }
+}
+
+// -----------------------------------------------------------------------------
+
+// goes back to the previously captured state
+bool RewindBuffer::StepBack()
+{
+    if( !ImageIsValid || Deltas.empty() )
+      return false;
+    
+    // apply the newest delta
+    ApplyDelta( Deltas.back() );
+    DeltasBytes -= Deltas.back().size();
+    Deltas.pop_back();
+    
+    // now load all small console parts from the image
+    const ConsoleState* State = (const ConsoleState*)&Image[ 0 ];
+    
+    LoadCPUState( Console, State->CPU );
+    LoadSPUState( Console, State->SPU );
+    LoadGamepadControllerState( Console, State->GamepadController );
+    memcpy( &Console.Timer.CurrentDate, State->Others.TimerRegisters, sizeof(State->Others.TimerRegisters) );
+    Console.RNG.CurrentValue = State->Others.RNGCurrentValue;
+    
+    return LoadGPURegisters( Console, State->GPU.Registers );
+}
+
+// -----------------------------------------------------------------------------
+
+unsigned RewindBuffer::GetStoredStates()
+{
+    return Deltas.size();
+}
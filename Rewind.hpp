@@ -0,0 +1,75 @@
+// *****************************************************************************
+    // start include guard
+    #ifndef REWIND_HPP
+    #define REWIND_HPP
+    
+    // include emulator headers
+    #include "Savestates.hpp"
+    
+    // include C/C++ headers
+    #include <vector>       // [ C++ STL ] Vectors
+    #include <deque>        // [ C++ STL ] Double-ended queues
+// *****************************************************************************
+
+
+// =============================================================================
+//      IN-CORE REWIND BUFFER
+// =============================================================================
+
+
+// The buffer keeps an image of the latest captured state, laid out as
+// a full ConsoleState, plus a list of XOR deltas against each previous
+// state. Deltas only store the non-zero stretches of each XOR, and are
+// only computed for the parts of the console that may have changed:
+// dirty RAM pages, modified cartridge textures and all small registers.
+// Like run-ahead, rewind is only for the core: it always works on the
+// global console, so other programs should not use it.
+class RewindBuffer
+{
+    private:
+    
+        // image of the latest captured state
+        std::vector< uint8_t > Image;
+        bool ImageIsValid;
+        
+        // RAM pages and textures that may not be
+        // all zeroes within the state image
+        std::vector< uint64_t > ImagePages;
+        std::vector< bool > ImageTextures;
+        
+        // deltas to go back from each state to the
+        // previous one, where the last is the newest
+        std::deque< std::vector< uint8_t > > Deltas;
+        size_t DeltasBytes;
+        size_t MaximumBytes;
+        
+        // temporary buffers for small console parts
+        CPUState CurrentCPU;
+        SPUState CurrentSPU;
+        GamepadControllerState CurrentGamepadController;
+        
+        // delta handling
+        void CompareRange( size_t ImageOffset, const void* Current, size_t Length, std::vector< uint8_t >& Delta );
+        void ApplyDelta( const std::vector< uint8_t >& Delta );
+    
+    public:
+    
+        // instance handling
+        RewindBuffer();
+        
+        // configuration
+        void SetMaximumSize( size_t Bytes );
+        bool IsEnabled();
+        void Clear();
+        
+        // operation
+        void CaptureState();
+        bool StepBack();
+        unsigned GetStoredStates();
+};
+
+
+// *****************************************************************************
+    // end include guard
+    #endif
+// *****************************************************************************
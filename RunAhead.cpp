@@ -0,0 +1,237 @@
+// *****************************************************************************
+    // include Vircon32 headers
+    #include "ConsoleLogic/V32Console.hpp"
+    
+    // include emulator headers
+    #include "RunAhead.hpp"
+    #include "Globals.hpp"
+    #include "Logging.hpp"
+    
+    // include C/C++ headers
+    #include <cstring>          // [ ANSI C ] Strings
+    
+    // declare used namespaces
+    using namespace std;
+    using namespace V32;
+// *****************************************************************************
+
+
+// =============================================================================
+//      RUN-AHEAD SNAPSHOT: INSTANCE HANDLING
+// =============================================================================
+
+
+RunAheadSnapshot::RunAheadSnapshot()
+{
+    IsValid = false;
+}
+
+
+// =============================================================================
+//      RUN-AHEAD SNAPSHOT: MEMORY SYNCHRONIZATION
+// =============================================================================
+
+
+// returns true if any page was copied
+bool RunAheadSnapshot::SaveWrittenPages( V32RAM& Memory, vector< V32Word >& Shadow )
+{
+    bool AnyPageCopied = false;
+    
+    for( int32_t Page = 0; Page < Memory.NumberOfPages; Page++ )
+    {
+        // skip 64 unwritten pages at once
+        if( !Memory.WrittenPages[ Page >> 6 ] )
+        {
+            Page |= 63;
+            continue;
+        }
+        
+        if( !Memory.IsPageWritten( Page ) )
+          continue;
+        
+        // the last page may be incomplete
+        int32_t FirstWord = Page << RAMPageSizeBits;
+        int32_t Words = min( RAMPageSize, Memory.MemorySize - FirstWord );
+        memcpy( &Shadow[ FirstWord ], &Memory.Memory[ FirstWord ], Words * sizeof(V32Word) );
+        AnyPageCopied = true;
+    }
+    
+    Memory.ClearWrittenPages();
+    return AnyPageCopied;
+}
+
+// -----------------------------------------------------------------------------
+
+bool RunAheadSnapshot::RestoreWrittenPages( V32RAM& Memory, vector< V32Word >& Shadow )
+{
+    bool AnyPageCopied = false;
+    
+    for( int32_t Page = 0; Page < Memory.NumberOfPages; Page++ )
+    {
+        // skip 64 unwritten pages at once
+        if( !Memory.WrittenPages[ Page >> 6 ] )
+        {
+            Page |= 63;
+            continue;
+        }
+        
+        if( !Memory.IsPageWritten( Page ) )
+          continue;
+        
+        // the last page may be incomplete
+        int32_t FirstWord = Page << RAMPageSizeBits;
+        int32_t Words = min( RAMPageSize, Memory.MemorySize - FirstWord );
+        memcpy( &Memory.Memory[ FirstWord ], &Shadow[ FirstWord ], Words * sizeof(V32Word) );
+        Memory.SetPageDirty( Page, true );
+        Memory.MarkPageChanged( Page );
+        AnyPageCopied = true;
+    }
+    
+    Memory.ClearWrittenPages();
+    return AnyPageCopied;
+}
+
+
+// =============================================================================
+//      RUN-AHEAD SNAPSHOT: OPERATION
+// =============================================================================
+
+
+// must be called whenever the console state changes
+// by means other than running (reset, loading states)
+void RunAheadSnapshot::Invalidate()
+{
+    IsValid = false;
+}
+
+// -----------------------------------------------------------------------------
+
+void RunAheadSnapshot::Save()
+{
+    V32RAM& RAM = Console.RAM;
+    V32RAM& MemoryCard = Console.MemoryCardController;
+    V32GPU& GPU = Console.GPU;
+    
+    // when not valid, copy all memory pages
+    if( !IsValid )
+    {
+        ShadowRAM.resize( RAM.MemorySize );
+        ShadowMemoryCard.resize( MemoryCard.MemorySize );
+        RAM.MarkAllPagesWritten();
+        MemoryCard.MarkAllPagesWritten();
+        IsValid = true;
+    }
+    
+    SaveWrittenPages( RAM, ShadowRAM );
+    SaveWrittenPages( MemoryCard, ShadowMemoryCard );
+    
+    // save all small console parts
+    SaveCPUState( Console, CPU );
+    SaveSPUState( Console, SPU );
+    SaveGamepadControllerState( Console, GamepadController );
+    memcpy( TimerRegisters, &Console.Timer.CurrentDate, sizeof(TimerRegisters) );
+    RNGCurrentValue = Console.RNG.CurrentValue;
+    memcpy( GPURegisters, &GPU.Command, sizeof(GPURegisters) );
+    
+    // save allocated region pages; games usually
+    // define their regions only once, so these
+    // are just a few pages for a few textures
+    memcpy( ModifiedTextures, GPU.ModifiedCartridgeTextures, sizeof(ModifiedTextures) );
+    SavedRegionPages.assign( GPU.LoadedCartridgeTextures * GPURegionPagesPerTexture, false );
+    RegionPageIndices.clear();
+    RegionPages.clear();
+    
+    for( unsigned TextureID = 0; TextureID < GPU.LoadedCartridgeTextures; TextureID++ )
+    {
+        if( !GPU.ModifiedCartridgeTextures[ TextureID ] )
+          continue;
+        
+        const GPURegionTable& Texture = GPU.CartridgeTextures[ TextureID ];
+        
+        for( int32_t Page = 0; Page < GPURegionPagesPerTexture; Page++ )
+          if( Texture.IsPageAllocated( Page ) )
+          {
+              uint32_t PageIndex = TextureID * GPURegionPagesPerTexture + Page;
+              SavedRegionPages[ PageIndex ] = true;
+              RegionPageIndices.push_back( PageIndex );
+              
+              const GPURegion* PageRegions = Texture.GetPage( Page );
+              RegionPages.insert( RegionPages.end(), PageRegions, PageRegions + GPURegionPageSize );
+          }
+    }
+}
+
+// -----------------------------------------------------------------------------
+
+void RunAheadSnapshot::Restore()
+{
+    if( !IsValid )
+      return;
+    
+    V32RAM& RAM = Console.RAM;
+    V32MemoryCardController& MemoryCard = Console.MemoryCardController;
+    V32GPU& GPU = Console.GPU;
+    
+    // restore only pages written after saving; those
+    // memory card pages will need to be saved again
+    RestoreWrittenPages( RAM, ShadowRAM );
+    MemoryCard.MarkPagesUnsaved( MemoryCard.WrittenPages );
+    
+    if( RestoreWrittenPages( MemoryCard, ShadowMemoryCard ) )
+      MemoryCard.PendingSave = true;
+    
+    // restore all small console parts
+    LoadCPUState( Console, CPU );
+    LoadSPUState( Console, SPU );
+    LoadGamepadControllerState( Console, GamepadController );
+    memcpy( &Console.Timer.CurrentDate, TimerRegisters, sizeof(TimerRegisters) );
+    Console.RNG.CurrentValue = RNGCurrentValue;
+    
+    // region pages allocated after saving must be
+    // all zeroes; keep them allocated for later use
+    for( unsigned TextureID = 0; TextureID < GPU.LoadedCartridgeTextures; TextureID++ )
+    {
+        if( !GPU.ModifiedCartridgeTextures[ TextureID ] )
+          continue;
+        
+        GPURegionTable& Texture = GPU.CartridgeTextures[ TextureID ];
+        
+        for( int32_t Page = 0; Page < GPURegionPagesPerTexture; Page++ )
+          if( Texture.IsPageAllocated( Page ) && !SavedRegionPages[ TextureID * GPURegionPagesPerTexture + Page ] )
+            memset( Texture.GetWritablePage( Page ), 0, GPURegionPageSize * sizeof(GPURegion) );
+    }
+    
+    for( size_t i = 0; i < RegionPageIndices.size(); i++ )
+    {
+        uint32_t TextureID = RegionPageIndices[ i ] / GPURegionPagesPerTexture;
+        uint32_t Page = RegionPageIndices[ i ] % GPURegionPagesPerTexture;
+        GPURegion* PageRegions = GPU.CartridgeTextures[ TextureID ].GetWritablePage( Page );
+        memcpy( PageRegions, &RegionPages[ i * GPURegionPageSize ], GPURegionPageSize * sizeof(GPURegion) );
+    }
+    
+    memcpy( GPU.ModifiedCartridgeTextures, ModifiedTextures, sizeof(ModifiedTextures) );
+    
+    // this also updates the pointed region
+    if( !LoadGPURegisters( Console, GPURegisters ) )
+      LOG( "ERROR: Cannot restore GPU state after running ahead" );
+}
+
+
+// =============================================================================
+//      RUN-AHEAD SNAPSHOT: RUNNING PREDICTED FRAMES
+// =============================================================================
+
+
+// only drawing is suppressed: other video functions
+// are still needed to keep textures and GPU settings
+void RunAheadSnapshot::SuppressVideo( bool Suppressed )
+{
+    Console.SetDrawingSuppressed( Suppressed );
+}
+
+// -----------------------------------------------------------------------------
+
+void RunAheadSnapshot::SuppressMemoryCardSaves( bool Suppressed )
+{
+    Console.SetMemoryCardSavesSuppressed( Suppressed );
+}
@@ -0,0 +1,76 @@
+// *****************************************************************************
+    // start include guard
+    #ifndef RUNAHEAD_HPP
+    #define RUNAHEAD_HPP
+    
+    // include emulator headers
+    #include "Savestates.hpp"
+    
+    // include C/C++ headers
+    #include <vector>       // [ C++ STL ] Vectors
+// *****************************************************************************
+
+
+// =============================================================================
+//      IN-CORE RUN-AHEAD SNAPSHOTS
+// =============================================================================
+
+
+// Run-ahead needs to go back to the same state every frame,
+// so instead of full states it uses snapshots that are kept
+// in sync with the console. Shadow copies of RAM and memory
+// card are only updated for the pages written since the last
+// checkpoint, and restoring also copies back only those pages.
+// Snapshots always work on the global console of the core.
+class RunAheadSnapshot
+{
+    private:
+    
+        // when not valid, the next save is a full one
+        bool IsValid;
+        
+        // shadow copies of all writable memories
+        std::vector< V32::V32Word > ShadowRAM;
+        std::vector< V32::V32Word > ShadowMemoryCard;
+        
+        // small console parts
+        CPUState CPU;
+        SPUState SPU;
+        GamepadControllerState GamepadController;
+        V32::V32Word TimerRegisters[ 4 ];
+        int32_t RNGCurrentValue;
+        V32::V32Word GPURegisters[ 12 ];
+        
+        // allocated region pages for modified textures
+        bool ModifiedTextures[ V32::Constants::GPUMaximumCartridgeTextures ];
+        std::vector< bool > SavedRegionPages;
+        std::vector< uint32_t > RegionPageIndices;
+        std::vector< V32::GPURegion > RegionPages;
+        
+        // memory synchronization
+        static bool SaveWrittenPages( V32::V32RAM& Memory, std::vector< V32::V32Word >& Shadow );
+        static bool RestoreWrittenPages( V32::V32RAM& Memory, std::vector< V32::V32Word >& Shadow );
+    
+    public:
+    
+        // instance handling
+        RunAheadSnapshot();
+        
+        // operation
+        void Invalidate();
+        void Save();
+        void Restore();
+        
+        // predicted frames are run without video
+        static void SuppressVideo( bool Suppressed );
+        
+        // predicted frames never save the memory card,
+        // since their changes are going to be undone
+        static void SuppressMemoryCardSaves( bool Suppressed );
+};
+
+
+// *****************************************************************************
+    // end include guard
+    #endif
+// *****************************************************************************
@@ -1,15 +1,12 @@
 // *****************************************************************************
-    // include libretro headers
-    #include "glsym/glsym.h"
-    
     // include emulator headers
     #include "Savestates.hpp"
-    #include "VideoOutput.hpp"
-    #include "Globals.hpp"
-    #include "Logging.hpp"
     
     // include C/C++ headers
     #include <string.h>           // [ ANSI C ] Strings
+    #include <stddef.h>           // [ ANSI C ] Standard definitions
+    #include <memory>             // [ C++ STL ] Smart pointers
+    #include <algorithm>          // [ C++ STL ] Algorithms
     
     // declare used namespaces
     using namespace V32;
@@ -21,7 +18,7 @@
 // =============================================================================
 
 
-void SaveCPUState( CPUState& State )
+void SaveCPUState( V32Console& Console, CPUState& State )
 {
     // all fields should be adjacent in memory
     // so read registers and flags together
@@ -30,7 +27,7 @@ void SaveCPUState( CPUState& State )
 
 // -----------------------------------------------------------------------------
 
-void SaveGPUState( GPUState& State )
+void SaveGPUState( V32Console& Console, GPUState& State )
 {
     V32GPU& GPU = Console.GPU;
     
@@ -38,13 +35,13 @@ void SaveGPUState( GPUState& State )
     memcpy( State.Registers, &GPU.Command, sizeof(State.Registers) );
     
     // copy only the needed cartridge textures
-    unsigned TexturesSize = sizeof(GPUTexture) * GPU.LoadedCartridgeTextures;
-    memcpy( State.CartridgeTextures, &GPU.CartridgeTextures[ 0 ], TexturesSize );
+    for( unsigned TextureID = 0; TextureID < GPU.LoadedCartridgeTextures; TextureID++ )
+      GPU.CartridgeTextures[ TextureID ].SaveToTexture( State.CartridgeTextures[ TextureID ] );
 }
 
 // -----------------------------------------------------------------------------
 
-void SaveSPUState( SPUState& State )
+void SaveSPUState( V32Console& Console, SPUState& State )
 {
     V32SPU& SPU = Console.SPU;
     
@@ -61,12 +58,17 @@ void SaveSPUState( SPUState& State )
     // do not read data for all sounds as a block!!
     // we don't want to copy the sample vector in each sound
     for( unsigned SoundID = 0; SoundID < CartridgeSounds; SoundID++ )
-      memcpy( &State.CartridgeSounds[ SoundID ], &SPU.CartridgeSounds[ SoundID ], 4 * sizeof(int32_t) );
+    {
+        State.CartridgeSounds[ SoundID ].Length       = SPU.CartridgeSounds[ SoundID ].Length;
+        State.CartridgeSounds[ SoundID ].PlayWithLoop = SPU.CartridgeSounds[ SoundID ].PlayWithLoop;
+        State.CartridgeSounds[ SoundID ].LoopStart    = SPU.CartridgeSounds[ SoundID ].LoopStart;
+        State.CartridgeSounds[ SoundID ].LoopEnd      = SPU.CartridgeSounds[ SoundID ].LoopEnd;
+    }
 }
 
 // -----------------------------------------------------------------------------
 
-void SaveGamepadControllerState( GamepadControllerState& State )
+void SaveGamepadControllerState( V32Console& Console, GamepadControllerState& State )
 {
     State.SelectedGamepad = Console.GamepadController.SelectedGamepad;
     
@@ -76,7 +78,7 @@ void SaveGamepadControllerState( GamepadControllerState& State )
 
 // -----------------------------------------------------------------------------
 
-void SaveOtherConsoleState( OtherConsoleState& State )
+void SaveOtherConsoleState( V32Console& Console, OtherConsoleState& State )
 {
     // save state for minor chips
     memcpy( State.TimerRegisters, &Console.Timer.CurrentDate, sizeof(State.TimerRegisters) );
@@ -88,7 +90,7 @@ void SaveOtherConsoleState( OtherConsoleState& State )
 
 // -----------------------------------------------------------------------------
 
-void SaveGameInfo( GameInfo& Info )
+void SaveGameInfo( V32Console& Console, GameInfo& Info )
 {
     // ensure title does not exceed 64 bytes and
     // that its unused characters are all null
@@ -102,17 +104,17 @@ void SaveGameInfo( GameInfo& Info )
 
 // -----------------------------------------------------------------------------
 
-bool SaveState( ConsoleState* State )
+bool SaveState( V32Console& Console, ConsoleState* State )
 {
     // save info to identify the game
-    SaveGameInfo( State->Game );
+    SaveGameInfo( Console, State->Game );
     
     // save console state
-    SaveCPUState( State->CPU );
-    SaveGPUState( State->GPU );
-    SaveSPUState( State->SPU );
-    SaveGamepadControllerState( State->GamepadController );
-    SaveOtherConsoleState( State->Others );
+    SaveCPUState( Console, State->CPU );
+    SaveGPUState( Console, State->GPU );
+    SaveSPUState( Console, State->SPU );
+    SaveGamepadControllerState( Console, State->GamepadController );
+    SaveOtherConsoleState( Console, State->Others );
     
     // saving should never fail
     return true;
@@ -124,7 +126,7 @@ bool SaveState( ConsoleState* State )
 // =============================================================================
 
 
-void LoadCPUState( const CPUState& State )
+void LoadCPUState( V32Console& Console, const CPUState& State )
 {
     // all fields should be adjacent in memory
     // so write registers and flags together
@@ -133,16 +135,12 @@ void LoadCPUState( const CPUState& State )
 
 // -----------------------------------------------------------------------------
 
-bool LoadGPUState( const GPUState& State )
+bool LoadGPURegisters( V32Console& Console, const V32Word* Registers )
 {
     V32GPU& GPU = Console.GPU;
     
     // write all registers as adjacent
-    memcpy( &GPU.Command, State.Registers, sizeof(State.Registers) );
-    
-    // copy only the needed cartridge textures
-    unsigned TexturesSize = sizeof(GPUTexture) * GPU.LoadedCartridgeTextures;
-    memcpy( &GPU.CartridgeTextures[ 0 ], State.CartridgeTextures, TexturesSize );
+    memcpy( &GPU.Command, Registers, 12 * sizeof(V32Word) );
     
     // update GPU pointers for the loaded selections
     if( GPU.SelectedTexture == -1 )
@@ -150,26 +148,34 @@ bool LoadGPUState( const GPUState& State )
     else
       GPU.PointedTexture = &GPU.CartridgeTextures[ GPU.SelectedTexture ];
     
-    GPU.PointedRegion = &GPU.PointedTexture->Regions[ GPU.SelectedRegion ];
+    GPU.PointedRegion = GPU.PointedTexture->GetRegion( GPU.SelectedRegion );
     
-    // reset any previous OpenGL errors
-    while( glGetError() != GL_NO_ERROR )
+    // the video library can apply these updates only
+    // when needed, so that loading does not depend on it
+    Console.Callbacks->RestoreRenderState( GPU.SelectedTexture, GPU.MultiplyColor, GPU.ActiveBlending );
+    return true;
+}
+
+// -----------------------------------------------------------------------------
+
+bool LoadGPUState( V32Console& Console, const GPUState& State )
+{
+    V32GPU& GPU = Console.GPU;
+    
+    // copy only the needed cartridge textures;
+    // any of them may now be modified
+    for( unsigned TextureID = 0; TextureID < GPU.LoadedCartridgeTextures; TextureID++ )
     {
-        // (empty block instead of ";" to avoid warnings)
+        GPU.CartridgeTextures[ TextureID ].LoadFromTexture( State.CartridgeTextures[ TextureID ] );
+        GPU.ModifiedCartridgeTextures[ TextureID ] = true;
     }
     
-    // make the needed updates in video output
-    Video.SelectTexture( GPU.SelectedTexture );
-    Video.SetMultiplyColor( GPU.MultiplyColor );
-    Video.SetBlendingMode( (IOPortValues)GPU.ActiveBlending );
-    
-    // check for success
-    return (glGetError() == GL_NO_ERROR);
+    return LoadGPURegisters( Console, State.Registers );
 }
 
 // -----------------------------------------------------------------------------
 
-void LoadSPUState( const SPUState& State )
+void LoadSPUState( V32Console& Console, const SPUState& State )
 {
     V32SPU& SPU = Console.SPU;
     
@@ -186,7 +192,12 @@ void LoadSPUState( const SPUState& State )
     // do not load data for all sounds as a block!!
     // we must not overwrite the sample vector in each sound
     for( unsigned SoundID = 0; SoundID < CartridgeSounds; SoundID++ )
-      memcpy( &SPU.CartridgeSounds[ SoundID ], &State.CartridgeSounds[ SoundID ], 4 * sizeof(int32_t) );
+    {
+        SPU.CartridgeSounds[ SoundID ].Length       = State.CartridgeSounds[ SoundID ].Length;
+        SPU.CartridgeSounds[ SoundID ].PlayWithLoop = State.CartridgeSounds[ SoundID ].PlayWithLoop;
+        SPU.CartridgeSounds[ SoundID ].LoopStart    = State.CartridgeSounds[ SoundID ].LoopStart;
+        SPU.CartridgeSounds[ SoundID ].LoopEnd      = State.CartridgeSounds[ SoundID ].LoopEnd;
+    }
     
     // make the needed updates in audio objects
     V32Word WordValue;
@@ -208,7 +219,7 @@ void LoadSPUState( const SPUState& State )
 
 // -----------------------------------------------------------------------------
 
-void LoadGamepadControllerState( const GamepadControllerState& State )
+void LoadGamepadControllerState( V32Console& Console, const GamepadControllerState& State )
 {
     // write the single exposed register
     Console.GamepadController.SelectedGamepad = State.SelectedGamepad;
@@ -219,41 +230,767 @@ void LoadGamepadControllerState( const GamepadControllerState& State )
 
 // -----------------------------------------------------------------------------
 
-void LoadOtherConsoleState( const OtherConsoleState& State )
+void LoadOtherConsoleState( V32Console& Console, const OtherConsoleState& State )
 {
     // load state for minor chips
     memcpy( &Console.Timer.CurrentDate, State.TimerRegisters, sizeof(State.TimerRegisters) );
     Console.RNG.CurrentValue = State.RNGCurrentValue;
     
-    // load the full RAM
+    // load the full RAM; any page may now be dirty
     memcpy( &Console.RAM.Memory[ 0 ], State.RAM, sizeof(State.RAM) );
+    Console.RAM.MarkAllPagesDirty();
+    Console.RAM.MarkAllPagesChanged();
 }
 
 // -----------------------------------------------------------------------------
 
-bool LoadState( const ConsoleState* State )
+bool LoadState( V32Console& Console, const ConsoleState* State )
 {
     // try to identify the game and see it it matches the
     // current one, to avoid loading incompatible states
     GameInfo CurrentGame;
-    SaveGameInfo( CurrentGame );
+    SaveGameInfo( Console, CurrentGame );
     
     if( memcmp( &State->Game, &CurrentGame, sizeof(GameInfo) ) )
     {
-        LOG( "ERROR: Cannot load saved state. Current cartridge is not the same one that was saved" );
+        Console.Callbacks->LogLine( "ERROR: Cannot load saved state. Current cartridge is not the same one that was saved" );
         return false;
     }
     
     // load console state
     // (first do stages that cannot fail)
-    LoadCPUState( State->CPU );
-    LoadSPUState( State->SPU );
-    LoadGamepadControllerState( State->GamepadController );
-    LoadOtherConsoleState( State->Others );
+    LoadCPUState( Console, State->CPU );
+    LoadSPUState( Console, State->SPU );
+    LoadGamepadControllerState( Console, State->GamepadController );
+    LoadOtherConsoleState( Console, State->Others );
     
     // now check for success at this stage
-    if( !LoadGPUState( State->GPU ) )
+    if( !LoadGPUState( Console, State->GPU ) )
       return false;
     
     return true;
 }
+
+
+// =============================================================================
+//      COMPACT STATES
+// =============================================================================
+
+
+// sections are stored by tag when loading
+const int NumberOfStateSections = (int)CompactStateTags::Base + 1;
+
+// -----------------------------------------------------------------------------
+
+static bool IsAllZeroes( const void* Data, size_t Size )
+{
+    // if the first byte is 0 and every byte
+    // equals the next one, all of them are 0
+    const uint8_t* Bytes = (const uint8_t*)Data;
+    return (Bytes[ 0 ] == 0) && !memcmp( Bytes, Bytes + 1, Size - 1 );
+}
+
+// -----------------------------------------------------------------------------
+
+// sequential writer that stops writing (and
+// keeps failing) when capacity is exceeded
+typedef struct
+{
+    uint8_t* Position;
+    uint8_t* End;
+    bool Overflow;
+}
+StateWriter;
+
+// -----------------------------------------------------------------------------
+
+static void WriteBytes( StateWriter& Writer, const void* Data, size_t Size )
+{
+    if( Writer.Overflow || (size_t)(Writer.End - Writer.Position) < Size )
+    {
+        Writer.Overflow = true;
+        return;
+    }
+    
+    memcpy( Writer.Position, Data, Size );
+    Writer.Position += Size;
+}
+
+// -----------------------------------------------------------------------------
+
+// returns the section start, so its size can be set when it ends
+static uint8_t* BeginSection( StateWriter& Writer, CompactStateTags Tag )
+{
+    uint8_t* SectionStart = Writer.Position;
+    CompactStateSection Section = { (uint32_t)Tag, 0 };
+    WriteBytes( Writer, &Section, sizeof(CompactStateSection) );
+    return SectionStart;
+}
+
+// -----------------------------------------------------------------------------
+
+static void EndSection( StateWriter& Writer, uint8_t* SectionStart )
+{
+    if( Writer.Overflow )
+      return;
+    
+    uint32_t Size = Writer.Position - SectionStart - sizeof(CompactStateSection);
+    memcpy( SectionStart + offsetof( CompactStateSection, Size ), &Size, sizeof(uint32_t) );
+}
+
+// -----------------------------------------------------------------------------
+
+bool IsCompactState( const void* Buffer, size_t Size )
+{
+    if( Size < sizeof(CompactStateHeader) )
+      return false;
+    
+    return !memcmp( Buffer, CompactStateSignature, 8 );
+}
+
+// -----------------------------------------------------------------------------
+
+// writes all sections except the ones for RAM and screen,
+// which are the same for compact and incremental states
+static void WriteConsoleSections( StateWriter& Writer, V32Console& Console )
+{
+    uint8_t* SectionStart;
+    
+    // save info to identify the game
+    GameInfo Game;
+    SaveGameInfo( Console, Game );
+    SectionStart = BeginSection( Writer, CompactStateTags::Game );
+    WriteBytes( Writer, &Game, sizeof(GameInfo) );
+    EndSection( Writer, SectionStart );
+    
+    // save all small console parts
+    SectionStart = BeginSection( Writer, CompactStateTags::CPU );
+    WriteBytes( Writer, Console.CPU.Registers, sizeof(CPUState) );
+    EndSection( Writer, SectionStart );
+    
+    V32SPU& SPU = Console.SPU;
+    SectionStart = BeginSection( Writer, CompactStateTags::SPU );
+    WriteBytes( Writer, &SPU.Command, 4 * sizeof(V32Word) );
+    WriteBytes( Writer, SPU.Channels, sizeof(SPUState::Channels) );
+    
+    for( unsigned SoundID = 0; SoundID < SPU.LoadedCartridgeSounds; SoundID++ )
+    {
+        const SPUSound& Sound = SPU.CartridgeSounds[ SoundID ];
+        int32_t SoundPorts[ 4 ] = { Sound.Length, Sound.PlayWithLoop, Sound.LoopStart, Sound.LoopEnd };
+        WriteBytes( Writer, SoundPorts, sizeof(SoundPorts) );
+    }
+    
+    EndSection( Writer, SectionStart );
+    
+    GamepadControllerState GamepadController;
+    SaveGamepadControllerState( Console, GamepadController );
+    SectionStart = BeginSection( Writer, CompactStateTags::GamepadController );
+    WriteBytes( Writer, &GamepadController, sizeof(GamepadControllerState) );
+    EndSection( Writer, SectionStart );
+    
+    SectionStart = BeginSection( Writer, CompactStateTags::MinorChips );
+    WriteBytes( Writer, &Console.Timer.CurrentDate, 4 * sizeof(V32Word) );
+    WriteBytes( Writer, &Console.RNG.CurrentValue, sizeof(int32_t) );
+    EndSection( Writer, SectionStart );
+    
+    SectionStart = BeginSection( Writer, CompactStateTags::GPURegisters );
+    WriteBytes( Writer, &Console.GPU.Command, 12 * sizeof(V32Word) );
+    EndSection( Writer, SectionStart );
+    
+    // save non-zero regions of modified textures; the
+    // ones found all zeroes don't need to be checked again
+    V32GPU& GPU = Console.GPU;
+    SectionStart = BeginSection( Writer, CompactStateTags::TextureRegions );
+    
+    for( uint32_t TextureID = 0; TextureID < GPU.LoadedCartridgeTextures; TextureID++ )
+    {
+        if( !GPU.ModifiedCartridgeTextures[ TextureID ] )
+          continue;
+        
+        // only allocated region pages can have non-zero regions
+        const GPURegionTable& Texture = GPU.CartridgeTextures[ TextureID ];
+        bool TextureIsUsed = false;
+        
+        for( int32_t Page = 0; Page < GPURegionPagesPerTexture; Page++ )
+        {
+            if( !Texture.IsPageAllocated( Page ) )
+              continue;
+            
+            const GPURegion* PageRegions = Texture.GetPage( Page );
+            
+            for( uint32_t i = 0; i < GPURegionPageSize; i++ )
+            {
+                if( IsAllZeroes( &PageRegions[ i ], sizeof(GPURegion) ) )
+                  continue;
+                
+                uint32_t RegionID = Page * GPURegionPageSize + i;
+                WriteBytes( Writer, &TextureID, sizeof(uint32_t) );
+                WriteBytes( Writer, &RegionID, sizeof(uint32_t) );
+                WriteBytes( Writer, &PageRegions[ i ], sizeof(GPURegion) );
+                TextureIsUsed = true;
+            }
+        }
+        
+        GPU.ModifiedCartridgeTextures[ TextureID ] = TextureIsUsed;
+    }
+    
+    EndSection( Writer, SectionStart );
+}
+
+// -----------------------------------------------------------------------------
+
+bool SaveCompactState( V32Console& Console, void* Buffer, size_t Capacity, StateScreen* ScreenSource )
+{
+    StateWriter Writer = { (uint8_t*)Buffer, (uint8_t*)Buffer + Capacity, false };
+    uint8_t* SectionStart;
+    
+    // all 8 required sections are always written;
+    // the number is updated if a screen is added
+    CompactStateHeader Header;
+    memcpy( Header.Signature, CompactStateSignature, 8 );
+    Header.Version = CompactStateVersion;
+    Header.NumberOfSections = 8;
+    WriteBytes( Writer, &Header, sizeof(CompactStateHeader) );
+    WriteConsoleSections( Writer, Console );
+    
+    // save dirty RAM pages, also skipping zeroes;
+    // writes from outside must be tracked first
+    V32RAM& RAM = Console.RAM;
+    RAM.SyncExposedMemory();
+    const size_t PageBytes = RAMPageSize * sizeof(V32Word);
+    SectionStart = BeginSection( Writer, CompactStateTags::RAMPages );
+    
+    for( int32_t Page = 0; Page < RAM.NumberOfPages; Page++ )
+    {
+        // skip 64 clean pages at once
+        if( !RAM.DirtyPages[ Page >> 6 ] )
+        {
+            Page |= 63;
+            continue;
+        }
+        
+        if( !RAM.IsPageDirty( Page ) )
+          continue;
+        
+        const V32Word* PageWords = &RAM.Memory[ Page << RAMPageSizeBits ];
+        
+        if( IsAllZeroes( PageWords, PageBytes ) )
+        {
+            RAM.SetPageDirty( Page, false );
+            continue;
+        }
+        
+        WriteBytes( Writer, &Page, sizeof(int32_t) );
+        WriteBytes( Writer, PageWords, PageBytes );
+    }
+    
+    EndSection( Writer, SectionStart );
+    
+    // the screen is read directly into the state;
+    // when not available, just leave the section out
+    if( ScreenSource && !Writer.Overflow
+    &&  (size_t)(Writer.End - Writer.Position) >= sizeof(CompactStateSection) + SCREEN_SNAPSHOT_SIZE )
+    {
+        SectionStart = BeginSection( Writer, CompactStateTags::Screen );
+        
+        if( ScreenSource->ReadScreen( Writer.Position ) )
+        {
+            Writer.Position += SCREEN_SNAPSHOT_SIZE;
+            EndSection( Writer, SectionStart );
+            
+            Header.NumberOfSections++;
+            memcpy( Buffer, &Header, sizeof(CompactStateHeader) );
+        }
+        
+        else
+          Writer.Position = SectionStart;
+    }
+    
+    return !Writer.Overflow;
+}
+
+// -----------------------------------------------------------------------------
+
+// locates all known sections of a compact or incremental
+// state and checks them, before anything is changed in the
+// console; the state must have been identified by the caller
+static bool ReadStateSections( V32Console& Console, const void* Buffer, size_t Size, const uint8_t** Sections, uint32_t* SectionSizes )
+{
+    CompactStateHeader Header;
+    memcpy( &Header, Buffer, sizeof(CompactStateHeader) );
+    
+    if( Header.Version > CompactStateVersion )
+    {
+        Console.Callbacks->LogLine( "ERROR: Cannot load saved state. State was saved by a newer version of the core" );
+        return false;
+    }
+    
+    // locate all known sections and check their sizes
+    V32GPU& GPU = Console.GPU;
+    V32SPU& SPU = Console.SPU;
+    V32RAM& RAM = Console.RAM;
+    
+    const size_t SPUSize = 4 * sizeof(V32Word) + sizeof(SPUState::Channels) + SPU.LoadedCartridgeSounds * 4 * sizeof(int32_t);
+    const size_t RegionRecordSize = 2 * sizeof(uint32_t) + sizeof(GPURegion);
+    const size_t PageRecordSize = sizeof(uint32_t) + RAMPageSize * sizeof(V32Word);
+    
+    for( int i = 0; i < NumberOfStateSections; i++ )
+    {
+        Sections[ i ] = nullptr;
+        SectionSizes[ i ] = 0;
+    }
+    
+    const uint8_t* Position = (const uint8_t*)Buffer + sizeof(CompactStateHeader);
+    const uint8_t* End = (const uint8_t*)Buffer + Size;
+    
+    for( uint32_t i = 0; i < Header.NumberOfSections; i++ )
+    {
+        CompactStateSection Section;
+        
+        if( (size_t)(End - Position) < sizeof(CompactStateSection) )
+          break;
+        
+        memcpy( &Section, Position, sizeof(CompactStateSection) );
+        Position += sizeof(CompactStateSection);
+        
+        if( Section.Size > (size_t)(End - Position) )
+          break;
+        
+        // sections with unknown tags are ignored
+        if( Section.Tag >= (uint32_t)CompactStateTags::Game && Section.Tag < NumberOfStateSections )
+        {
+            Sections[ Section.Tag ] = Position;
+            SectionSizes[ Section.Tag ] = Section.Size;
+        }
+        
+        Position += Section.Size;
+    }
+    
+    if( SectionSizes[ (int)CompactStateTags::Game ] != sizeof(GameInfo)
+    ||  SectionSizes[ (int)CompactStateTags::CPU ] != sizeof(CPUState)
+    ||  SectionSizes[ (int)CompactStateTags::SPU ] != SPUSize
+    ||  SectionSizes[ (int)CompactStateTags::GamepadController ] != sizeof(GamepadControllerState)
+    ||  SectionSizes[ (int)CompactStateTags::MinorChips ] != 5 * sizeof(V32Word)
+    ||  SectionSizes[ (int)CompactStateTags::GPURegisters ] != 12 * sizeof(V32Word)
+    ||  !Sections[ (int)CompactStateTags::TextureRegions ]
+    ||  !Sections[ (int)CompactStateTags::RAMPages ]
+    ||  SectionSizes[ (int)CompactStateTags::TextureRegions ] % RegionRecordSize
+    ||  SectionSizes[ (int)CompactStateTags::RAMPages ] % PageRecordSize
+    ||  (Sections[ (int)CompactStateTags::Screen ] && SectionSizes[ (int)CompactStateTags::Screen ] != SCREEN_SNAPSHOT_SIZE)
+    ||  (Sections[ (int)CompactStateTags::Base ] && SectionSizes[ (int)CompactStateTags::Base ] != sizeof(uint32_t)) )
+    {
+        Console.Callbacks->LogLine( "ERROR: Cannot load saved state. Compact state is not valid" );
+        return false;
+    }
+    
+    // try to identify the game and see it it matches the
+    // current one, to avoid loading incompatible states
+    GameInfo CurrentGame;
+    SaveGameInfo( Console, CurrentGame );
+    
+    if( memcmp( Sections[ (int)CompactStateTags::Game ], &CurrentGame, sizeof(GameInfo) ) )
+    {
+        Console.Callbacks->LogLine( "ERROR: Cannot load saved state. Current cartridge is not the same one that was saved" );
+        return false;
+    }
+    
+    // check all record indices
+    const uint8_t* Regions = Sections[ (int)CompactStateTags::TextureRegions ];
+    const uint8_t* Pages = Sections[ (int)CompactStateTags::RAMPages ];
+    uint32_t NumberOfRegions = SectionSizes[ (int)CompactStateTags::TextureRegions ] / RegionRecordSize;
+    uint32_t NumberOfPages = SectionSizes[ (int)CompactStateTags::RAMPages ] / PageRecordSize;
+    
+    for( uint32_t i = 0; i < NumberOfRegions; i++ )
+    {
+        uint32_t TextureID, RegionID;
+        memcpy( &TextureID, Regions + i * RegionRecordSize, sizeof(uint32_t) );
+        memcpy( &RegionID, Regions + i * RegionRecordSize + sizeof(uint32_t), sizeof(uint32_t) );
+        
+        if( TextureID >= GPU.LoadedCartridgeTextures || RegionID >= (uint32_t)Constants::GPURegionsPerTexture )
+          return false;
+    }
+    
+    for( uint32_t i = 0; i < NumberOfPages; i++ )
+    {
+        uint32_t Page;
+        memcpy( &Page, Pages + i * PageRecordSize, sizeof(uint32_t) );
+        
+        if( Page >= (uint32_t)RAM.NumberOfPages )
+          return false;
+    }
+    
+    return true;
+}
+
+// -----------------------------------------------------------------------------
+
+// loads all sections except the ones for RAM and screen,
+// which are the same for compact and incremental states;
+// sections must have been checked by ReadStateSections
+static bool LoadConsoleSections( V32Console& Console, const uint8_t** Sections, const uint32_t* SectionSizes )
+{
+    V32GPU& GPU = Console.GPU;
+    V32SPU& SPU = Console.SPU;
+    
+    // load all small console parts
+    // (first do stages that cannot fail)
+    CPUState CPU;
+    memcpy( &CPU, Sections[ (int)CompactStateTags::CPU ], sizeof(CPUState) );
+    LoadCPUState( Console, CPU );
+    
+    // the sound parameters are loaded through a full SPU
+    // state; it goes in the heap because of its size (not
+    // static: several consoles may be loading at once)
+    std::unique_ptr< SPUState > SPUParameters( new SPUState );
+    const uint8_t* SPUData = Sections[ (int)CompactStateTags::SPU ];
+    memcpy( SPUParameters->Registers, SPUData, sizeof(SPUParameters->Registers) );
+    memcpy( SPUParameters->Channels, SPUData + sizeof(SPUParameters->Registers), sizeof(SPUParameters->Channels) );
+    SPUData += sizeof(SPUParameters->Registers) + sizeof(SPUParameters->Channels);
+    
+    // sounds hold a sample vector, so copy their ports one by one
+    for( unsigned SoundID = 0; SoundID < SPU.LoadedCartridgeSounds; SoundID++ )
+    {
+        int32_t SoundPorts[ 4 ];
+        memcpy( SoundPorts, SPUData + SoundID * sizeof(SoundPorts), sizeof(SoundPorts) );
+        
+        SPUSound& Sound = SPUParameters->CartridgeSounds[ SoundID ];
+        Sound.Length       = SoundPorts[ 0 ];
+        Sound.PlayWithLoop = SoundPorts[ 1 ];
+        Sound.LoopStart    = SoundPorts[ 2 ];
+        Sound.LoopEnd      = SoundPorts[ 3 ];
+    }
+    
+    LoadSPUState( Console, *SPUParameters );
+    
+    GamepadControllerState GamepadController;
+    memcpy( &GamepadController, Sections[ (int)CompactStateTags::GamepadController ], sizeof(GamepadControllerState) );
+    LoadGamepadControllerState( Console, GamepadController );
+    
+    const uint8_t* MinorChips = Sections[ (int)CompactStateTags::MinorChips ];
+    memcpy( &Console.Timer.CurrentDate, MinorChips, 4 * sizeof(V32Word) );
+    memcpy( &Console.RNG.CurrentValue, MinorChips + 4 * sizeof(V32Word), sizeof(int32_t) );
+    
+    // regions not included must be all zeroes; only
+    // the currently modified textures need to be cleared
+    for( unsigned TextureID = 0; TextureID < GPU.LoadedCartridgeTextures; TextureID++ )
+      if( GPU.ModifiedCartridgeTextures[ TextureID ] )
+      {
+          GPU.CartridgeTextures[ TextureID ].Clear();
+          GPU.ModifiedCartridgeTextures[ TextureID ] = false;
+      }
+    
+    const size_t RegionRecordSize = 2 * sizeof(uint32_t) + sizeof(GPURegion);
+    const uint8_t* Regions = Sections[ (int)CompactStateTags::TextureRegions ];
+    uint32_t NumberOfRegions = SectionSizes[ (int)CompactStateTags::TextureRegions ] / RegionRecordSize;
+    
+    for( uint32_t i = 0; i < NumberOfRegions; i++ )
+    {
+        uint32_t TextureID, RegionID;
+        memcpy( &TextureID, Regions + i * RegionRecordSize, sizeof(uint32_t) );
+        memcpy( &RegionID, Regions + i * RegionRecordSize + sizeof(uint32_t), sizeof(uint32_t) );
+        memcpy( GPU.CartridgeTextures[ TextureID ].GetWritableRegion( RegionID ), Regions + i * RegionRecordSize + 2 * sizeof(uint32_t), sizeof(GPURegion) );
+        GPU.ModifiedCartridgeTextures[ TextureID ] = true;
+    }
+    
+    // now check for success at this stage
+    V32Word GPURegisters[ 12 ];
+    memcpy( GPURegisters, Sections[ (int)CompactStateTags::GPURegisters ], sizeof(GPURegisters) );
+    return LoadGPURegisters( Console, GPURegisters );
+}
+
+// -----------------------------------------------------------------------------
+
+bool LoadCompactState( V32Console& Console, const void* Buffer, size_t Size, StateScreen* ScreenTarget )
+{
+    if( !IsCompactState( Buffer, Size ) )
+      return false;
+    
+    const uint8_t* Sections[ NumberOfStateSections ];
+    uint32_t SectionSizes[ NumberOfStateSections ];
+    
+    if( !ReadStateSections( Console, Buffer, Size, Sections, SectionSizes ) )
+      return false;
+    
+    // RAM pages not included must be all zeroes;
+    // only currently dirty pages need to be cleared
+    V32RAM& RAM = Console.RAM;
+    RAM.SyncExposedMemory();
+    
+    const size_t PageBytes = RAMPageSize * sizeof(V32Word);
+    const size_t PageRecordSize = sizeof(uint32_t) + PageBytes;
+    const uint8_t* Pages = Sections[ (int)CompactStateTags::RAMPages ];
+    uint32_t NumberOfPages = SectionSizes[ (int)CompactStateTags::RAMPages ] / PageRecordSize;
+    
+    for( int32_t Page = 0; Page < RAM.NumberOfPages; Page++ )
+    {
+        // skip 64 clean pages at once
+        if( !RAM.DirtyPages[ Page >> 6 ] )
+        {
+            Page |= 63;
+            continue;
+        }
+        
+        if( RAM.IsPageDirty( Page ) )
+        {
+            memset( &RAM.Memory[ Page << RAMPageSizeBits ], 0, PageBytes );
+            RAM.SetPageDirty( Page, false );
+            RAM.MarkPageChanged( Page );
+        }
+    }
+    
+    for( uint32_t i = 0; i < NumberOfPages; i++ )
+    {
+        uint32_t Page;
+        memcpy( &Page, Pages + i * PageRecordSize, sizeof(uint32_t) );
+        memcpy( &RAM.Memory[ Page << RAMPageSizeBits ], Pages + i * PageRecordSize + sizeof(uint32_t), PageBytes );
+        RAM.SetPageDirty( Page, true );
+        RAM.MarkPageChanged( Page );
+    }
+    
+    // the screen is only drawn when the next frame
+    // begins; without it, the screen is left as is
+    if( ScreenTarget )
+      ScreenTarget->SetPendingScreen( Sections[ (int)CompactStateTags::Screen ] );
+    
+    return LoadConsoleSections( Console, Sections, SectionSizes );
+}
+
+
+// =============================================================================
+//      INCREMENTAL STATES
+// =============================================================================
+
+
+bool IsIncrementalState( const void* Buffer, size_t Size )
+{
+    if( Size < sizeof(CompactStateHeader) )
+      return false;
+    
+    return !memcmp( Buffer, IncrementalStateSignature, 8 );
+}
+
+// -----------------------------------------------------------------------------
+
+static uint32_t CountPages( const std::vector< uint64_t >& Pages )
+{
+    uint32_t Count = 0;
+    
+    for( uint64_t Bits: Pages )
+      for( ; Bits; Bits &= Bits - 1 )
+        Count++;
+    
+    return Count;
+}
+
+// -----------------------------------------------------------------------------
+
+IncrementalStateBases::IncrementalStateBases()
+{
+    Clear();
+}
+
+// -----------------------------------------------------------------------------
+
+// must be called when the game is unloaded,
+// since states from it can't be loaded anymore
+void IncrementalStateBases::Clear()
+{
+    for( BaseSnapshot& Base: Bases )
+    {
+        Base.ID = 0;
+        Base.RAM.clear();
+        Base.RAM.shrink_to_fit();
+        Base.ChangedPages.clear();
+    }
+    
+    CurrentBase = 0;
+    LastBaseID = 0;
+    SavesFromCurrentBase = 0;
+}
+
+// -----------------------------------------------------------------------------
+
+void IncrementalStateBases::UpdateChangedPages( V32RAM& RAM )
+{
+    // writes from outside must be tracked first
+    RAM.SyncExposedMemory();
+    CollectedPages.assign( RAM.ChangedPages.size(), 0 );
+    RAM.CollectChangedPages( CollectedPages );
+    
+    for( BaseSnapshot& Base: Bases )
+      if( Base.ID )
+        for( size_t i = 0; i < CollectedPages.size(); i++ )
+          Base.ChangedPages[ i ] |= CollectedPages[ i ];
+}
+
+// -----------------------------------------------------------------------------
+
+// the oldest base is replaced; only its changed
+// pages are copied, except the first time
+IncrementalStateBases::BaseSnapshot& IncrementalStateBases::TakeNewBase( V32RAM& RAM )
+{
+    if( Bases[ CurrentBase ].ID )
+      CurrentBase = 1 - CurrentBase;
+    
+    BaseSnapshot& Base = Bases[ CurrentBase ];
+    
+    if( !Base.ID )
+      Base.RAM = RAM.Memory;
+    
+    else
+    {
+        for( int32_t Page = 0; Page < RAM.NumberOfPages; Page++ )
+        {
+            // skip 64 unchanged pages at once
+            if( !Base.ChangedPages[ Page >> 6 ] )
+            {
+                Page |= 63;
+                continue;
+            }
+            
+            if( (Base.ChangedPages[ Page >> 6 ] >> (Page & 63)) & 1 )
+              memcpy( &Base.RAM[ Page << RAMPageSizeBits ], &RAM.Memory[ Page << RAMPageSizeBits ], RAMPageSize * sizeof(V32Word) );
+        }
+    }
+    
+    Base.ChangedPages.assign( RAM.ChangedPages.size(), 0 );
+    Base.ID = ++LastBaseID;
+    SavesFromCurrentBase = 0;
+    return Base;
+}
+
+// -----------------------------------------------------------------------------
+
+bool IncrementalStateBases::SaveState( V32Console& Console, void* Buffer, size_t Capacity )
+{
+    V32RAM& RAM = Console.RAM;
+    UpdateChangedPages( RAM );
+    
+    BaseSnapshot* Base = &Bases[ CurrentBase ];
+    
+    if( !Base->ID || (SavesFromCurrentBase >= MinimumSavesPerBase && CountPages( Base->ChangedPages ) > RebasePages) )
+      Base = &TakeNewBase( RAM );
+    
+    SavesFromCurrentBase++;
+    
+    // same as compact states, but the screen is never included
+    StateWriter Writer = { (uint8_t*)Buffer, (uint8_t*)Buffer + Capacity, false };
+    uint8_t* SectionStart;
+    
+    CompactStateHeader Header;
+    memcpy( Header.Signature, IncrementalStateSignature, 8 );
+    Header.Version = CompactStateVersion;
+    Header.NumberOfSections = 9;
+    WriteBytes( Writer, &Header, sizeof(CompactStateHeader) );
+    WriteConsoleSections( Writer, Console );
+    
+    SectionStart = BeginSection( Writer, CompactStateTags::Base );
+    WriteBytes( Writer, &Base->ID, sizeof(uint32_t) );
+    EndSection( Writer, SectionStart );
+    
+    // save only the pages that may differ from the base
+    const size_t PageBytes = RAMPageSize * sizeof(V32Word);
+    SectionStart = BeginSection( Writer, CompactStateTags::RAMPages );
+    
+    for( int32_t Page = 0; Page < RAM.NumberOfPages; Page++ )
+    {
+        // skip 64 unchanged pages at once
+        if( !Base->ChangedPages[ Page >> 6 ] )
+        {
+            Page |= 63;
+            continue;
+        }
+        
+        if( !((Base->ChangedPages[ Page >> 6 ] >> (Page & 63)) & 1) )
+          continue;
+        
+        WriteBytes( Writer, &Page, sizeof(int32_t) );
+        WriteBytes( Writer, &RAM.Memory[ Page << RAMPageSizeBits ], PageBytes );
+    }
+    
+    EndSection( Writer, SectionStart );
+    return !Writer.Overflow;
+}
+
+// -----------------------------------------------------------------------------
+
+bool IncrementalStateBases::LoadState( V32Console& Console, const void* Buffer, size_t Size )
+{
+    if( !IsIncrementalState( Buffer, Size ) )
+      return false;
+    
+    const uint8_t* Sections[ NumberOfStateSections ];
+    uint32_t SectionSizes[ NumberOfStateSections ];
+    
+    if( !ReadStateSections( Console, Buffer, Size, Sections, SectionSizes ) )
+      return false;
+    
+    // find the base this state was saved from
+    uint32_t BaseID = 0;
+    
+    if( Sections[ (int)CompactStateTags::Base ] )
+      memcpy( &BaseID, Sections[ (int)CompactStateTags::Base ], sizeof(uint32_t) );
+    
+    BaseSnapshot* Base = nullptr;
+    
+    for( BaseSnapshot& Candidate: Bases )
+      if( BaseID && Candidate.ID == BaseID )
+        Base = &Candidate;
+    
+    if( !Base )
+    {
+        Console.Callbacks->LogLine( "ERROR: Cannot load saved state. Incremental state is too old" );
+        return false;
+    }
+    
+    // go back to the base, restoring only the
+    // pages that changed, then copy the included
+    // pages; both kinds are now changed pages
+    V32RAM& RAM = Console.RAM;
+    UpdateChangedPages( RAM );
+    
+    const size_t PageBytes = RAMPageSize * sizeof(V32Word);
+    const size_t PageRecordSize = sizeof(uint32_t) + PageBytes;
+    const uint8_t* Pages = Sections[ (int)CompactStateTags::RAMPages ];
+    uint32_t NumberOfPages = SectionSizes[ (int)CompactStateTags::RAMPages ] / PageRecordSize;
+    
+    for( int32_t Page = 0; Page < RAM.NumberOfPages; Page++ )
+    {
+        // skip 64 unchanged pages at once
+        if( !Base->ChangedPages[ Page >> 6 ] )
+        {
+            Page |= 63;
+            continue;
+        }
+        
+        if( !((Base->ChangedPages[ Page >> 6 ] >> (Page & 63)) & 1) )
+          continue;
+        
+        memcpy( &RAM.Memory[ Page << RAMPageSizeBits ], &Base->RAM[ Page << RAMPageSizeBits ], PageBytes );
+        RAM.SetPageDirty( Page, true );
+        RAM.MarkPageChanged( Page );
+    }
+    
+    for( uint32_t i = 0; i < NumberOfPages; i++ )
+    {
+        uint32_t Page;
+        memcpy( &Page, Pages + i * PageRecordSize, sizeof(uint32_t) );
+        memcpy( &RAM.Memory[ Page << RAMPageSizeBits ], Pages + i * PageRecordSize + sizeof(uint32_t), PageBytes );
+        RAM.SetPageDirty( Page, true );
+        RAM.MarkPageChanged( Page );
+    }
+    
+    // the other base gets all those pages as changed,
+    // but this one only differs in the included pages
+    UpdateChangedPages( RAM );
+    std::fill( Base->ChangedPages.begin(), Base->ChangedPages.end(), 0 );
+    
+    for( uint32_t i = 0; i < NumberOfPages; i++ )
+    {
+        uint32_t Page;
+        memcpy( &Page, Pages + i * PageRecordSize, sizeof(uint32_t) );
+        Base->ChangedPages[ Page >> 6 ] |= ((uint64_t)1 << (Page & 63));
+    }
+    
+    return LoadConsoleSections( Console, Sections, SectionSizes );
+}
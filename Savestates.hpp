@@ -7,9 +7,17 @@
     #include "ConsoleLogic/V32Console.hpp"
     #include "VirconDefinitions/Constants.hpp"
     #include "VirconDefinitions/Enumerations.hpp"
+    
+    // include C/C++ headers
+    #include <vector>       // [ C++ STL ] Vectors
 // *****************************************************************************
 
 
+// size of a screen snapshot, stored as RGBA pixels
+// in OpenGL row order (the bottom row goes first)
+#define SCREEN_SNAPSHOT_SIZE (V32::Constants::ScreenWidth * V32::Constants::ScreenHeight * 4)
+
+
 // =============================================================================
 //      STRUCTURES TO HANDLE CONSOLE STATE
 // =============================================================================
@@ -95,10 +103,8 @@ typedef struct
     
     // NOTE 2: Screen contents are persistent, so the
     // drawing buffer should also be part of the state.
-    // However taking and redrawing screenshots would
-    // add significant size and complexity. Nearly all
-    // games redraw the whole screen every frame, so
-    // we will skip saving the screen.
+    // Full states skip it to keep their fixed layout;
+    // compact states can include it as a section.
 }
 OtherConsoleState;
 
@@ -136,13 +142,180 @@ typedef struct
 ConsoleState;
 
 
+// =============================================================================
+//      COMPACT STATE FORMAT
+// =============================================================================
+
+
+// Compact states start with this header, followed by a
+// sequence of sections. Each section has a tag and the
+// size of its data, so that loaders can skip sections
+// they don't know. RAM is stored as the pages that are
+// not all zeroes, and textures as their non-zero regions.
+typedef struct
+{
+    char Signature[ 8 ];
+    uint32_t Version;
+    uint32_t NumberOfSections;
+}
+CompactStateHeader;
+
+// -----------------------------------------------------------------------------
+
+typedef struct
+{
+    uint32_t Tag;
+    uint32_t Size;
+}
+CompactStateSection;
+
+// -----------------------------------------------------------------------------
+
+enum class CompactStateTags: uint32_t
+{
+    Game = 1,                   // GameInfo
+    CPU,                        // CPUState
+    SPU,                        // registers, channels, then 4 words per loaded sound
+    GamepadController,          // GamepadControllerState
+    MinorChips,                 // timer registers, then RNG value
+    GPURegisters,               // 12 words
+    TextureRegions,             // records of: texture ID, region ID, GPURegion
+    RAMPages,                   // records of: page number, page words
+    Screen,                     // optional: RGBA pixels, bottom row first
+    Base                        // incremental states only: base snapshot ID
+};
+
+// -----------------------------------------------------------------------------
+
+// expected signature and current version;
+// later versions cannot be loaded; version 1 states
+// never include a screen, but loaders do not need to
+// know that since the section is optional
+const char CompactStateSignature[] = "V32-CSTA";
+const uint32_t CompactStateVersion = 1;
+
+// -----------------------------------------------------------------------------
+
+// Incremental states use the same sections, with a different
+// signature so that they are never taken as compact states.
+// Their RAM pages are the ones that may have changed since a
+// base snapshot, which only exists in the instance that saved
+// them; they include no screen.
+const char IncrementalStateSignature[] = "V32-ISTA";
+
+// -----------------------------------------------------------------------------
+
+// The screen is not part of the console, so compact states
+// read and restore it through this interface. This way the
+// state functions don't depend on any video library.
+class StateScreen
+{
+    public:
+        
+        virtual ~StateScreen() {}
+        
+        // returns false if no screen is available
+        virtual bool ReadScreen( void* Pixels ) = 0;
+        
+        // a null pointer discards any pending screen
+        virtual void SetPendingScreen( const void* Pixels ) = 0;
+};
+
+
 // =============================================================================
 //      SERIALIZATION FUNCTIONS
 // =============================================================================
 
 
-bool SaveState( ConsoleState* State );
-bool LoadState( const ConsoleState* State );
+// all functions work on the given console, so
+// states of different consoles can be handled
+// at the same time from different threads
+bool SaveState( V32::V32Console& Console, ConsoleState* State );
+bool LoadState( V32::V32Console& Console, const ConsoleState* State );
+
+// functions for each part of the state, for
+// cases that don't handle full states at once
+void SaveGameInfo( V32::V32Console& Console, GameInfo& Info );
+void SaveCPUState( V32::V32Console& Console, CPUState& State );
+void SaveSPUState( V32::V32Console& Console, SPUState& State );
+void SaveGamepadControllerState( V32::V32Console& Console, GamepadControllerState& State );
+void LoadCPUState( V32::V32Console& Console, const CPUState& State );
+void LoadSPUState( V32::V32Console& Console, const SPUState& State );
+void LoadGamepadControllerState( V32::V32Console& Console, const GamepadControllerState& State );
+bool LoadGPURegisters( V32::V32Console& Console, const V32::V32Word* Registers );
+
+// compact states have a variable size, usually much
+// smaller than a full state; when there is not enough
+// capacity save will fail, and a full state can be used;
+// the screen is only saved and loaded when a screen
+// is given (it is not part of the console)
+bool IsCompactState( const void* Buffer, size_t Size );
+bool SaveCompactState( V32::V32Console& Console, void* Buffer, size_t Capacity, StateScreen* ScreenSource );
+bool LoadCompactState( V32::V32Console& Console, const void* Buffer, size_t Size, StateScreen* ScreenTarget );
+
+// incremental states can only be loaded while
+// their base snapshot is kept by the given bases
+bool IsIncrementalState( const void* Buffer, size_t Size );
+
+
+// =============================================================================
+//      BASE SNAPSHOTS FOR INCREMENTAL STATES
+// =============================================================================
+
+
+// Bases hold copies of RAM as it was when they were taken.
+// Both of them are kept updated with the pages changed since
+// then, so saving only copies those pages, and loading only
+// has to restore them from the base before copying the pages
+// in the state. A new base is taken when states grow too big,
+// but the previous one is still kept, so states saved shortly
+// before can be loaded too. Bases are only valid for the same
+// console, which is given on each call as for other states.
+class IncrementalStateBases
+{
+    private:
+    
+        struct BaseSnapshot
+        {
+            // 0 when not taken yet
+            uint32_t ID;
+            std::vector< V32::V32Word > RAM;
+            
+            // pages where console RAM may differ from the base
+            std::vector< uint64_t > ChangedPages;
+        };
+        
+        BaseSnapshot Bases[ 2 ];
+        unsigned CurrentBase;
+        uint32_t LastBaseID;
+        uint32_t SavesFromCurrentBase;
+        
+        // pages collected from RAM on each update
+        std::vector< uint64_t > CollectedPages;
+        
+        // base handling
+        void UpdateChangedPages( V32::V32RAM& RAM );
+        BaseSnapshot& TakeNewBase( V32::V32RAM& RAM );
+    
+    public:
+    
+        // a new base is taken when states include this many
+        // pages, but only after this many states were saved
+        // from the current base, so that frontends can still
+        // load states from a few frames ago, which use the
+        // previous base, even when states grow quickly
+        static const uint32_t RebasePages = 256;
+        static const uint32_t MinimumSavesPerBase = 60;
+        
+        // instance handling
+        IncrementalStateBases();
+        void Clear();
+        
+        // states are saved from the current base, but
+        // can be loaded from any base still being kept
+        bool SaveState( V32::V32Console& Console, void* Buffer, size_t Capacity );
+        bool LoadState( V32::V32Console& Console, const void* Buffer, size_t Size );
+};
 
 
 // *****************************************************************************
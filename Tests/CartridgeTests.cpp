@@ -0,0 +1,745 @@
+// *****************************************************************************
+    // include Vircon32 headers
+    #include "ConsoleLogic/V32Console.hpp"
+    #include "ConsoleLogic/Decompression.hpp"
+    
+    // include emulator headers
+    #include "UnitTests.hpp"
+    
+    // include C/C++ headers
+    #include <cstdlib>          // [ ANSI C ] Standard library
+    #include <fstream>          // [ C++ STL ] File streams
+    #include <memory>           // [ C++ STL ] Smart pointers
+    #include <stdexcept>        // [ C++ STL ] Exceptions
+    #include <string>           // [ C++ STL ] Strings
+    #include <vector>           // [ C++ STL ] Vectors
+    
+    // declare used namespaces
+    using namespace std;
+    using namespace V32;
+// *****************************************************************************
+
+
+// =============================================================================
+//      AUXILIARY FUNCTIONS
+// =============================================================================
+
+
+// nothing is drawn and logs are ignored
+static HeadlessCallbacks TestCallbacks;
+
+// -----------------------------------------------------------------------------
+
+// no BIOS is needed, since cartridges are only loaded
+static unique_ptr< V32Console > CreateConsole()
+{
+    unique_ptr< V32Console > Console( new V32Console );
+    Console->SetCallbacks( &TestCallbacks );
+    return Console;
+}
+
+// -----------------------------------------------------------------------------
+
+// a fixed sequence, so that failures can be reproduced
+static uint32_t RandomState = 12345;
+
+static uint32_t RandomWord()
+{
+    RandomState = RandomState * 1664525 + 1013904223;
+    return RandomState;
+}
+
+// -----------------------------------------------------------------------------
+
+static void AppendWord( vector< uint8_t >& Bytes, uint32_t Value )
+{
+    for( int i = 0; i < 4; i++ )
+      Bytes.push_back( (Value >> (8 * i)) & 255 );
+}
+
+// -----------------------------------------------------------------------------
+
+static void AppendWords( vector< uint8_t >& Bytes, const vector< uint32_t >& Values )
+{
+    for( uint32_t Value: Values )
+      AppendWord( Bytes, Value );
+}
+
+// -----------------------------------------------------------------------------
+
+// signatures have no null termination in files
+static void AppendSignature( vector< uint8_t >& Bytes, const char* Signature )
+{
+    for( int i = 0; i < 8; i++ )
+      Bytes.push_back( Signature[ i ] );
+}
+
+// -----------------------------------------------------------------------------
+
+static void SetWord( vector< uint8_t >& Bytes, uint32_t Offset, uint32_t Value )
+{
+    for( int i = 0; i < 4; i++ )
+      Bytes[ Offset + i ] = (Value >> (8 * i)) & 255;
+}
+
+// -----------------------------------------------------------------------------
+
+static uint32_t GetWord( const vector< uint8_t >& Bytes, uint32_t Offset )
+{
+    uint32_t Value = 0;
+    
+    for( int i = 3; i >= 0; i-- )
+      Value = (Value << 8) | Bytes[ Offset + i ];
+    
+    return Value;
+}
+
+// -----------------------------------------------------------------------------
+
+static void WriteFile( const string& FilePath, const vector< uint8_t >& Bytes )
+{
+    ofstream OutputFile( FilePath, ios_base::binary );
+    OutputFile.write( (const char*)(&Bytes[ 0 ]), Bytes.size() );
+}
+
+// -----------------------------------------------------------------------------
+
+// a valid LZ4 block can consist of a single sequence
+// with only literals, so tests need no compressor
+static vector< uint8_t > EncodeLiteralsLZ4( const vector< uint8_t >& Data )
+{
+    vector< uint8_t > Block;
+    Block.push_back( 0xF0 );
+    
+    for( size_t Remaining = Data.size() - 15; true; Remaining -= 255 )
+    {
+        if( Remaining < 255 )
+        {
+            Block.push_back( Remaining );
+            break;
+        }
+        
+        Block.push_back( 255 );
+    }
+    
+    Block.insert( Block.end(), Data.begin(), Data.end() );
+    return Block;
+}
+
+// -----------------------------------------------------------------------------
+
+static bool DecodesTo( const vector< uint8_t >& Block, const vector< uint8_t >& Expected )
+{
+    vector< uint8_t > Decoded( Expected.size() );
+    
+    if( !DecodeLZ4Block( &Block[ 0 ], Block.size(), &Decoded[ 0 ], Decoded.size() ) )
+      return false;
+    
+    return (Decoded == Expected);
+}
+
+// -----------------------------------------------------------------------------
+
+static bool DecodesToLength( const vector< uint8_t >& Block, uint32_t DecodedLength )
+{
+    vector< uint8_t > Decoded( DecodedLength + 1 );
+    return DecodeLZ4Block( &Block[ 0 ], Block.size(), &Decoded[ 0 ], DecodedLength );
+}
+
+
+// =============================================================================
+//      TEST CARTRIDGES
+// =============================================================================
+
+
+// cartridges used in tests contain 1 texture and 1 sound
+struct TestCartridge
+{
+    vector< uint32_t > Program;
+    uint32_t TextureWidth;
+    uint32_t TextureHeight;
+    vector< uint32_t > Pixels;
+    vector< uint32_t > Samples;
+};
+
+// -----------------------------------------------------------------------------
+
+// contents repeat often, so that the packer can compress them
+static TestCartridge CreateTestCartridge()
+{
+    TestCartridge Cartridge;
+    Cartridge.TextureWidth = 40;
+    Cartridge.TextureHeight = 30;
+    
+    for( int i = 0; i < 300; i++ )
+      Cartridge.Program.push_back( (i % 7 == 0)? RandomWord() : 0x12345678 );
+    
+    for( uint32_t i = 0; i < Cartridge.TextureWidth * Cartridge.TextureHeight; i++ )
+      Cartridge.Pixels.push_back( (i / 16) % 2? 0xFF00FF00 : RandomWord() );
+    
+    for( int i = 0; i < 500; i++ )
+      Cartridge.Samples.push_back( (i % 50) * 0x00010001 );
+    
+    return Cartridge;
+}
+
+// -----------------------------------------------------------------------------
+
+// header fields before the ROM locations are the same in both formats
+static void AppendCommonHeader( vector< uint8_t >& Bytes, const char* Signature )
+{
+    AppendSignature( Bytes, Signature );
+    AppendWord( Bytes, Constants::VirconVersion );
+    AppendWord( Bytes, Constants::VirconRevision );
+    
+    char Title[ 64 ] = "Test cartridge";
+    Bytes.insert( Bytes.end(), Title, Title + 64 );
+    
+    AppendWord( Bytes, 1 );     // ROM version
+    AppendWord( Bytes, 0 );     // ROM revision
+    AppendWord( Bytes, 1 );     // number of textures
+    AppendWord( Bytes, 1 );     // number of sounds
+}
+
+// -----------------------------------------------------------------------------
+
+// the embedded files for program, texture and sound, in that
+// order, as pairs of the file header and the file contents
+static vector< vector< uint8_t > > CreateEmbeddedFiles( const TestCartridge& Cartridge, bool Headers )
+{
+    vector< vector< uint8_t > > Files( 3 );
+    
+    if( Headers )
+    {
+        AppendSignature( Files[ 0 ], BinaryFileFormat::Signature );
+        AppendWord( Files[ 0 ], Cartridge.Program.size() );
+        
+        AppendSignature( Files[ 1 ], TextureFileFormat::Signature );
+        AppendWord( Files[ 1 ], Cartridge.TextureWidth );
+        AppendWord( Files[ 1 ], Cartridge.TextureHeight );
+        
+        AppendSignature( Files[ 2 ], SoundFileFormat::Signature );
+        AppendWord( Files[ 2 ], Cartridge.Samples.size() );
+    }
+    
+    else
+    {
+        AppendWords( Files[ 0 ], Cartridge.Program );
+        AppendWords( Files[ 1 ], Cartridge.Pixels );
+        AppendWords( Files[ 2 ], Cartridge.Samples );
+    }
+    
+    return Files;
+}
+
+// -----------------------------------------------------------------------------
+
+static vector< uint8_t > BuildCartridge( const TestCartridge& Cartridge )
+{
+    vector< vector< uint8_t > > Headers = CreateEmbeddedFiles( Cartridge, true );
+    vector< vector< uint8_t > > Contents = CreateEmbeddedFiles( Cartridge, false );
+    
+    vector< uint8_t > Bytes;
+    AppendCommonHeader( Bytes, ROMFileFormat::CartridgeSignature );
+    
+    // program, video and audio ROMs go in sequence
+    uint32_t Offset = sizeof(ROMFileFormat::Header);
+    
+    for( int i = 0; i < 3; i++ )
+    {
+        uint32_t Length = Headers[ i ].size() + Contents[ i ].size();
+        AppendWord( Bytes, Offset );
+        AppendWord( Bytes, Length );
+        Offset += Length;
+    }
+    
+    Bytes.resize( sizeof(ROMFileFormat::Header), 0 );
+    
+    for( int i = 0; i < 3; i++ )
+    {
+        Bytes.insert( Bytes.end(), Headers[ i ].begin(), Headers[ i ].end() );
+        Bytes.insert( Bytes.end(), Contents[ i ].begin(), Contents[ i ].end() );
+    }
+    
+    return Bytes;
+}
+
+// -----------------------------------------------------------------------------
+
+// the table of contents goes right after the header;
+// each chunk is stored with the given codec
+static vector< uint8_t > BuildCompressedCartridge( const TestCartridge& Cartridge, const CompressedROMFileFormat::Codecs (&Codecs)[ 3 ] )
+{
+    vector< vector< uint8_t > > Headers = CreateEmbeddedFiles( Cartridge, true );
+    vector< vector< uint8_t > > Contents = CreateEmbeddedFiles( Cartridge, false );
+    
+    vector< uint8_t > Bytes;
+    AppendCommonHeader( Bytes, CompressedROMFileFormat::Signature );
+    AppendWord( Bytes, sizeof(CompressedROMFileFormat::Header) );
+    AppendWord( Bytes, 3 * sizeof(CompressedROMFileFormat::ChunkLocation) );
+    Bytes.resize( sizeof(CompressedROMFileFormat::Header), 0 );
+    
+    vector< uint8_t > Chunks;
+    uint32_t ChunksStart = Bytes.size() + 3 * sizeof(CompressedROMFileFormat::ChunkLocation);
+    
+    for( int i = 0; i < 3; i++ )
+    {
+        vector< uint8_t > Stored = Contents[ i ];
+        
+        if( Codecs[ i ] == CompressedROMFileFormat::Codecs::LZ4 )
+          Stored = EncodeLiteralsLZ4( Contents[ i ] );
+        
+        AppendWord( Bytes, ChunksStart + Chunks.size() );
+        AppendWord( Bytes, Headers[ i ].size() + Stored.size() );
+        AppendWord( Bytes, (uint32_t)Codecs[ i ] );
+        AppendWord( Bytes, Contents[ i ].size() );
+        
+        Chunks.insert( Chunks.end(), Headers[ i ].begin(), Headers[ i ].end() );
+        Chunks.insert( Chunks.end(), Stored.begin(), Stored.end() );
+    }
+    
+    Bytes.insert( Bytes.end(), Chunks.begin(), Chunks.end() );
+    Bytes.resize( (Bytes.size() + 3) & ~3, 0 );
+    return Bytes;
+}
+
+// -----------------------------------------------------------------------------
+
+// byte offset of a field within the table of contents
+static uint32_t ChunkField( int Chunk, int Field )
+{
+    return sizeof(CompressedROMFileFormat::Header) + 16 * Chunk + 4 * Field;
+}
+
+// -----------------------------------------------------------------------------
+
+// compares the loaded contents with the cartridge; textures and
+// sounds are read again, since loader threads may not be done
+static void CheckLoadedContents( V32Console& Console, const TestCartridge& Cartridge )
+{
+    V32CartridgeController& Controller = Console.CartridgeController;
+    CHECK( Controller.NumberOfTextures == 1 );
+    CHECK( Controller.NumberOfSounds == 1 );
+    CHECK( Controller.Memory.size() == Cartridge.Program.size() );
+    
+    if( Controller.Memory.size() == Cartridge.Program.size() )
+      CHECK( !memcmp( &Controller.Memory[ 0 ], &Cartridge.Program[ 0 ], Cartridge.Program.size() * 4 ) );
+    
+    vector< GPUColor > Pixels;
+    CHECK( Controller.ReadTexture( 0, Pixels, Controller.LinkedFile ) );
+    CHECK( Pixels.size() == Cartridge.Pixels.size() );
+    
+    if( Pixels.size() == Cartridge.Pixels.size() )
+      CHECK( !memcmp( &Pixels[ 0 ], &Cartridge.Pixels[ 0 ], Pixels.size() * 4 ) );
+    
+    vector< SPUSample > Samples;
+    CHECK( Controller.ReadSound( 0, Samples, Controller.LinkedFile ) );
+    CHECK( Samples.size() == Cartridge.Samples.size() );
+    
+    if( Samples.size() == Cartridge.Samples.size() )
+      CHECK( !memcmp( &Samples[ 0 ], &Cartridge.Samples[ 0 ], Samples.size() * 4 ) );
+}
+
+// -----------------------------------------------------------------------------
+
+// files are created in the working directory
+const char TestCartridgePath[] = "cartridge_test.v32z";
+
+// the error message tells which of the checks failed
+static string LoadError( const vector< uint8_t >& Bytes )
+{
+    WriteFile( TestCartridgePath, Bytes );
+    unique_ptr< V32Console > Console = CreateConsole();
+    string Error;
+    
+    try
+    {
+        Console->LoadCartridge( TestCartridgePath );
+    }
+    
+    catch( runtime_error& e )
+    {
+        Error = e.what();
+    }
+    
+    remove( TestCartridgePath );
+    return Error;
+}
+
+// -----------------------------------------------------------------------------
+
+static bool LoadFailsWith( const vector< uint8_t >& Bytes, const char* Message )
+{
+    return LoadError( Bytes ).find( Message ) != string::npos;
+}
+
+
+// =============================================================================
+//      TESTS FOR DECODERS
+// =============================================================================
+
+
+static void TestLZ4KnownBlocks()
+{
+    // only literals
+    vector< uint8_t > Hello = { 'h', 'e', 'l', 'l', 'o' };
+    CHECK( DecodesTo( { 0x50, 'h', 'e', 'l', 'l', 'o' }, Hello ) );
+    
+    // a match overlapping its own output repeats a pattern
+    vector< uint8_t > Pattern = { 'a', 'b', 'a', 'b', 'a', 'b', 'a', 'b', 'x' };
+    CHECK( DecodesTo( { 0x22, 'a', 'b', 0x02, 0x00, 0x10, 'x' }, Pattern ) );
+    
+    // blocks can also end right after a match
+    CHECK( DecodesTo( { 0x22, 'a', 'b', 0x02, 0x00 }, { 'a', 'b', 'a', 'b', 'a', 'b', 'a', 'b' } ) );
+    
+    // length extensions for both literals and matches
+    vector< uint8_t > LongData;
+    
+    for( int i = 0; i < 300; i++ )
+      LongData.push_back( i * 7 );
+    
+    CHECK( DecodesTo( EncodeLiteralsLZ4( LongData ), LongData ) );
+    
+    vector< uint8_t > Zeroes( 1 + 4 + 15 + 255 + 10, 0 );
+    CHECK( DecodesTo( { 0x1F, 0x00, 0x01, 0x00, 255, 10 }, Zeroes ) );
+}
+
+// -----------------------------------------------------------------------------
+
+static void TestLZ4MalformedBlocks()
+{
+    // match offsets must be within the output
+    CHECK( !DecodesToLength( { 0x22, 'a', 'b', 0x00, 0x00 }, 8 ) );
+    CHECK( !DecodesToLength( { 0x22, 'a', 'b', 0x03, 0x00 }, 8 ) );
+    
+    // truncated length extensions, literals and offsets
+    CHECK( !DecodesToLength( { 0xF0, 255 }, 300 ) );
+    CHECK( !DecodesToLength( { 0x50, 'h', 'e', 'l' }, 5 ) );
+    CHECK( !DecodesToLength( { 0x22, 'a', 'b', 0x02 }, 8 ) );
+    CHECK( !DecodesToLength( { 0x2F, 'a', 'b', 0x02, 0x00 }, 100 ) );
+    
+    // output must be filled exactly, with no overflows
+    CHECK( !DecodesToLength( { 0x50, 'h', 'e', 'l', 'l', 'o' }, 4 ) );
+    CHECK( !DecodesToLength( { 0x22, 'a', 'b', 0x02, 0x00 }, 7 ) );
+    CHECK( !DecodesToLength( { 0x50, 'h', 'e', 'l', 'l', 'o' }, 6 ) );
+    
+    // random mutations of a valid block must not write
+    // out of the destination, even if they are accepted
+    vector< uint8_t > Valid = { 0x42, 'a', 'b', 'c', 'd', 0x04, 0x00, 0x3F, 'x', 'y', 'z', 0x03, 0x00, 20, 0x20, 'e', 'n' };
+    const uint32_t DecodedLength = 4 + 6 + 3 + 4 + 15 + 20 + 2;
+    CHECK( DecodesToLength( Valid, DecodedLength ) );
+    
+    for( int Iteration = 0; Iteration < 20000; Iteration++ )
+    {
+        vector< uint8_t > Mutated = Valid;
+        int Changes = 1 + RandomWord() % 3;
+        
+        for( int i = 0; i < Changes; i++ )
+          Mutated[ RandomWord() % Mutated.size() ] = RandomWord() >> 24;
+        
+        if( RandomWord() % 4 == 0 )
+          Mutated.resize( RandomWord() % Mutated.size() + 1 );
+        
+        vector< uint8_t > Decoded( DecodedLength + 64, 0xA5 );
+        DecodeLZ4Block( &Mutated[ 0 ], Mutated.size(), &Decoded[ 0 ], DecodedLength );
+        
+        for( size_t i = DecodedLength; i < Decoded.size(); i++ )
+          CHECK( Decoded[ i ] == 0xA5 );
+    }
+}
+
+// -----------------------------------------------------------------------------
+
+static void TestDecodeChunk()
+{
+    uint8_t Source[ 4 ] = { 1, 2, 3, 4 };
+    uint8_t Destination[ 4 ] = { 0 };
+    
+    CHECK( DecodeChunk( (uint32_t)CompressedROMFileFormat::Codecs::Raw, Source, 4, Destination, 4 ) );
+    CHECK( !memcmp( Source, Destination, 4 ) );
+    
+    // raw chunks can't change length, and unknown codecs are rejected
+    CHECK( !DecodeChunk( (uint32_t)CompressedROMFileFormat::Codecs::Raw, Source, 4, Destination, 3 ) );
+    CHECK( !DecodeChunk( 1000, Source, 4, Destination, 4 ) );
+}
+
+
+// =============================================================================
+//      TESTS FOR COMPRESSED CARTRIDGES
+// =============================================================================
+
+
+static void TestCompressedCartridgeLoads()
+{
+    typedef CompressedROMFileFormat::Codecs Codecs;
+    const Codecs CodecCombinations[][ 3 ] =
+    {
+        { Codecs::Raw, Codecs::Raw, Codecs::Raw },
+        { Codecs::LZ4, Codecs::LZ4, Codecs::LZ4 },
+        { Codecs::LZ4, Codecs::Raw, Codecs::LZ4 }
+    };
+    
+    TestCartridge Cartridge = CreateTestCartridge();
+    
+    for( const auto& Combination: CodecCombinations )
+    {
+        WriteFile( TestCartridgePath, BuildCompressedCartridge( Cartridge, Combination ) );
+        
+        {
+            unique_ptr< V32Console > Console = CreateConsole();
+            Console->LoadCartridge( TestCartridgePath );
+            CheckLoadedContents( *Console, Cartridge );
+        }
+        
+        remove( TestCartridgePath );
+    }
+}
+
+// -----------------------------------------------------------------------------
+
+static void TestMalformedCompressedCartridges()
+{
+    typedef CompressedROMFileFormat::Codecs Codecs;
+    const Codecs AllLZ4[ 3 ] = { Codecs::LZ4, Codecs::LZ4, Codecs::LZ4 };
+    
+    TestCartridge Cartridge = CreateTestCartridge();
+    const vector< uint8_t > Valid = BuildCompressedCartridge( Cartridge, AllLZ4 );
+    CHECK( LoadError( Valid ).empty() );
+    
+    // table of contents not matching the number of chunks
+    vector< uint8_t > Bytes = Valid;
+    SetWord( Bytes, 100, 2 * sizeof(CompressedROMFileFormat::ChunkLocation) );
+    CHECK( LoadFailsWith( Bytes, "table of contents" ) );
+    
+    // table of contents out of the file
+    Bytes = Valid;
+    SetWord( Bytes, 96, Valid.size() - 16 );
+    CHECK( LoadFailsWith( Bytes, "table of contents" ) );
+    
+    Bytes = Valid;
+    SetWord( Bytes, 96, 0xFFFFFFF0 );
+    CHECK( LoadFailsWith( Bytes, "table of contents" ) );
+    
+    // chunks out of the file, including overflows
+    for( int Chunk = 0; Chunk < 3; Chunk++ )
+    {
+        Bytes = Valid;
+        SetWord( Bytes, ChunkField( Chunk, 1 ), Valid.size() );
+        CHECK( LoadFailsWith( Bytes, "chunk is out of file limits" ) );
+        
+        Bytes = Valid;
+        SetWord( Bytes, ChunkField( Chunk, 0 ), 0xFFFFFFF0 );
+        CHECK( LoadFailsWith( Bytes, "chunk is out of file limits" ) );
+    }
+    
+    // chunks too short for their file header
+    Bytes = Valid;
+    SetWord( Bytes, ChunkField( 0, 1 ), 8 );
+    CHECK( LoadFailsWith( Bytes, "chunk is out of file limits" ) );
+    
+    Bytes = Valid;
+    SetWord( Bytes, ChunkField( 1, 1 ), 12 );
+    CHECK( LoadFailsWith( Bytes, "chunk is out of file limits" ) );
+    
+    // decoded lengths not matching the file headers
+    const char* DecodedLengthErrors[ 3 ] = { "correct size", "correct dimensions", "correct length" };
+    
+    for( int Chunk = 0; Chunk < 3; Chunk++ )
+    {
+        Bytes = Valid;
+        SetWord( Bytes, ChunkField( Chunk, 3 ), 4 );
+        CHECK( LoadFailsWith( Bytes, DecodedLengthErrors[ Chunk ] ) );
+    }
+    
+    // a program that cannot be decoded
+    Bytes = Valid;
+    SetWord( Bytes, ChunkField( 0, 2 ), 1000 );
+    CHECK( LoadFailsWith( Bytes, "cannot be decoded" ) );
+    
+    Bytes = Valid;
+    SetWord( Bytes, ChunkField( 0, 1 ), Cartridge.Program.size() * 4 );
+    CHECK( LoadFailsWith( Bytes, "cannot be decoded" ) );
+}
+
+// -----------------------------------------------------------------------------
+
+// assets that cannot be decoded don't stop the
+// cartridge, but reading them has to fail
+static void TestUndecodableAssets()
+{
+    typedef CompressedROMFileFormat::Codecs Codecs;
+    const Codecs AllLZ4[ 3 ] = { Codecs::LZ4, Codecs::LZ4, Codecs::LZ4 };
+    
+    TestCartridge Cartridge = CreateTestCartridge();
+    vector< uint8_t > Bytes = BuildCompressedCartridge( Cartridge, AllLZ4 );
+    
+    // with no literals, the first match has nothing to copy
+    uint32_t TextureData = GetWord( Bytes, ChunkField( 1, 0 ) ) + sizeof(TextureFileFormat::Header);
+    Bytes[ TextureData ] = 0x00;
+    
+    // the sound chunk is cut short
+    SetWord( Bytes, ChunkField( 2, 1 ), Cartridge.Samples.size() );
+    
+    WriteFile( TestCartridgePath, Bytes );
+    
+    {
+        unique_ptr< V32Console > Console = CreateConsole();
+        Console->LoadCartridge( TestCartridgePath );
+        
+        vector< GPUColor > Pixels;
+        CHECK( !Console->CartridgeController.ReadTexture( 0, Pixels, Console->CartridgeController.LinkedFile ) );
+        
+        vector< SPUSample > Samples;
+        CHECK( !Console->CartridgeController.ReadSound( 0, Samples, Console->CartridgeController.LinkedFile ) );
+        
+        // and the program is still loaded
+        CHECK( Console->CartridgeController.Memory.size() == Cartridge.Program.size() );
+    }
+    
+    remove( TestCartridgePath );
+}
+
+// -----------------------------------------------------------------------------
+
+// memory for decoded textures is reserved when they are
+// claimed, so loaders can't go over the limit together
+static void TestDecodedTextureLimit()
+{
+    unique_ptr< V32Console > Console = CreateConsole();
+    V32GPU& GPU = Console->GPU;
+    GPU.SetCartridgeTexturesPending( 3 );
+    
+    const uint32_t MegaByte = 1024 * 1024;
+    CHECK( GPU.ClaimCartridgeTexture( 0, 20 * MegaByte ) );
+    CHECK( !GPU.ClaimCartridgeTexture( 0, 1 ) );
+    CHECK( !GPU.ClaimCartridgeTexture( 1, 20 * MegaByte ) );
+    CHECK( GPU.ClaimCartridgeTexture( 2, 12 * MegaByte ) );
+    
+    CHECK( GPU.DecodedTextureBytes == GPUMaximumDecodedTextureBytes );
+    
+    // once taken, its memory is available again
+    vector< GPUColor > Decoded( 12 * MegaByte / sizeof(GPUColor) ), Pixels;
+    GPU.FinishCartridgeTexture( 2, Decoded );
+    GPU.TakeCartridgeTexture( 2, Pixels );
+    CHECK( Pixels.size() * sizeof(GPUColor) == 12 * MegaByte );
+    CHECK( GPU.DecodedTextureBytes == 20 * MegaByte );
+    CHECK( GPU.ClaimCartridgeTexture( 1, 12 * MegaByte ) );
+    
+    GPU.SetCartridgeTexturesPending( 0 );
+}
+
+// -----------------------------------------------------------------------------
+
+// a failed load must not keep the file open, since
+// then the next cartridge could not be opened
+static void TestLoadAfterFailedLoad()
+{
+    typedef CompressedROMFileFormat::Codecs Codecs;
+    const Codecs AllRaw[ 3 ] = { Codecs::Raw, Codecs::Raw, Codecs::Raw };
+    
+    TestCartridge Cartridge = CreateTestCartridge();
+    vector< uint8_t > Valid = BuildCompressedCartridge( Cartridge, AllRaw );
+    vector< uint8_t > Malformed = Valid;
+    SetWord( Malformed, 100, 0 );
+    
+    unique_ptr< V32Console > Console = CreateConsole();
+    
+    // fail in the header checks, before the program is loaded
+    WriteFile( TestCartridgePath, Malformed );
+    bool Failed = false;
+    
+    try
+    {
+        Console->LoadCartridge( TestCartridgePath );
+    }
+    
+    catch( runtime_error& )
+    {
+        Failed = true;
+    }
+    
+    CHECK( Failed );
+    CHECK( !Console->HasCartridge() );
+    
+    WriteFile( TestCartridgePath, Valid );
+    Console->LoadCartridge( TestCartridgePath );
+    CheckLoadedContents( *Console, Cartridge );
+    
+    Console.reset();
+    remove( TestCartridgePath );
+}
+
+// -----------------------------------------------------------------------------
+
+// packs a regular cartridge with the packer script,
+// and both versions need to load the same contents
+static void TestPackerRoundTrip()
+{
+    #if defined(TEST_PYTHON) && defined(TEST_PACKER_SCRIPT)
+        const char RegularPath[] = "cartridge_test.v32";
+        TestCartridge Cartridge = CreateTestCartridge();
+        vector< uint8_t > Regular = BuildCartridge( Cartridge );
+        WriteFile( RegularPath, Regular );
+        
+        // check the regular version too, so that
+        // failures can't come from the test itself
+        {
+            unique_ptr< V32Console > Console = CreateConsole();
+            Console->LoadCartridge( RegularPath );
+            CheckLoadedContents( *Console, Cartridge );
+        }
+        
+        for( const char* Options: { "", "--raw " } )
+        {
+            string Command = string( "\"" ) + TEST_PYTHON + "\" \"" + TEST_PACKER_SCRIPT + "\" "
+                           + Options + RegularPath + " " + TestCartridgePath;
+            
+            CHECK( system( Command.c_str() ) == 0 );
+            
+            {
+                unique_ptr< V32Console > Console = CreateConsole();
+                Console->LoadCartridge( TestCartridgePath );
+                CheckLoadedContents( *Console, Cartridge );
+                
+                // contents repeat, so compression has to work
+                if( *Options == 0 )
+                {
+                    ifstream PackedFile( TestCartridgePath, ios_base::binary | ios_base::ate );
+                    CHECK( (size_t)PackedFile.tellg() < Regular.size() / 2 );
+                }
+            }
+            
+            remove( TestCartridgePath );
+        }
+        
+        remove( RegularPath );
+    #else
+        printf( "  skipped: python was not found\n" );
+    #endif
+}
+
+
+// =============================================================================
+//      MAIN FUNCTION
+// =============================================================================
+
+
+const UnitTest CartridgeTests[] =
+{
+    { "LZ4KnownBlocks",                TestLZ4KnownBlocks                },
+    { "LZ4MalformedBlocks",            TestLZ4MalformedBlocks            },
+    { "DecodeChunk",                   TestDecodeChunk                   },
+    { "CompressedCartridgeLoads",      TestCompressedCartridgeLoads      },
+    { "MalformedCompressedCartridges", TestMalformedCompressedCartridges },
+    { "UndecodableAssets",             TestUndecodableAssets             },
+    { "DecodedTextureLimit",           TestDecodedTextureLimit           },
+    { "LoadAfterFailedLoad",           TestLoadAfterFailedLoad           },
+    { "PackerRoundTrip",               TestPackerRoundTrip               }
+};
+
+// -----------------------------------------------------------------------------
+
+int main( int NumberOfArguments, char* Arguments[] )
+{
+    return RunUnitTests( CartridgeTests, NumberOfArguments, Arguments );
+}
@@ -0,0 +1,205 @@
+// *****************************************************************************
+    // include Vircon32 headers
+    #include "ConsoleLogic/V32Console.hpp"
+    
+    // include emulator headers
+    #include "Cheats.hpp"
+    #include "UnitTests.hpp"
+    
+    // include C/C++ headers
+    #include <climits>          // [ ANSI C ] Numeric limits
+    #include <memory>           // [ C++ STL ] Smart pointers
+    #include <vector>           // [ C++ STL ] Vectors
+    
+    // declare used namespaces
+    using namespace std;
+    using namespace V32;
+// *****************************************************************************
+
+
+// =============================================================================
+//      AUXILIARY FUNCTIONS
+// =============================================================================
+
+
+// nothing is drawn and logs are ignored
+static HeadlessCallbacks TestCallbacks;
+
+// -----------------------------------------------------------------------------
+
+// no BIOS is needed, since tests only use RAM
+static unique_ptr< V32Console > CreateConsole()
+{
+    unique_ptr< V32Console > Console( new V32Console );
+    Console->SetCallbacks( &TestCallbacks );
+    return Console;
+}
+
+// -----------------------------------------------------------------------------
+
+// a fixed sequence, so that failures can be reproduced
+static uint32_t RandomState = 12345;
+
+static int32_t RandomWord()
+{
+    RandomState = RandomState * 1664525 + 1013904223;
+    return (int32_t)RandomState;
+}
+
+// -----------------------------------------------------------------------------
+
+// mostly values near the limits of signed comparisons,
+// since those are the ones SIMD versions can get wrong
+static int32_t RandomTestValue()
+{
+    const int32_t EdgeValues[] = { INT_MIN, INT_MIN + 1, -1, 0, 1, INT_MAX - 1, INT_MAX };
+    uint32_t Choice = (uint32_t)RandomWord() >> 28;
+    
+    if( Choice < 7 )
+      return EdgeValues[ Choice ];
+    
+    return RandomWord();
+}
+
+
+// =============================================================================
+//      TESTS FOR RAM SEARCH
+// =============================================================================
+
+
+static void TestCompareBlockMatchesScalar()
+{
+    int32_t A[ 64 ], B[ 64 ];
+    
+    for( int Iteration = 0; Iteration < 10000; Iteration++ )
+    {
+        // half of the words are made equal, so that
+        // equality comparisons don't always fail
+        for( int i = 0; i < 64; i++ )
+        {
+            A[ i ] = RandomTestValue();
+            B[ i ] = (RandomWord() & 1)? A[ i ] : RandomTestValue();
+        }
+        
+        for( bool Greater: { false, true } )
+        {
+            uint64_t Expected = RAMSearch::CompareBlockScalar( A, B, Greater );
+            CHECK( RAMSearch::CompareBlock( A, B, Greater ) == Expected );
+        }
+    }
+}
+
+// -----------------------------------------------------------------------------
+
+// each step is checked against a plain comparison of all words
+static void TestFilterMatchesReference()
+{
+    unique_ptr< V32Console > Console = CreateConsole();
+    V32RAM& RAM = Console->RAM;
+    RAMSearch Search( *Console );
+    
+    vector< bool > Expected( Constants::RAMSize, true );
+    vector< int32_t > Previous( Constants::RAMSize, 0 );
+    Search.Start();
+    
+    const RAMSearchComparisons Steps[] =
+    {
+        RAMSearchComparisons::Changed,
+        RAMSearchComparisons::Increased,
+        RAMSearchComparisons::Unchanged,
+        RAMSearchComparisons::Decreased,
+        RAMSearchComparisons::EqualToValue
+    };
+    
+    for( RAMSearchComparisons Comparison: Steps )
+    {
+        // change many words, some of them more than once
+        for( int i = 0; i < 200000; i++ )
+        {
+            V32Word Value;
+            Value.AsInteger = RandomTestValue();
+            RAM.WriteAddress( (uint32_t)RandomWord() % Constants::RAMSize, Value );
+        }
+        
+        int32_t SearchedValue = RAM.Memory[ 1000 ].AsInteger;
+        uint32_t ExpectedCount = 0;
+        
+        for( int32_t Address = 0; Address < Constants::RAMSize; Address++ )
+        {
+            int32_t Current = RAM.Memory[ Address ].AsInteger;
+            bool Matches = false;
+            
+            switch( Comparison )
+            {
+                case RAMSearchComparisons::EqualToValue: Matches = (Current == SearchedValue);    break;
+                case RAMSearchComparisons::Changed:      Matches = (Current != Previous[ Address ]); break;
+                case RAMSearchComparisons::Unchanged:    Matches = (Current == Previous[ Address ]); break;
+                case RAMSearchComparisons::Increased:    Matches = (Current > Previous[ Address ]);  break;
+                case RAMSearchComparisons::Decreased:    Matches = (Current < Previous[ Address ]);  break;
+            }
+            
+            Expected[ Address ] = Expected[ Address ] && Matches;
+            ExpectedCount += Expected[ Address ];
+            Previous[ Address ] = Current;
+        }
+        
+        CHECK( Search.Filter( Comparison, SearchedValue ) == ExpectedCount );
+        CHECK( Search.CountCandidates() == ExpectedCount );
+        
+        // all candidates are listed in address order
+        vector< int32_t > Candidates = Search.GetCandidates( Constants::RAMSize );
+        CHECK( Candidates.size() == ExpectedCount );
+        
+        for( int32_t Address: Candidates )
+          CHECK( Expected[ Address ] );
+    }
+}
+
+
+// =============================================================================
+//      TESTS FOR CHEAT CODES
+// =============================================================================
+
+
+static void TestCheatCodes()
+{
+    unique_ptr< V32Console > Console = CreateConsole();
+    CheatEngine Cheats( *Console );
+    
+    // several codes, with all accepted separators
+    CHECK( Cheats.SetCheat( 0, true, "000100:0000002A+000200=FFFFFFFF + 3FFFFF 7" ) );
+    CHECK( !Cheats.SetCheat( 1, true, "400000:1" ) );
+    CHECK( !Cheats.SetCheat( 1, true, "0100:" ) );
+    CHECK( !Cheats.SetCheat( 1, true, "" ) );
+    
+    Cheats.ApplyCheats();
+    CHECK( Console->RAM.Memory[ 0x100 ].AsInteger == 42 );
+    CHECK( Console->RAM.Memory[ 0x200 ].AsInteger == -1 );
+    CHECK( Console->RAM.Memory[ 0x3FFFFF ].AsInteger == 7 );
+    
+    // disabled cheats are no longer applied
+    Cheats.SetCheat( 0, false, "" );
+    Console->RAM.Memory[ 0x100 ].AsInteger = 0;
+    Cheats.ApplyCheats();
+    CHECK( Console->RAM.Memory[ 0x100 ].AsInteger == 0 );
+}
+
+
+// =============================================================================
+//      MAIN FUNCTION
+// =============================================================================
+
+
+const UnitTest CheatTests[] =
+{
+    { "CompareBlockMatchesScalar", TestCompareBlockMatchesScalar },
+    { "FilterMatchesReference",    TestFilterMatchesReference    },
+    { "CheatCodes",                TestCheatCodes                }
+};
+
+// -----------------------------------------------------------------------------
+
+int main( int NumberOfArguments, char* Arguments[] )
+{
+    return RunUnitTests( CheatTests, NumberOfArguments, Arguments );
+}
@@ -0,0 +1,204 @@
+// *****************************************************************************
+    // include libretro headers
+    #include "libretro.h"
+    
+    // include emulator headers
+    #include "UnitTests.hpp"
+    
+    // include C/C++ headers
+    #include <cstdio>           // [ ANSI C ] Standard I/O
+    #include <dlfcn.h>          // [ POSIX ] Dynamic loading
+    #include <fstream>          // [ C++ STL ] File streams
+    #include <stdexcept>        // [ C++ STL ] Exceptions
+    #include <string>           // [ C++ STL ] Strings
+    #include <vector>           // [ C++ STL ] Vectors
+    
+    // declare used namespaces
+    using namespace std;
+// *****************************************************************************
+
+
+// =============================================================================
+//      LOADING THE CORE
+// =============================================================================
+
+
+// the core is loaded the same way a frontend would, so
+// that its global state is only reached through its API
+struct CoreFunctions
+{
+    void (*SetEnvironment)( retro_environment_t );
+    void (*Init)();
+    void (*Deinit)();
+    bool (*LoadGame)( const retro_game_info* );
+    void (*UnloadGame)();
+    void* (*GetMemoryData)( unsigned );
+    size_t (*GetMemorySize)( unsigned );
+};
+
+// -----------------------------------------------------------------------------
+
+template< typename T >
+static void LoadFunction( void* Library, const char* Name, T& Function )
+{
+    Function = (T)dlsym( Library, Name );
+    
+    if( !Function )
+      throw runtime_error( string( "Core function not found: " ) + Name );
+}
+
+// -----------------------------------------------------------------------------
+
+// the library stays loaded until the program ends
+static const CoreFunctions& LoadCore()
+{
+    static CoreFunctions Core;
+    static void* Library = nullptr;
+    
+    if( Library )
+      return Core;
+    
+    Library = dlopen( TEST_CORE_PATH, RTLD_NOW | RTLD_LOCAL );
+    
+    if( !Library )
+      throw runtime_error( string( "Cannot load core: " ) + dlerror() );
+    
+    LoadFunction( Library, "retro_set_environment", Core.SetEnvironment );
+    LoadFunction( Library, "retro_init", Core.Init );
+    LoadFunction( Library, "retro_deinit", Core.Deinit );
+    LoadFunction( Library, "retro_load_game", Core.LoadGame );
+    LoadFunction( Library, "retro_unload_game", Core.UnloadGame );
+    LoadFunction( Library, "retro_get_memory_data", Core.GetMemoryData );
+    LoadFunction( Library, "retro_get_memory_size", Core.GetMemorySize );
+    return Core;
+}
+
+
+// =============================================================================
+//      FRONTEND ENVIRONMENT
+// =============================================================================
+
+
+// files are created in the working directory
+const char TestCartridgePath[] = "core_test.v32";
+const char TestMemoryCardPath[] = "./core_test.memc";
+
+// set by each test before loading a game
+static const char* MemoryCardStorage = "Core file";
+
+// -----------------------------------------------------------------------------
+
+// only what the core needs to load a game is provided;
+// in particular, a video context is never created
+static bool TestEnvironment( unsigned Command, void* Data )
+{
+    switch( Command )
+    {
+        case RETRO_ENVIRONMENT_GET_SAVE_DIRECTORY:
+        case RETRO_ENVIRONMENT_GET_SYSTEM_DIRECTORY:
+            *(const char**)Data = ".";
+            return true;
+        
+        case RETRO_ENVIRONMENT_GET_VARIABLE:
+        {
+            retro_variable* Variable = (retro_variable*)Data;
+            
+            if( string( Variable->key ) != "memory_card_storage" )
+              return false;
+            
+            Variable->value = MemoryCardStorage;
+            return true;
+        }
+        
+        case RETRO_ENVIRONMENT_SET_PIXEL_FORMAT:
+        case RETRO_ENVIRONMENT_SET_HW_RENDER:
+            return true;
+        
+        default:
+            return false;
+    }
+}
+
+// -----------------------------------------------------------------------------
+
+// the cartridge file is not read until the video context
+// is ready, so only the memory card needs to exist
+static void WriteMemoryCard( uint32_t FirstWord )
+{
+    vector< uint32_t > Words( 256 * 1024, 0 );
+    Words[ 0 ] = FirstWord;
+    
+    ofstream OutputFile( TestMemoryCardPath, ios_base::binary );
+    OutputFile.write( "V32-MEMC", 8 );
+    OutputFile.write( (const char*)(&Words[ 0 ]), Words.size() * 4 );
+}
+
+// -----------------------------------------------------------------------------
+
+// returns the first word of the memory card in save RAM,
+// or -1 if the core did not provide it as save RAM
+static int64_t LoadGameWithSaveRAM()
+{
+    const CoreFunctions& Core = LoadCore();
+    MemoryCardStorage = "Frontend save RAM";
+    
+    Core.SetEnvironment( TestEnvironment );
+    Core.Init();
+    
+    retro_game_info Game = {};
+    Game.path = TestCartridgePath;
+    CHECK( Core.LoadGame( &Game ) );
+    
+    int64_t FirstWord = -1;
+    uint32_t* SaveRAM = (uint32_t*)Core.GetMemoryData( RETRO_MEMORY_SAVE_RAM );
+    
+    if( SaveRAM && Core.GetMemorySize( RETRO_MEMORY_SAVE_RAM ) == 256 * 1024 * 4 )
+      FirstWord = SaveRAM[ 0 ];
+    
+    Core.UnloadGame();
+    Core.Deinit();
+    return FirstWord;
+}
+
+
+// =============================================================================
+//      TESTS FOR LOADING GAMES
+// =============================================================================
+
+
+// the memory card in save RAM is connected when loading the
+// game, which frontends do before creating a video context
+static void TestSaveRAMBeforeContext()
+{
+    remove( TestMemoryCardPath );
+    CHECK( LoadGameWithSaveRAM() == 0 );
+}
+
+// -----------------------------------------------------------------------------
+
+// an existing card file gives the initial save RAM contents
+static void TestSaveRAMFromCardFile()
+{
+    WriteMemoryCard( 0x12345678 );
+    CHECK( LoadGameWithSaveRAM() == 0x12345678 );
+    remove( TestMemoryCardPath );
+}
+
+
+// =============================================================================
+//      MAIN FUNCTION
+// =============================================================================
+
+
+const UnitTest CoreTests[] =
+{
+    { "SaveRAMBeforeContext", TestSaveRAMBeforeContext },
+    { "SaveRAMFromCardFile",  TestSaveRAMFromCardFile  }
+};
+
+// -----------------------------------------------------------------------------
+
+int main( int NumberOfArguments, char* Arguments[] )
+{
+    return RunUnitTests( CoreTests, NumberOfArguments, Arguments );
+}
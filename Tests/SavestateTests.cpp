@@ -0,0 +1,310 @@
+// *****************************************************************************
+    // include Vircon32 headers
+    #include "ConsoleLogic/V32Console.hpp"
+    
+    // include emulator headers
+    #include "Savestates.hpp"
+    #include "UnitTests.hpp"
+    
+    // include the autogenerated embedded bios file
+    #include <embedded/StandardBios.h>
+    
+    // include C/C++ headers
+    #include <memory>           // [ C++ STL ] Smart pointers
+    #include <sstream>          // [ C++ STL ] String streams
+    #include <vector>           // [ C++ STL ] Vectors
+    
+    // declare used namespaces
+    using namespace std;
+    using namespace V32;
+// *****************************************************************************
+
+
+// =============================================================================
+//      AUXILIARY FUNCTIONS
+// =============================================================================
+
+
+// nothing is drawn and logs are ignored
+static HeadlessCallbacks TestCallbacks;
+
+// -----------------------------------------------------------------------------
+
+// consoles run the standard BIOS, since states
+// can be saved and loaded with no cartridge
+static unique_ptr< V32Console > StartConsole()
+{
+    unique_ptr< V32Console > Console( new V32Console );
+    Console->SetCallbacks( &TestCallbacks );
+    
+    stringstream BiosData;
+    BiosData.write( (const char*)embedded_StandardBios, sizeof( embedded_StandardBios ) );
+    Console->LoadBiosData( BiosData );
+    Console->SetPower( true );
+    
+    for( int i = 0; i < 5; i++ )
+      Console->RunNextFrame( false );
+    
+    return Console;
+}
+
+// -----------------------------------------------------------------------------
+
+// enough capacity for all RAM pages, plus the rest
+static vector< uint8_t > SaveState( V32Console& Console )
+{
+    vector< uint8_t > State( Constants::RAMSize * sizeof(V32Word) + 1024 * 1024 );
+    CHECK( SaveCompactState( Console, &State[ 0 ], State.size(), nullptr ) );
+    return State;
+}
+
+// -----------------------------------------------------------------------------
+
+// addresses in pages that the BIOS never writes
+const int32_t PokedAddresses[] = { 0x123456, 0x200000, Constants::RAMSize - 1 };
+const int32_t OtherAddress = 0x300000;
+
+
+// =============================================================================
+//      TESTS FOR RAM EXPOSED TO THE FRONTEND
+// =============================================================================
+
+
+// the frontend writes through the pointer, not through the bus
+static void TestCompactStateWithExposedRAM()
+{
+    unique_ptr< V32Console > Source = StartConsole();
+    V32Word* SourceRAM = Source->RAM.ExposeMemory();
+    
+    for( int32_t Address: PokedAddresses )
+      SourceRAM[ Address ].AsInteger = Address ^ 0x5A5A5A5A;
+    
+    // saving clears the dirty bits of pages that are all zeroes;
+    // they must still be saved when written after that
+    SaveState( *Source );
+    SourceRAM[ OtherAddress - 1 ].AsInteger = 77;
+    vector< uint8_t > State = SaveState( *Source );
+    
+    // pages written in the target must be cleared,
+    // since they are not part of the loaded state
+    unique_ptr< V32Console > Target = StartConsole();
+    V32Word* TargetRAM = Target->RAM.ExposeMemory();
+    TargetRAM[ OtherAddress ].AsInteger = 12345;
+    
+    CHECK( LoadCompactState( *Target, &State[ 0 ], State.size(), nullptr ) );
+    CHECK( TargetRAM[ OtherAddress ].AsInteger == 0 );
+    CHECK( TargetRAM[ OtherAddress - 1 ].AsInteger == 77 );
+    
+    for( int32_t Address: PokedAddresses )
+      CHECK( TargetRAM[ Address ].AsInteger == (Address ^ 0x5A5A5A5A) );
+    
+    CHECK( !memcmp( &Target->RAM.Memory[ 0 ], &Source->RAM.Memory[ 0 ], Constants::RAMSize * sizeof(V32Word) ) );
+    CHECK( Target->GetFrameDigest().RAM == Source->GetFrameDigest().RAM );
+}
+
+// -----------------------------------------------------------------------------
+
+static void TestDigestWithExposedRAM()
+{
+    unique_ptr< V32Console > Console = StartConsole();
+    V32Word* RAM = Console->RAM.ExposeMemory();
+    uint64_t InitialDigest = Console->GetFrameDigest().RAM;
+    
+    RAM[ PokedAddresses[ 0 ] ].AsInteger = 1;
+    CHECK( Console->GetFrameDigest().RAM != InitialDigest );
+    
+    RAM[ PokedAddresses[ 0 ] ].AsInteger = 0;
+    CHECK( Console->GetFrameDigest().RAM == InitialDigest );
+}
+
+// -----------------------------------------------------------------------------
+
+// run-ahead copies only written pages to its shadow RAM,
+// so exposing memory must not make all of them written
+static void TestWrittenPagesWithExposedRAM()
+{
+    unique_ptr< V32Console > Console = StartConsole();
+    V32RAM& RAM = Console->RAM;
+    int32_t Address = PokedAddresses[ 0 ];
+    int32_t Page = Address >> RAMPageSizeBits;
+    
+    V32Word* Pointer = RAM.ExposeMemory();
+    RAM.ClearWrittenPages();
+    RAM.SyncExposedMemory();
+    CHECK( !RAM.IsPageWritten( Page ) );
+    
+    // writes through the pointer are found when syncing
+    Pointer[ Address ].AsInteger = 1;
+    RAM.SyncExposedMemory();
+    CHECK( RAM.IsPageWritten( Page ) );
+    CHECK( RAM.IsPageDirty( Page ) );
+    
+    // but only once, and not for writes from the bus
+    RAM.ClearWrittenPages();
+    RAM.SyncExposedMemory();
+    CHECK( !RAM.IsPageWritten( Page ) );
+    
+    V32Word Value;
+    Value.AsInteger = 2;
+    RAM.WriteAddress( Address, Value );
+    RAM.ClearWrittenPages();
+    RAM.SyncExposedMemory();
+    CHECK( !RAM.IsPageWritten( Page ) );
+    
+    // ending the exposure keeps writes not yet synced
+    Pointer[ Address ].AsInteger = 3;
+    RAM.EndExposure();
+    CHECK( RAM.IsPageWritten( Page ) );
+    
+    RAM.ClearWrittenPages();
+    CHECK( !RAM.IsPageWritten( Page ) );
+}
+
+
+// =============================================================================
+//      TESTS FOR INCREMENTAL STATES
+// =============================================================================
+
+
+// incremental states of a few pages fit in this
+const size_t SmallCapacity = 128 * 1024;
+
+// -----------------------------------------------------------------------------
+
+static void WriteRAMPages( V32Console& Console, int32_t FirstPage, int32_t Pages, int32_t Value )
+{
+    V32Word Word;
+    Word.AsInteger = Value;
+    
+    for( int32_t Page = FirstPage; Page < FirstPage + Pages; Page++ )
+      Console.RAM.WriteAddress( Page << RAMPageSizeBits, Word );
+}
+
+// -----------------------------------------------------------------------------
+
+static bool HasRAM( V32Console& Console, const vector< V32Word >& Contents )
+{
+    return !memcmp( &Console.RAM.Memory[ 0 ], &Contents[ 0 ], Constants::RAMSize * sizeof(V32Word) );
+}
+
+// -----------------------------------------------------------------------------
+
+static vector< uint8_t > SaveIncrementalState( IncrementalStateBases& Bases, V32Console& Console, size_t Capacity )
+{
+    vector< uint8_t > State( Capacity );
+    CHECK( Bases.SaveState( Console, &State[ 0 ], State.size() ) );
+    return State;
+}
+
+// -----------------------------------------------------------------------------
+
+// only pages changed since the base are saved, but
+// loading must always give back the whole RAM
+static void TestIncrementalStates()
+{
+    unique_ptr< V32Console > Console = StartConsole();
+    IncrementalStateBases Bases;
+    
+    // too many pages to fit in a small state
+    WriteRAMPages( *Console, 0x200, 300, 1 );
+    vector< uint8_t > StateA = SaveIncrementalState( Bases, *Console, SmallCapacity );
+    vector< V32Word > RAMA = Console->RAM.Memory;
+    
+    WriteRAMPages( *Console, 0x200, 2, 2 );
+    vector< uint8_t > StateB = SaveIncrementalState( Bases, *Console, SmallCapacity );
+    vector< V32Word > RAMB = Console->RAM.Memory;
+    uint64_t CPUDigestB = Console->GetFrameDigest().CPU;
+    
+    Console->RunNextFrame( false );
+    WriteRAMPages( *Console, 0x100, 3, 3 );
+    
+    CHECK( Bases.LoadState( *Console, &StateA[ 0 ], StateA.size() ) );
+    CHECK( HasRAM( *Console, RAMA ) );
+    
+    CHECK( Bases.LoadState( *Console, &StateB[ 0 ], StateB.size() ) );
+    CHECK( HasRAM( *Console, RAMB ) );
+    CHECK( Console->GetFrameDigest().CPU == CPUDigestB );
+    
+    // they are not compact states
+    CHECK( !LoadCompactState( *Console, &StateB[ 0 ], StateB.size(), nullptr ) );
+}
+
+// -----------------------------------------------------------------------------
+
+// other kinds of states replace RAM without the bus
+static void TestIncrementalStatesAfterCompactState()
+{
+    unique_ptr< V32Console > Console = StartConsole();
+    IncrementalStateBases Bases;
+    
+    WriteRAMPages( *Console, 0x200, 4, 1 );
+    vector< uint8_t > IncrementalState = SaveIncrementalState( Bases, *Console, SmallCapacity );
+    vector< V32Word > IncrementalRAM = Console->RAM.Memory;
+    
+    WriteRAMPages( *Console, 0x300, 4, 2 );
+    vector< uint8_t > CompactState = SaveState( *Console );
+    vector< V32Word > CompactRAM = Console->RAM.Memory;
+    
+    CHECK( Bases.LoadState( *Console, &IncrementalState[ 0 ], IncrementalState.size() ) );
+    CHECK( LoadCompactState( *Console, &CompactState[ 0 ], CompactState.size(), nullptr ) );
+    CHECK( HasRAM( *Console, CompactRAM ) );
+    
+    CHECK( Bases.LoadState( *Console, &IncrementalState[ 0 ], IncrementalState.size() ) );
+    CHECK( HasRAM( *Console, IncrementalRAM ) );
+}
+
+// -----------------------------------------------------------------------------
+
+// states from the previous base can still be loaded,
+// but not once that base has been replaced too
+static void TestIncrementalStatesWithNewBases()
+{
+    unique_ptr< V32Console > Console = StartConsole();
+    IncrementalStateBases Bases;
+    const size_t LargeCapacity = 4 * 1024 * 1024;
+    const int32_t ChangedPages = IncrementalStateBases::RebasePages + 1;
+    
+    vector< uint8_t > FirstState = SaveIncrementalState( Bases, *Console, SmallCapacity );
+    vector< V32Word > FirstRAM = Console->RAM.Memory;
+    
+    // each new base starts with no changed pages
+    for( int i = 1; i <= 2; i++ )
+    {
+        WriteRAMPages( *Console, 0x200, ChangedPages, i );
+        
+        for( uint32_t Save = 0; Save < IncrementalStateBases::MinimumSavesPerBase; Save++ )
+          SaveIncrementalState( Bases, *Console, LargeCapacity );
+        
+        vector< uint8_t > NewBaseState = SaveIncrementalState( Bases, *Console, SmallCapacity );
+        CHECK( Bases.LoadState( *Console, &NewBaseState[ 0 ], NewBaseState.size() ) );
+        
+        bool FirstStateLoaded = Bases.LoadState( *Console, &FirstState[ 0 ], FirstState.size() );
+        CHECK( FirstStateLoaded == (i == 1) );
+        
+        if( FirstStateLoaded )
+          CHECK( HasRAM( *Console, FirstRAM ) );
+    }
+}
+
+
+// =============================================================================
+//      MAIN FUNCTION
+// =============================================================================
+
+
+const UnitTest SavestateTests[] =
+{
+    { "CompactStateWithExposedRAM",  TestCompactStateWithExposedRAM         },
+    { "DigestWithExposedRAM",        TestDigestWithExposedRAM               },
+    { "WrittenPagesWithExposedRAM",  TestWrittenPagesWithExposedRAM         },
+    { "IncrementalStates",           TestIncrementalStates                  },
+    { "IncrementalAfterCompact",     TestIncrementalStatesAfterCompactState },
+    { "IncrementalWithNewBases",     TestIncrementalStatesWithNewBases      }
+};
+
+// -----------------------------------------------------------------------------
+
+int main( int NumberOfArguments, char* Arguments[] )
+{
+    return RunUnitTests( SavestateTests, NumberOfArguments, Arguments );
+}
@@ -0,0 +1,100 @@
+// *****************************************************************************
+    // start include guard
+    #ifndef UNITTESTS_HPP
+    #define UNITTESTS_HPP
+    
+    // include C/C++ headers
+    #include <cstdio>           // [ ANSI C ] Standard I/O
+    #include <cstring>          // [ ANSI C ] Strings
+    #include <exception>        // [ C++ STL ] Exceptions
+// *****************************************************************************
+
+
+// =============================================================================
+//      CHECKS WITHIN TESTS
+// =============================================================================
+
+
+// each test program is a single source file
+// that includes this header only once
+static int FailedChecks = 0;
+
+// -----------------------------------------------------------------------------
+
+// a failed check is reported but does not stop the
+// test, so that one run shows all failures in it
+#define CHECK( Condition )                                                            \
+    do                                                                                \
+    {                                                                                 \
+        if( !(Condition) )                                                            \
+        {                                                                             \
+            printf( "  %s:%d: check failed: %s\n", __FILE__, __LINE__, #Condition );  \
+            FailedChecks++;                                                           \
+        }                                                                             \
+    }                                                                                 \
+    while( false )
+
+
+// =============================================================================
+//      RUNNING TESTS
+// =============================================================================
+
+
+typedef struct
+{
+    const char* Name;
+    void (*Run)();
+}
+UnitTest;
+
+// -----------------------------------------------------------------------------
+
+// runs the tests given by name in the command line, or all of
+// them when no names are given; the result is meant to be
+// returned from main, so that CTest sees failed tests
+template< int NumberOfTests >
+int RunUnitTests( const UnitTest (&Tests)[ NumberOfTests ], int NumberOfArguments, char* Arguments[] )
+{
+    int FailedTests = 0;
+    
+    for( const UnitTest& Test: Tests )
+    {
+        // when names are given, run only those
+        bool Selected = (NumberOfArguments <= 1);
+        
+        for( int i = 1; i < NumberOfArguments; i++ )
+          if( !strcmp( Arguments[ i ], Test.Name ) )
+            Selected = true;
+        
+        if( !Selected )
+          continue;
+        
+        // unexpected exceptions also count as failures
+        int PreviousFailedChecks = FailedChecks;
+        
+        try
+        {
+            Test.Run();
+        }
+        
+        catch( std::exception& e )
+        {
+            printf( "  exception: %s\n", e.what() );
+            FailedChecks++;
+        }
+        
+        bool Passed = (FailedChecks == PreviousFailedChecks);
+        printf( "%-40s %s\n", Test.Name, Passed? "ok" : "FAILED" );
+        
+        if( !Passed )
+          FailedTests++;
+    }
+    
+    return (FailedTests > 0)? 1 : 0;
+}
+
+
+// *****************************************************************************
+    // end include guard
+    #endif
+// *****************************************************************************
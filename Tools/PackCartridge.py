@@ -0,0 +1,221 @@
+#!/usr/bin/env python3
+# -----------------------------------------------------------------------------
+#   Packs a regular Vircon32 cartridge (.v32) into the compressed cartridge
+#   format (.v32z). Every embedded file becomes a separate chunk, stored as
+#   an LZ4 block when that makes it smaller, or as is otherwise. The python
+#   "lz4" module is used when installed; if not, a slower built-in LZ4
+#   compressor gives compatible (if somewhat larger) results.
+#   Usage: python3 PackCartridge.py [--raw] <input.v32> [output.v32z]
+# -----------------------------------------------------------------------------
+
+import os
+import struct
+import sys
+
+try:
+    import lz4.block
+except ImportError:
+    lz4 = None
+
+CARTRIDGE_SIGNATURE = b"V32-CART"
+COMPRESSED_SIGNATURE = b"V32-CARZ"
+BINARY_SIGNATURE = b"V32-VBIN"
+TEXTURE_SIGNATURE = b"V32-VTEX"
+SOUND_SIGNATURE = b"V32-VSND"
+
+HEADER_SIZE = 128
+CHUNK_LOCATION_SIZE = 16
+
+CODEC_RAW = 0
+CODEC_LZ4 = 1
+
+# -----------------------------------------------------------------------------
+
+class PackError(Exception):
+    pass
+
+# -----------------------------------------------------------------------------
+
+# greedy compressor for the LZ4 block format; like the reference one
+# it leaves the last 5 bytes as literals and starts no match in the
+# last 12 bytes, so any standard LZ4 decoder accepts its output
+def lz4_compress_block(data):
+    output = bytearray()
+    length = len(data)
+    position = 0
+    anchor = 0
+    last_positions = {}
+
+    def write_length_extension(remaining):
+        while remaining >= 255:
+            output.append(255)
+            remaining -= 255
+        output.append(remaining)
+
+    def write_sequence(literals_end, match_length, offset):
+        literals_length = literals_end - anchor
+        match_code = min(match_length - 4, 15) if match_length else 0
+        output.append((min(literals_length, 15) << 4) | match_code)
+
+        if literals_length >= 15:
+            write_length_extension(literals_length - 15)
+
+        output.extend(data[anchor:literals_end])
+
+        if match_length:
+            output.extend(struct.pack("<H", offset))
+
+            if match_length - 4 >= 15:
+                write_length_extension(match_length - 4 - 15)
+
+    while position + 12 < length:
+        key = data[position:position + 4]
+        candidate = last_positions.get(key)
+        last_positions[key] = position
+
+        if candidate is None or position - candidate > 65535:
+            position += 1
+            continue
+
+        match_length = 4
+        while position + match_length < length - 5 and data[candidate + match_length] == data[position + match_length]:
+            match_length += 1
+
+        write_sequence(position, match_length, position - candidate)
+        position += match_length
+        anchor = position
+
+    write_sequence(length, 0, 0)
+    return bytes(output)
+
+# -----------------------------------------------------------------------------
+
+def compress_block(data):
+    if lz4 is not None:
+        return lz4.block.compress(data, store_size=False)
+    return lz4_compress_block(data)
+
+# -----------------------------------------------------------------------------
+
+def read_section(cartridge, offset, length, description):
+    if offset + length > len(cartridge):
+        raise PackError(description + " is out of file limits")
+    return cartridge[offset:offset + length]
+
+# -----------------------------------------------------------------------------
+
+# splits a section into its embedded files, as (header, data) pairs
+def split_embedded_files(section, count, signature, header_format, bytes_per_unit, description):
+    files = []
+    position = 0
+    header_size = 8 + struct.calcsize(header_format)
+
+    for i in range(count):
+        if position + header_size > len(section):
+            raise PackError(description + " " + str(i) + " is out of section limits")
+
+        header = section[position:position + header_size]
+
+        if header[:8] != signature:
+            raise PackError(description + " " + str(i) + " does not have a valid signature")
+
+        units = 1
+        for value in struct.unpack("<" + header_format, header[8:]):
+            units *= value
+
+        data_size = units * bytes_per_unit
+        position += header_size
+
+        if position + data_size > len(section):
+            raise PackError(description + " " + str(i) + " is out of section limits")
+
+        files.append((header, section[position:position + data_size]))
+        position += data_size
+
+    return files
+
+# -----------------------------------------------------------------------------
+
+def pack_cartridge(cartridge, use_compression):
+    if len(cartridge) < HEADER_SIZE or cartridge[:8] != CARTRIDGE_SIGNATURE:
+        raise PackError("input is not a Vircon32 cartridge")
+
+    # both formats share the header up to the ROM locations
+    common_header = cartridge[:96]
+    number_of_textures, number_of_sounds = struct.unpack("<II", cartridge[88:96])
+    locations = struct.unpack("<6I", cartridge[96:120])
+
+    program = read_section(cartridge, locations[0], locations[1], "program ROM")
+    video = read_section(cartridge, locations[2], locations[3], "video ROM")
+    audio = read_section(cartridge, locations[4], locations[5], "audio ROM")
+
+    # chunks are in order: program, textures, sounds
+    files = []
+    files += split_embedded_files(program, 1, BINARY_SIGNATURE, "I", 4, "program binary")
+    files += split_embedded_files(video, number_of_textures, TEXTURE_SIGNATURE, "II", 4, "texture")
+    files += split_embedded_files(audio, number_of_sounds, SOUND_SIGNATURE, "I", 4, "sound")
+
+    table_size = len(files) * CHUNK_LOCATION_SIZE
+    chunks_start = HEADER_SIZE + table_size
+    table = bytearray()
+    chunks = bytearray()
+
+    for header, data in files:
+        stored = data
+        codec = CODEC_RAW
+
+        if use_compression and data:
+            compressed = compress_block(data)
+
+            if len(compressed) < len(data):
+                stored = compressed
+                codec = CODEC_LZ4
+
+        table += struct.pack("<4I", chunks_start + len(chunks), len(header) + len(stored), codec, len(data))
+        chunks += header + stored
+
+    # file size must be a multiple of 4
+    while len(chunks) % 4:
+        chunks.append(0)
+
+    header = COMPRESSED_SIGNATURE + common_header[8:]
+    header += struct.pack("<II", HEADER_SIZE, table_size)
+    header += bytes(HEADER_SIZE - len(header))
+    return header + bytes(table) + bytes(chunks)
+
+# -----------------------------------------------------------------------------
+
+def main():
+    arguments = sys.argv[1:]
+    use_compression = True
+
+    if arguments and arguments[0] == "--raw":
+        use_compression = False
+        arguments = arguments[1:]
+
+    if len(arguments) not in (1, 2):
+        print("USAGE: PackCartridge.py [--raw] <input.v32> [output.v32z]")
+        print("  --raw   Store all chunks without compression")
+        return 1
+
+    input_path = arguments[0]
+    output_path = arguments[1] if len(arguments) == 2 else os.path.splitext(input_path)[0] + ".v32z"
+
+    try:
+        with open(input_path, "rb") as input_file:
+            cartridge = input_file.read()
+
+        packed = pack_cartridge(cartridge, use_compression)
+
+        with open(output_path, "wb") as output_file:
+            output_file.write(packed)
+
+    except (OSError, PackError) as error:
+        print("FAILED: " + str(error))
+        return 1
+
+    print("Packed %d bytes into %d bytes (%.1f%%)" % (len(cartridge), len(packed), 100.0 * len(packed) / max(1, len(cartridge))))
+    return 0
+
+if __name__ == "__main__":
+    sys.exit(main())
@@ -2,13 +2,18 @@
     // include common Vircon headers
     #include "VirconDefinitions/Constants.hpp"
     
+    // include console logic headers
+    #include "ConsoleLogic/V32Tracing.hpp"
+    
     // include emulator headers
     #include "VideoOutput.hpp"
     #include "Globals.hpp"
     #include "Logging.hpp"
     
     // include C/C++ headers
+    #include <cstdio>           // [ ANSI C ] Standard I/O
     #include <cstring>          // [ ANSI C ] Strings
+    #include <algorithm>        // [ C++ STL ] Algorithms
     
     // declare used namespaces
     using namespace std;
@@ -94,6 +99,39 @@ void LogOpenGLResult( const string& EntryText )
       THROW( "An OpenGL error happened" );
 }
 
+// -----------------------------------------------------------------------------
+
+// sync objects are core in OpenGL ES 3.0 and OpenGL 3.2;
+// in OpenGL 3.0 and 3.1 they need the ARB_sync extension
+bool OpenGLSupportsFences()
+{
+    #if defined(HAVE_OPENGLES3)
+      return true;
+    #elif defined(EMUELEC) || defined(HAVE_OPENGLES2)
+      return false;
+    #else
+      GLint MajorVersion = 0, MinorVersion = 0;
+      glGetIntegerv( GL_MAJOR_VERSION, &MajorVersion );
+      glGetIntegerv( GL_MINOR_VERSION, &MinorVersion );
+      
+      if( MajorVersion > 3 || (MajorVersion == 3 && MinorVersion >= 2) )
+        return true;
+      
+      GLint NumberOfExtensions = 0;
+      glGetIntegerv( GL_NUM_EXTENSIONS, &NumberOfExtensions );
+      
+      for( GLint i = 0; i < NumberOfExtensions; i++ )
+      {
+          const char* Extension = (const char*)glGetStringi( GL_EXTENSIONS, i );
+          
+          if( Extension && !strcmp( Extension, "GL_ARB_sync" ) )
+            return true;
+      }
+      
+      return false;
+    #endif
+}
+
 
 // =============================================================================
 //      GLSL CODE FOR SHADERS
@@ -148,6 +186,8 @@ VideoOutput::VideoOutput()
     // default values
     SelectedTexture = -1;
     QueuedQuads = 0;
+    RenderStateIsDirty = false;
+    ResetStatistics();
     
     // all texture IDs are initially 0
     BiosTextureID = 0;
@@ -161,8 +201,17 @@ VideoOutput::VideoOutput()
     VBOVertexInfo = 0;
     VBOIndices = 0;
     ShaderProgramID = 0;
+    ScreenTextureID = 0;
     IsInitialized = false;
     
+    // no screen snapshots exist yet
+    #if !defined(EMUELEC) && !defined(HAVE_OPENGLES2)
+      ScreenPBOs[ 0 ] = ScreenPBOs[ 1 ] = 0;
+      ScreenFences[ 0 ] = ScreenFences[ 1 ] = 0;
+      LatestScreenPBO = -1;
+      SupportsFences = false;
+    #endif
+    
     // initialize vertex indices; they are organized
     // assuming each quad will be given as 4 vertices,
     // as in a GL_TRIANGLE_STRIP
@@ -302,6 +351,12 @@ void VideoOutput::InitRendering()
     LOG( string("Renderer: ") + (char*)glGetString( GL_RENDERER ) );
     LOG( string("GLSL version: ") + (char*)glGetString( GL_SHADING_LANGUAGE_VERSION ) );
     
+    // screen readbacks for savestates use fences when possible
+    #if !defined(EMUELEC) && !defined(HAVE_OPENGLES2)
+      SupportsFences = OpenGLSupportsFences();
+      LOG( string("Sync objects: ") + (SupportsFences? "supported" : "not supported") );
+    #endif
+    
     // compile our shader program
     LOG( "Compiling GLSL shader program" );
     ClearOpenGLErrors();
@@ -462,6 +517,7 @@ void VideoOutput::Destroy()
     // release all textures
     LOG( "Releasing all textures" );
     ReleaseTexture( WhiteTextureID );
+    ReleaseTexture( ScreenTextureID );
     
     for( int i = -1; i < Constants::GPUMaximumCartridgeTextures; i++ )
       UnloadTexture( i );
@@ -480,6 +536,18 @@ void VideoOutput::Destroy()
     #endif
     VAO = 0;
     
+    // delete screen readback objects
+    #if !defined(EMUELEC) && !defined(HAVE_OPENGLES2)
+      for( int i = 0; i < 2; i++ )
+        if( ScreenFences[ i ] )
+          glDeleteSync( ScreenFences[ i ] );
+      
+      glDeleteBuffers( 2, ScreenPBOs );
+      ScreenPBOs[ 0 ] = ScreenPBOs[ 1 ] = 0;
+      ScreenFences[ 0 ] = ScreenFences[ 1 ] = 0;
+      LatestScreenPBO = -1;
+    #endif
+    
     // delete our shader program
     LOG( "Deleting shader program" );
     glDeleteProgram( ShaderProgramID );
@@ -507,12 +575,12 @@ void VideoOutput::RenderToFramebuffer()
 
 void VideoOutput::BeginFrame()
 {
+    Statistics.Frames++;
+    
     glUseProgram( ShaderProgramID );
     RenderToFramebuffer();
     glEnable( GL_BLEND );
-    SelectTexture( SelectedTexture );
-    SetBlendingMode( BlendingMode );
-    SetMultiplyColor( MultiplyColor );
+    ApplyRenderState();
     
     // tell the GPU which of its texture processors to use
     glUniform1i( TextureUnitLocation, 0 );  // texture unit 0 is for decal textures
@@ -543,6 +611,44 @@ void VideoOutput::BeginFrame()
         QUAD_QUEUE_SIZE * 6 * sizeof( GLushort ),
         VertexIndices
     );
+    
+    Statistics.BytesUploaded += QUAD_QUEUE_SIZE * 6 * sizeof( GLushort );
+    
+    // a screen restored from a savestate is drawn
+    // first, so that the frame is drawn on top of it
+    if( !PendingScreen.empty() )
+      DrawPendingScreen();
+}
+
+
+// =============================================================================
+//      VIDEO OUTPUT: RENDER STATE HANDLING
+// =============================================================================
+
+
+// used when loading states: only the values are stored
+// and no OpenGL calls are made, so that states can be
+// loaded many times without stalling the GPU pipeline
+void VideoOutput::SetRenderStateLazily( int GPUTextureID, GPUColor NewMultiplyColor, IOPortValues NewBlendingMode )
+{
+    // queued quads still need the previous state
+    if( QueuedQuads > 0 )
+      RenderQuadQueue();
+    
+    SelectedTexture = GPUTextureID;
+    MultiplyColor = NewMultiplyColor;
+    BlendingMode = NewBlendingMode;
+    RenderStateIsDirty = true;
+}
+
+// -----------------------------------------------------------------------------
+
+void VideoOutput::ApplyRenderState()
+{
+    SelectTexture( SelectedTexture );
+    SetBlendingMode( BlendingMode );
+    SetMultiplyColor( MultiplyColor );
+    RenderStateIsDirty = false;
 }
 
 
@@ -555,7 +661,7 @@ void VideoOutput::SetMultiplyColor( GPUColor NewMultiplyColor )
 {
     // we must render any pending quads before
     // applying any new render configurations
-    RenderQuadQueue();
+    RenderQuadQueue( QuadGroupBreaks::MultiplyColor );
     
     MultiplyColor = NewMultiplyColor;
     
@@ -583,7 +689,7 @@ void VideoOutput::SetBlendingMode( IOPortValues NewBlendingMode )
 {
     // we must render any pending quads before
     // applying any new render configurations
-    RenderQuadQueue();
+    RenderQuadQueue( QuadGroupBreaks::BlendingMode );
     
     switch( NewBlendingMode )
     {
@@ -625,6 +731,10 @@ IOPortValues VideoOutput::GetBlendingMode()
 
 void VideoOutput::AddQuadToQueue( const GPUQuad& Quad )
 {
+    // usually the state was already applied at frame start
+    if( RenderStateIsDirty )
+      ApplyRenderState();
+    
     // copy information from the received GPU quad
     const int SizePerQuad = 16 * sizeof( float );
     memcpy( &QuadVerticesInfo[ QueuedQuads * 16 ], &Quad.Vertices, SizePerQuad );
@@ -634,14 +744,16 @@ void VideoOutput::AddQuadToQueue( const GPUQuad& Quad )
     
     // force queue draw if it becomes full
     if( QueuedQuads >= QUAD_QUEUE_SIZE )
-      RenderQuadQueue();
+      RenderQuadQueue( QuadGroupBreaks::QueueFull );
 }
 
 // -----------------------------------------------------------------------------
 
-void VideoOutput::RenderQuadQueue()
+void VideoOutput::RenderQuadQueue( QuadGroupBreaks Cause )
 {
     if( QueuedQuads == 0 ) return;
+    TRACE_SCOPE( "VideoOutput::RenderQuadQueue" );
+    PERF_SCOPE( QuadFlush );
     
     // send attributes (i.e. shader input variables)
     glBindBuffer( GL_ARRAY_BUFFER, VBOVertexInfo );
@@ -668,7 +780,11 @@ void VideoOutput::RenderQuadQueue()
         (void*)0              // starts at offset 0
     );
     
-    // reset the queue
+    // update statistics and reset the queue
+    Statistics.Quads += QueuedQuads;
+    Statistics.DrawCalls++;
+    Statistics.BytesUploaded += sizeof( QuadVerticesInfo );
+    Statistics.GroupBreaks[ (int)Cause ]++;
     QueuedQuads = 0;
 }
 
@@ -676,6 +792,14 @@ void VideoOutput::RenderQuadQueue()
 
 void VideoOutput::ClearScreen( GPUColor ClearColor )
 {
+    // usually the state was already applied at frame start
+    if( RenderStateIsDirty )
+      ApplyRenderState();
+    
+    // render pending quads here so that the
+    // group break is attributed to clearing
+    RenderQuadQueue( QuadGroupBreaks::ClearScreen );
+    
     // temporarily replace multiply color with clear color
     GPUColor PreviousMultiplyColor = MultiplyColor;
     SetMultiplyColor( ClearColor );
@@ -698,7 +822,7 @@ void VideoOutput::ClearScreen( GPUColor ClearColor )
     // draw this quad separately, since we are
     // using different render configurations
     AddQuadToQueue( ScreenQuad );
-    RenderQuadQueue();
+    RenderQuadQueue( QuadGroupBreaks::ClearScreen );
     
     // restore previous multiply color and texture
     SetMultiplyColor( PreviousMultiplyColor );
@@ -711,27 +835,35 @@ void VideoOutput::ClearScreen( GPUColor ClearColor )
 // =============================================================================
 
 
-void VideoOutput::LoadTexture( int GPUTextureID, void* Pixels )
+void VideoOutput::LoadTexture( int GPUTextureID, int Width, int Height, void* Pixels )
 {
     LOG( "Loading texture with ID = " + to_string(GPUTextureID) );
     
+    // textures can be loaded while a frame is being drawn,
+    // so render any pending quads before changing bindings
+    RenderQuadQueue();
+    
     GLuint* OpenGLTextureID = &BiosTextureID;
     
     if( GPUTextureID >= 0 )
       OpenGLTextureID = &CartridgeTextureIDs[ GPUTextureID ];
     
+    // discard any previous texture with this ID
+    ReleaseTexture( *OpenGLTextureID );
+    
     // create a new OpenGL texture and select it
     glGenTextures( 1, OpenGLTextureID );
     glBindTexture( GL_TEXTURE_2D, *OpenGLTextureID );
     
     // check correct texture ID
-    if( !OpenGLTextureID )
+    if( !*OpenGLTextureID )
       THROW( "OpenGL failed to generate a new texture" );
     
     // clear OpenGL errors
     glGetError();
     
-    // create an OpenGL texture from the received pixel data
+    // allocate a full size OpenGL texture, but
+    // without sending any pixel data for now
     glTexImage2D
     (
         GL_TEXTURE_2D,              // texture is a 2D rectangle
@@ -742,13 +874,48 @@ void VideoOutput::LoadTexture( int GPUTextureID, void* Pixels )
         0,                          // border width (must be 0 or 1)
         GL_RGBA,                    // color components in the source
         GL_UNSIGNED_BYTE,           // each color component is a byte
-        Pixels                      // buffer storing the texture data
+        nullptr                     // no source data
+    );
+    
+    // pixels outside of the loaded image must be transparent;
+    // instead of sending a full size buffer from the CPU, clear
+    // the texture in the GPU by temporarily rendering to it
+    if( Width < Constants::GPUTextureSize || Height < Constants::GPUTextureSize )
+    {
+        GLint PreviousFramebuffer = 0;
+        glGetIntegerv( GL_FRAMEBUFFER_BINDING, &PreviousFramebuffer );
+        
+        GLuint ClearFramebuffer = 0;
+        glGenFramebuffers( 1, &ClearFramebuffer );
+        glBindFramebuffer( RARCH_GL_FRAMEBUFFER, ClearFramebuffer );
+        glFramebufferTexture2D( RARCH_GL_FRAMEBUFFER, RARCH_GL_COLOR_ATTACHMENT0, GL_TEXTURE_2D, *OpenGLTextureID, 0 );
+        
+        glClearColor( 0, 0, 0, 0 );
+        glClear( GL_COLOR_BUFFER_BIT );
+        
+        glBindFramebuffer( RARCH_GL_FRAMEBUFFER, PreviousFramebuffer );
+        glDeleteFramebuffers( 1, &ClearFramebuffer );
+    }
+    
+    // now send only the area covered by the image
+    glTexSubImage2D
+    (
+        GL_TEXTURE_2D,              // texture is a 2D rectangle
+        0,                          // level of detail (0 = normal size)
+        0, 0,                       // offset within the texture
+        Width,                      // image width in pixels
+        Height,                     // image height in pixels
+        GL_RGBA,                    // color components in the source
+        GL_UNSIGNED_BYTE,           // each color component is a byte
+        Pixels                      // buffer storing the image data
     );
     
     // check correct conversion
     if( glGetError() != GL_NO_ERROR )
       THROW( "Could not create an OpenGL texture from pixel data" );
     
+    Statistics.BytesUploaded += Width * Height * 4;
+    
     // textures must be scaled using only nearest neighbour
     glTexParameterf( GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_NEAREST );         
     glTexParameterf( GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_NEAREST );
@@ -756,6 +923,9 @@ void VideoOutput::LoadTexture( int GPUTextureID, void* Pixels )
     // out-of-texture coordinates must clamp, not wrap
     glTexParameterf( GL_TEXTURE_2D, GL_TEXTURE_WRAP_S, GL_CLAMP_TO_EDGE );
     glTexParameterf( GL_TEXTURE_2D, GL_TEXTURE_WRAP_T, GL_CLAMP_TO_EDGE );
+    
+    // restore the binding for the currently selected texture
+    glBindTexture( GL_TEXTURE_2D, SelectedTexture >= 0? CartridgeTextureIDs[ SelectedTexture ] : BiosTextureID );
 }
 
 // -----------------------------------------------------------------------------
@@ -774,7 +944,7 @@ void VideoOutput::SelectTexture( int GPUTextureID )
 {
     // we must render any pending quads before
     // applying any new render configurations
-    RenderQuadQueue();
+    RenderQuadQueue( QuadGroupBreaks::Texture );
     
     SelectedTexture = GPUTextureID;
     GLuint* OpenGLTextureID = &BiosTextureID;
@@ -792,3 +962,222 @@ int32_t VideoOutput::GetSelectedTexture()
 {
     return SelectedTexture;
 }
+
+
+// =============================================================================
+//      VIDEO OUTPUT: SCREEN SNAPSHOTS
+// =============================================================================
+
+
+// called at the end of each drawn frame; the screen is
+// copied to a pixel buffer within the GPU, and will only
+// be read by the CPU if a savestate is actually saved
+void VideoOutput::StartScreenReadback()
+{
+    #if !defined(EMUELEC) && !defined(HAVE_OPENGLES2)
+      if( !IsInitialized )
+        return;
+      
+      // create both pixel buffers on first use
+      if( !ScreenPBOs[ 0 ] )
+      {
+          glGenBuffers( 2, ScreenPBOs );
+          
+          for( int i = 0; i < 2; i++ )
+          {
+              glBindBuffer( GL_PIXEL_PACK_BUFFER, ScreenPBOs[ i ] );
+              glBufferData( GL_PIXEL_PACK_BUFFER, SCREEN_SNAPSHOT_SIZE, nullptr, GL_STREAM_READ );
+          }
+      }
+      
+      // use the buffer not holding the latest screen;
+      // its previous readback is no longer needed
+      int NextScreenPBO = (LatestScreenPBO == 0)? 1 : 0;
+      
+      if( ScreenFences[ NextScreenPBO ] )
+        glDeleteSync( ScreenFences[ NextScreenPBO ] );
+      
+      ScreenFences[ NextScreenPBO ] = 0;
+      
+      // with a pack buffer bound, this call returns
+      // immediately and the copy is done by the GPU
+      glBindBuffer( GL_PIXEL_PACK_BUFFER, ScreenPBOs[ NextScreenPBO ] );
+      glReadPixels( 0, 0, Constants::ScreenWidth, Constants::ScreenHeight, GL_RGBA, GL_UNSIGNED_BYTE, (void*)0 );
+      glBindBuffer( GL_PIXEL_PACK_BUFFER, 0 );
+      
+      if( SupportsFences )
+        ScreenFences[ NextScreenPBO ] = glFenceSync( GL_SYNC_GPU_COMMANDS_COMPLETE, 0 );
+      
+      LatestScreenPBO = NextScreenPBO;
+    #endif
+}
+
+// -----------------------------------------------------------------------------
+
+// returns false if no screen readback is available
+bool VideoOutput::ReadScreen( void* Pixels )
+{
+    #if !defined(EMUELEC) && !defined(HAVE_OPENGLES2)
+      if( !IsInitialized || LatestScreenPBO < 0 )
+        return false;
+      
+      // the readback was started at the end of the
+      // last frame, so it has normally finished by now;
+      // without a fence, mapping the buffer waits for it
+      GLsync Fence = ScreenFences[ LatestScreenPBO ];
+      
+      if( Fence )
+      {
+          GLenum WaitResult = glClientWaitSync( Fence, GL_SYNC_FLUSH_COMMANDS_BIT, 100000000 );
+          
+          if( WaitResult != GL_ALREADY_SIGNALED && WaitResult != GL_CONDITION_SATISFIED )
+          {
+              LOG( "ERROR: Timed out waiting for screen readback" );
+              return false;
+          }
+      }
+      
+      glBindBuffer( GL_PIXEL_PACK_BUFFER, ScreenPBOs[ LatestScreenPBO ] );
+      void* MappedPixels = glMapBufferRange( GL_PIXEL_PACK_BUFFER, 0, SCREEN_SNAPSHOT_SIZE, GL_MAP_READ_BIT );
+      
+      if( MappedPixels )
+      {
+          memcpy( Pixels, MappedPixels, SCREEN_SNAPSHOT_SIZE );
+          glUnmapBuffer( GL_PIXEL_PACK_BUFFER );
+      }
+      
+      glBindBuffer( GL_PIXEL_PACK_BUFFER, 0 );
+      return (MappedPixels != nullptr);
+    #else
+      return false;
+    #endif
+}
+
+// -----------------------------------------------------------------------------
+
+// used when loading states, so no OpenGL calls are made here;
+// a null pointer discards any previously set pending screen
+void VideoOutput::SetPendingScreen( const void* Pixels )
+{
+    if( !Pixels )
+    {
+        PendingScreen.clear();
+        return;
+    }
+    
+    const uint8_t* PixelBytes = (const uint8_t*)Pixels;
+    PendingScreen.assign( PixelBytes, PixelBytes + SCREEN_SNAPSHOT_SIZE );
+}
+
+// -----------------------------------------------------------------------------
+
+void VideoOutput::DrawPendingScreen()
+{
+    // create the screen texture on first use
+    if( !ScreenTextureID )
+    {
+        glGenTextures( 1, &ScreenTextureID );
+        glBindTexture( GL_TEXTURE_2D, ScreenTextureID );
+        
+        glTexParameteri( GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_NEAREST );
+        glTexParameteri( GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_NEAREST );
+        glTexParameteri( GL_TEXTURE_2D, GL_TEXTURE_WRAP_S, GL_CLAMP_TO_EDGE );
+        glTexParameteri( GL_TEXTURE_2D, GL_TEXTURE_WRAP_T, GL_CLAMP_TO_EDGE );
+    }
+    
+    // send the whole screen in a single upload
+    glBindTexture( GL_TEXTURE_2D, ScreenTextureID );
+    
+    glTexImage2D
+    (
+        GL_TEXTURE_2D,
+        0,
+        GL_RGBA,
+        Constants::ScreenWidth,
+        Constants::ScreenHeight,
+        0,
+        GL_RGBA,
+        GL_UNSIGNED_BYTE,
+        &PendingScreen[ 0 ]
+    );
+    
+    // temporarily replace multiply color with white
+    GPUColor PreviousMultiplyColor = MultiplyColor;
+    SetMultiplyColor( GPUColor{ 255, 255, 255, 255 } );
+    
+    // pixels are stored bottom row first, so
+    // texture coordinates are vertically flipped
+    const GPUQuad ScreenQuad =
+    {
+        {
+            // 4x (vertex position + texture coordinates)
+            { 0, 0, 0, 1 },
+            { Constants::ScreenWidth, 0, 1, 1 },
+            { 0, Constants::ScreenHeight, 0, 0 },
+            { Constants::ScreenWidth, Constants::ScreenHeight, 1, 0 }
+        }
+    };
+    
+    // pixels must be replaced, not blended
+    glDisable( GL_BLEND );
+    AddQuadToQueue( ScreenQuad );
+    RenderQuadQueue();
+    glEnable( GL_BLEND );
+    
+    // restore previous multiply color and texture
+    SetMultiplyColor( PreviousMultiplyColor );
+    SelectTexture( SelectedTexture );
+    
+    PendingScreen.clear();
+}
+
+
+// =============================================================================
+//      VIDEO OUTPUT: RENDER STATISTICS
+// =============================================================================
+
+
+const RenderStatistics& VideoOutput::GetStatistics()
+{
+    return Statistics;
+}
+
+// -----------------------------------------------------------------------------
+
+void VideoOutput::ResetStatistics()
+{
+    memset( &Statistics, 0, sizeof(RenderStatistics) );
+}
+
+// -----------------------------------------------------------------------------
+
+// gives averages per frame since the last reset
+string VideoOutput::GetStatisticsReport()
+{
+    static const char* const CauseNames[] =
+    {
+        "queue full", "multiply color", "blending", "texture", "clear", "other"
+    };
+    
+    double Frames = max( Statistics.Frames, 1u );
+    char Line[ 100 ];
+    
+    snprintf( Line, sizeof(Line), "Render statistics (%u frames): ", Statistics.Frames );
+    string Report = Line;
+    
+    snprintf( Line, sizeof(Line), "%.1f quads, %.1f draw calls, %.1f KB uploaded per frame",
+              Statistics.Quads / Frames, Statistics.DrawCalls / Frames, Statistics.BytesUploaded / Frames / 1024 );
+    Report += Line;
+    
+    // group breaks are given as percentages of draw calls
+    uint64_t DrawCalls = max( Statistics.DrawCalls, (uint64_t)1 );
+    Report += "; group breaks:";
+    
+    for( int i = 0; i < (int)QuadGroupBreaks::Count; i++ )
+    {
+        snprintf( Line, sizeof(Line), " %s %.1f%%", CauseNames[ i ], 100.0 * Statistics.GroupBreaks[ i ] / DrawCalls );
+        Report += Line;
+    }
+    
+    return Report;
+}
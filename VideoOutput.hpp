@@ -10,8 +10,15 @@
     // include console logic headers
     #include "ConsoleLogic/ExternalInterfaces.hpp"
     
+    // include emulator headers
+    #include "Savestates.hpp"
+    
     // include OpenGL headers
     #include "glsym/glsym.h"
+    
+    // include C/C++ headers
+    #include <string>       // [ C++ STL ] Strings
+    #include <vector>       // [ C++ STL ] Vectors
 // *****************************************************************************
 
 
@@ -21,12 +28,44 @@
 #define QUAD_QUEUE_SIZE 20
 
 
+// =============================================================================
+//      RENDER STATISTICS
+// =============================================================================
+
+
+// reasons for a quad group to be rendered
+enum class QuadGroupBreaks
+{
+    QueueFull = 0,
+    MultiplyColor,
+    BlendingMode,
+    Texture,
+    ClearScreen,
+    Other,          // end of frame, texture loads, etc
+    
+    Count
+};
+
+// -----------------------------------------------------------------------------
+
+// counters accumulated since the last reset
+typedef struct
+{
+    uint32_t Frames;
+    uint64_t Quads;
+    uint64_t DrawCalls;
+    uint64_t BytesUploaded;
+    uint64_t GroupBreaks[ (int)QuadGroupBreaks::Count ];
+}
+RenderStatistics;
+
+
 // =============================================================================
 //      2D-SPECIALIZED OPENGL CONTEXT
 // =============================================================================
 
 
-class VideoOutput
+class VideoOutput: public StateScreen
 {
     private:
         
@@ -55,6 +94,29 @@ class VideoOutput
         
         // rendering control for quad groups
         int QueuedQuads;
+        RenderStatistics Statistics;
+        
+        // set when the render state was changed without
+        // applying it, so it must be applied before drawing
+        bool RenderStateIsDirty;
+        
+        // screen readback for savestates; pixel buffers are
+        // alternated so that a new readback never has to wait
+        #if !defined(EMUELEC) && !defined(HAVE_OPENGLES2)
+          GLuint ScreenPBOs[ 2 ];
+          GLsync ScreenFences[ 2 ];
+          int LatestScreenPBO;
+          
+          // without fences (before OpenGL 3.2) the
+          // readback is waited for when reading it
+          bool SupportsFences;
+        #endif
+        
+        // screen restored from a savestate, which
+        // is drawn when the next frame begins
+        std::vector< uint8_t > PendingScreen;
+        GLuint ScreenTextureID;
+        void DrawPendingScreen();
         
         // positions of shader parameters
         GLuint VertexInfoLocation;
@@ -78,6 +140,10 @@ class VideoOutput
         void RenderToFramebuffer();
         void BeginFrame();
         
+        // render state handling
+        void SetRenderStateLazily( int GPUTextureID, V32::GPUColor NewMultiplyColor, V32::IOPortValues NewBlendingMode );
+        void ApplyRenderState();
+        
         // color control functions
         void SetMultiplyColor( V32::GPUColor NewMultiplyColor );
         V32::GPUColor GetMultiplyColor();
@@ -87,13 +153,23 @@ class VideoOutput
         // render functions
         void ClearScreen( V32::GPUColor ClearColor );
         void AddQuadToQueue( const V32::GPUQuad& Quad );
-        void RenderQuadQueue();
+        void RenderQuadQueue( QuadGroupBreaks Cause = QuadGroupBreaks::Other );
         
         // texture handling
-        void LoadTexture( int GPUTextureID, void* Pixels );
+        void LoadTexture( int GPUTextureID, int Width, int Height, void* Pixels );
         void UnloadTexture( int GPUTextureID );
         void SelectTexture( int GPUTextureID );
         int32_t GetSelectedTexture();
+        
+        // screen snapshots
+        void StartScreenReadback();
+        virtual bool ReadScreen( void* Pixels ) override;
+        virtual void SetPendingScreen( const void* Pixels ) override;
+        
+        // render statistics
+        const RenderStatistics& GetStatistics();
+        void ResetStatistics();
+        std::string GetStatisticsReport();
 };
 
 
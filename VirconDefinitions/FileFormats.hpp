@@ -140,6 +140,64 @@ namespace V32
     }
     
     
+    // -----------------------------------------------------------------------------
+    
+    // Optional compressed container for cartridges. Every embedded file
+    // (program binary, textures and sounds) is stored as a separate chunk
+    // so that each one can be located and decompressed independently.
+    namespace CompressedROMFileFormat
+    {
+        // expected file signature
+        const char Signature[] = "V32-CARZ";
+        
+        // ways in which chunk data can be encoded
+        enum class Codecs: uint32_t
+        {
+            Raw = 0,        // data is stored as is
+            LZ4             // data is an LZ4 compressed block
+        };
+        
+        // Each chunk starts with the uncompressed header of its
+        // embedded file, followed by the encoded file contents.
+        // Chunks in the table of contents are given in order:
+        // program binary first, then textures, then sounds.
+        typedef struct
+        {
+            uint32_t StartOffset;       // given in bytes from the start of file
+            uint32_t Length;            // stored bytes, including the embedded file header
+            uint32_t Codec;             // one of the values in Codecs
+            uint32_t DecodedLength;     // bytes of the embedded file contents, once decoded
+        }
+        ChunkLocation;
+        
+        // initial header; must be placed at the beginning of
+        // the file, and be a size of exactly 128 bytes = 0x80;
+        // it has the same layout as a regular ROM header up
+        // to the point where ROM sections are located
+        typedef struct
+        {
+            // Vircon32 metadata
+            char Signature[ 8 ];        // no null termination! (always taken as 8 characters)
+            uint32_t VirconVersion;
+            uint32_t VirconRevision;    
+            
+            // ROM metadata
+            char Title[ 64 ];           // must have null termination (i.e. up to 63 characters)
+            uint32_t ROMVersion;
+            uint32_t ROMRevision;
+            
+            // data on ROM contents
+            uint32_t NumberOfTextures;
+            uint32_t NumberOfSounds;
+            ROMFileFormat::SectionLocation TableOfContentsLocation;
+            
+            // unused extra space
+            int8_t Reserved[ 24 ];      // reserved for possible use in future versions
+        }
+        Header;
+    }
+    
+    
     // =============================================================================
     //      FORMAT FOR MEMORY CARD RAM FILES
     // =============================================================================
@@ -170,6 +228,8 @@ namespace V32
     static_assert( sizeof(TextureFileFormat::Header)  == 16, "Wrong size for texture file header" );
     static_assert( sizeof(SoundFileFormat::Header) == 12, "Wrong size for sound file header" );
     static_assert( sizeof(ROMFileFormat::Header) == 128, "Wrong size for ROM file header" );
+    static_assert( sizeof(CompressedROMFileFormat::ChunkLocation) == 16, "Wrong size for compressed ROM chunk location" );
+    static_assert( sizeof(CompressedROMFileFormat::Header) == 128, "Wrong size for compressed ROM file header" );
     static_assert( sizeof(MemoryCardFileFormat::Header) == 8, "Wrong size for memory card file header" );
 }
 
@@ -13,6 +13,11 @@
     #include "Globals.hpp"
     #include "Logging.hpp"
     #include "Savestates.hpp"
+    #include "Rewind.hpp"
+    #include "RunAhead.hpp"
+    #include "Cheats.hpp"
+    #include "Movies.hpp"
+    #include "ConsoleLogic/V32Tracing.hpp"
     
     // include C/C++ headers
     #include <stdio.h>
@@ -53,6 +58,9 @@ struct retro_input_descriptor controller_descriptor[] =
     { 0, RETRO_DEVICE_JOYPAD, 0, RETRO_DEVICE_ID_JOYPAD_L, "L" },
     { 0, RETRO_DEVICE_JOYPAD, 0, RETRO_DEVICE_ID_JOYPAD_R, "R" },
     
+    // not a Vircon32 control: used to hold in-core rewind
+    { 0, RETRO_DEVICE_JOYPAD, 0, RETRO_DEVICE_ID_JOYPAD_L2, "Rewind" },
+    
     // gamepad when connected to port 2
     { 1, RETRO_DEVICE_JOYPAD, 0, RETRO_DEVICE_ID_JOYPAD_LEFT,  "Left" },
     { 1, RETRO_DEVICE_JOYPAD, 0, RETRO_DEVICE_ID_JOYPAD_UP,    "Up" },
@@ -117,6 +125,25 @@ const struct retro_controller_info controller_ports[] =
     { nullptr, 0 }            // add a null termination to signal end of array
 };
 
+// -----------------------------------------------------------------------------
+
+// libretro buttons for each gamepad control,
+// in the same order as enum GamepadControls
+const unsigned gamepad_control_buttons[] =
+{
+    RETRO_DEVICE_ID_JOYPAD_LEFT,
+    RETRO_DEVICE_ID_JOYPAD_RIGHT,
+    RETRO_DEVICE_ID_JOYPAD_UP,
+    RETRO_DEVICE_ID_JOYPAD_DOWN,
+    RETRO_DEVICE_ID_JOYPAD_START,
+    RETRO_DEVICE_ID_JOYPAD_A,
+    RETRO_DEVICE_ID_JOYPAD_B,
+    RETRO_DEVICE_ID_JOYPAD_X,
+    RETRO_DEVICE_ID_JOYPAD_Y,
+    RETRO_DEVICE_ID_JOYPAD_L,
+    RETRO_DEVICE_ID_JOYPAD_R
+};
+
 
 // =============================================================================
 //      HANDLING FRAMESKIPPING
@@ -169,20 +196,159 @@ void configure_frameskip()
 }
 
 
+// =============================================================================
+//      HANDLING PERFORMANCE COUNTERS
+// =============================================================================
+
+
+// interface given by the frontend, if any
+struct retro_perf_callback perf_cb = {};
+
+// one counter for each measured section; all fields
+// are given so that no initializer is left implicit
+struct retro_perf_counter perf_counters[ (int)V32::PerfSections::Count ] =
+{
+    { "vircon32_cpu_loop", 0, 0, 0, false },
+    { "vircon32_spu_mix", 0, 0, 0, false },
+    { "vircon32_quad_flush", 0, 0, 0, false },
+    { "vircon32_serialize", 0, 0, 0, false },
+    { "vircon32_unserialize", 0, 0, 0, false },
+    { "vircon32_cartridge_load", 0, 0, 0, false }
+};
+
+// -----------------------------------------------------------------------------
+
+// counters are registered when first used,
+// as is usual for libretro performance counters
+static void start_perf_counter( V32::PerfSections Section )
+{
+    struct retro_perf_counter& Counter = perf_counters[ (int)Section ];
+    
+    if( !Counter.registered )
+      perf_cb.perf_register( &Counter );
+    
+    perf_cb.perf_start( &Counter );
+}
+
+// -----------------------------------------------------------------------------
+
+static void stop_perf_counter( V32::PerfSections Section )
+{
+    perf_cb.perf_stop( &perf_counters[ (int)Section ] );
+}
+
+// -----------------------------------------------------------------------------
+
+// console sections are only measured when
+// the frontend provides performance counters
+static void configure_perf_counters()
+{
+    if( !environ_cb( RETRO_ENVIRONMENT_GET_PERF_INTERFACE, &perf_cb ) )
+      perf_cb = {};
+    
+    if( perf_cb.perf_register && perf_cb.perf_start && perf_cb.perf_stop )
+    {
+        V32::PerfCounters::Start = start_perf_counter;
+        V32::PerfCounters::Stop = stop_perf_counter;
+        LOG( "Performance counters enabled" );
+    }
+    
+    else
+    {
+        V32::PerfCounters::Start = nullptr;
+        V32::PerfCounters::Stop = nullptr;
+    }
+}
+
+
 // =============================================================================
 //      HANDLING CORE-SPECIFIC OPTIONS
 // =============================================================================
 
 
+// internal configuration variables
+bool enable_compact_savestates = true;
+bool enable_savestate_screen = true;
+bool enable_incremental_savestates = true;
+size_t rewind_buffer_megabytes = 0;
+unsigned run_ahead_frames = 0;
+int memory_card_save_delay = 0;
+bool use_frontend_save_ram = false;
+bool memory_card_in_save_ram = false;
+bool enable_frame_tracing = false;
+bool enable_render_statistics = false;
+MovieModes requested_movie_mode = MovieModes::Disabled;
+
+// the screen is only copied for savestates once the frontend
+// has asked for one, so that sessions that never save a state
+// don't pay for a screen readback on every frame
+bool savestates_requested = false;
+
+// -----------------------------------------------------------------------------
+
 // configuration variables for this core
 struct retro_variable config_variables[] =
 {
     { "enable_frameskip", "Automatic frame skip; Disabled|Enabled" },
+    { "compact_savestates", "Compact savestates; Enabled|Disabled" },
+    { "savestate_screen", "Include screen in compact savestates; Enabled|Disabled" },
+    { "incremental_savestates", "Incremental savestates for frontend run-ahead; Enabled|Disabled" },
+    { "rewind_buffer", "In-core rewind buffer (hold L2); Disabled|16 MB|64 MB|256 MB" },
+    { "run_ahead_frames", "In-core run-ahead frames; Disabled|1|2|3|4" },
+    { "memory_card_save_delay", "Memory card save delay (frames); 30|0|60|300" },
+    { "memory_card_storage", "Memory card storage (needs restart); Core file|Frontend save RAM" },
+    { "frame_tracing", "Frame phase tracing; Disabled|Enabled" },
+    { "render_statistics", "Log render statistics; Disabled|Enabled" },
+    { "input_movie", "Input movie (resets console); Disabled|Record|Replay" },
     { nullptr, nullptr }
 };
 
 // -----------------------------------------------------------------------------
 
+// traces go to the path in VIRCON32_TRACE if that
+// variable is set, or to the save directory otherwise
+static string get_trace_path()
+{
+    const char* TracePath = getenv( "VIRCON32_TRACE" );
+    
+    if( TracePath && *TracePath )
+      return TracePath;
+    
+    const char *SaveDirectory = nullptr;
+    environ_cb( RETRO_ENVIRONMENT_GET_SAVE_DIRECTORY, &SaveDirectory );
+    
+    if( !SaveDirectory )
+      return "vircon32-trace.json";
+    
+    return string(SaveDirectory) + "/vircon32-trace.json";
+}
+
+// -----------------------------------------------------------------------------
+
+static void set_frame_tracing( bool Enabled )
+{
+    if( Enabled == V32::Tracer.IsEnabled() )
+      return;
+    
+    // keep about the last million events
+    if( Enabled )
+    {
+        V32::Tracer.Enable( 20 );
+        LOG( "Frame phase tracing enabled" );
+        return;
+    }
+    
+    V32::Tracer.Disable();
+    string TracePath = get_trace_path();
+    
+    if( V32::Tracer.ExportJSON( TracePath ) )
+      LOG( "Frame phase trace saved to \"" + TracePath + "\"" );
+    else
+      LOG( "ERROR: Cannot save frame phase trace to \"" + TracePath + "\"" );
+}
+
+// -----------------------------------------------------------------------------
+
 static void update_config_variables()
 {
     // use this to ask frontend for a variable value
@@ -198,6 +364,210 @@ static void update_config_variables()
         
         configure_frameskip();
     }
+    
+    variable_state.key = "compact_savestates";
+    variable_state.value = nullptr;
+    
+    if( environ_cb( RETRO_ENVIRONMENT_GET_VARIABLE, &variable_state ) && variable_state.value )
+    {
+        enable_compact_savestates = !strcmp( variable_state.value, "Enabled" );
+        LOG( string("Compact savestates ") + (enable_compact_savestates? "enabled" : "disabled" ) );
+    }
+    
+    variable_state.key = "savestate_screen";
+    variable_state.value = nullptr;
+    
+    if( environ_cb( RETRO_ENVIRONMENT_GET_VARIABLE, &variable_state ) && variable_state.value )
+    {
+        enable_savestate_screen = !strcmp( variable_state.value, "Enabled" );
+        LOG( string("Screen in savestates ") + (enable_savestate_screen? "enabled" : "disabled" ) );
+    }
+    
+    variable_state.key = "incremental_savestates";
+    variable_state.value = nullptr;
+    
+    if( environ_cb( RETRO_ENVIRONMENT_GET_VARIABLE, &variable_state ) && variable_state.value )
+    {
+        enable_incremental_savestates = !strcmp( variable_state.value, "Enabled" );
+        LOG( string("Incremental savestates ") + (enable_incremental_savestates? "enabled" : "disabled" ) );
+    }
+    
+    variable_state.key = "rewind_buffer";
+    variable_state.value = nullptr;
+    
+    if( environ_cb( RETRO_ENVIRONMENT_GET_VARIABLE, &variable_state ) && variable_state.value )
+    {
+        // "Disabled" is read as 0 MB
+        rewind_buffer_megabytes = atoi( variable_state.value );
+        Rewind.SetMaximumSize( rewind_buffer_megabytes * 1024 * 1024 );
+        
+        if( rewind_buffer_megabytes > 0 )
+          LOG( "In-core rewind buffer enabled: " + to_string( rewind_buffer_megabytes ) + " MB" );
+        else
+          LOG( "In-core rewind buffer disabled" );
+    }
+    
+    variable_state.key = "run_ahead_frames";
+    variable_state.value = nullptr;
+    
+    if( environ_cb( RETRO_ENVIRONMENT_GET_VARIABLE, &variable_state ) && variable_state.value )
+    {
+        // "Disabled" is read as 0 frames
+        run_ahead_frames = atoi( variable_state.value );
+        RunAhead.Invalidate();
+        LOG( "In-core run-ahead frames: " + to_string( run_ahead_frames ) );
+    }
+    
+    variable_state.key = "memory_card_save_delay";
+    variable_state.value = nullptr;
+    
+    if( environ_cb( RETRO_ENVIRONMENT_GET_VARIABLE, &variable_state ) && variable_state.value )
+    {
+        memory_card_save_delay = atoi( variable_state.value );
+        Console.SetMemoryCardSaveDelay( memory_card_save_delay );
+        LOG( "Memory card save delay: " + to_string( memory_card_save_delay ) + " frames" );
+    }
+    
+    variable_state.key = "memory_card_storage";
+    variable_state.value = nullptr;
+    
+    if( environ_cb( RETRO_ENVIRONMENT_GET_VARIABLE, &variable_state ) && variable_state.value )
+    {
+        // this only takes effect when a game is loaded
+        use_frontend_save_ram = !strcmp( variable_state.value, "Frontend save RAM" );
+        LOG( string("Memory card storage: ") + variable_state.value );
+    }
+    
+    variable_state.key = "frame_tracing";
+    variable_state.value = nullptr;
+    
+    if( environ_cb( RETRO_ENVIRONMENT_GET_VARIABLE, &variable_state ) && variable_state.value )
+      enable_frame_tracing = !strcmp( variable_state.value, "Enabled" );
+    
+    variable_state.key = "render_statistics";
+    variable_state.value = nullptr;
+    
+    if( environ_cb( RETRO_ENVIRONMENT_GET_VARIABLE, &variable_state ) && variable_state.value )
+    {
+        enable_render_statistics = !strcmp( variable_state.value, "Enabled" );
+        Video.ResetStatistics();
+        LOG( string("Render statistics ") + (enable_render_statistics? "enabled" : "disabled" ) );
+    }
+    
+    variable_state.key = "input_movie";
+    variable_state.value = nullptr;
+    
+    if( environ_cb( RETRO_ENVIRONMENT_GET_VARIABLE, &variable_state ) && variable_state.value )
+    {
+        // movies are started from retro_run, once
+        // the console has its bios and cartridge
+        if( !strcmp( variable_state.value, "Record" ) )
+          requested_movie_mode = MovieModes::Recording;
+        else if( !strcmp( variable_state.value, "Replay" ) )
+          requested_movie_mode = MovieModes::Replaying;
+        else
+          requested_movie_mode = MovieModes::Disabled;
+    }
+    
+    // the environment variable enables tracing too,
+    // for frontends that cannot change core options
+    const char* TracePath = getenv( "VIRCON32_TRACE" );
+    set_frame_tracing( enable_frame_tracing || (TracePath && *TracePath) );
+}
+
+
+// =============================================================================
+//      HANDLING INPUT MOVIES
+// =============================================================================
+
+
+// the mode that was last applied, so that a movie
+// is only started again when the option changes
+MovieModes applied_movie_mode = MovieModes::Disabled;
+
+// -----------------------------------------------------------------------------
+
+// movies go to the path in VIRCON32_MOVIE if that variable
+// is set, or next to the game's memory card otherwise
+static string get_movie_path()
+{
+    const char* MoviePath = getenv( "VIRCON32_MOVIE" );
+    
+    if( MoviePath && *MoviePath )
+      return MoviePath;
+    
+    if( !LoadedCartridgePath.empty() )
+      return LoadedMemoryCardPath.substr( 0, LoadedMemoryCardPath.rfind( '.' ) ) + ".v32movie";
+    
+    const char *SaveDirectory = nullptr;
+    environ_cb( RETRO_ENVIRONMENT_GET_SAVE_DIRECTORY, &SaveDirectory );
+    
+    if( !SaveDirectory )
+      return "vircon32-bios.v32movie";
+    
+    return string(SaveDirectory) + "/vircon32-bios.v32movie";
+}
+
+// -----------------------------------------------------------------------------
+
+static void update_input_movie()
+{
+    if( requested_movie_mode == applied_movie_mode )
+      return;
+    
+    applied_movie_mode = requested_movie_mode;
+    Movie.Stop();
+    
+    if( applied_movie_mode == MovieModes::Recording )
+      Movie.StartRecording( get_movie_path() );
+    
+    else if( applied_movie_mode == MovieModes::Replaying )
+      Movie.StartReplay( get_movie_path() );
+    
+    // movies start with a console reset
+    Rewind.Clear();
+    RunAhead.Invalidate();
+}
+
+// -----------------------------------------------------------------------------
+
+// loading other states would make a movie
+// not match, so that ends the current one
+static void stop_input_movie()
+{
+    if( Movie.GetMode() == MovieModes::Disabled )
+      return;
+    
+    LOG( "Console state changed: input movie stopped" );
+    Movie.Stop();
+}
+
+// -----------------------------------------------------------------------------
+
+// gamepad connections are always read; controls
+// are not, for frames skipped without polling
+static MovieFrame read_frame_inputs( bool read_controls )
+{
+    MovieFrame Inputs;
+    memset( &Inputs, 0, sizeof(MovieFrame) );
+    Inputs.ControlsRead = read_controls;
+    
+    for( int Port = 0; Port < V32::Constants::GamepadPorts; Port++ )
+    {
+        if( !Console.HasGamepad( Port ) )
+          continue;
+        
+        Inputs.ConnectedGamepads |= (1 << Port);
+        
+        if( !read_controls )
+          continue;
+        
+        for( int Control = 0; Control <= (int)V32::GamepadControls::ButtonR; Control++ )
+          if( input_state_cb( Port, RETRO_DEVICE_JOYPAD, 0, gamepad_control_buttons[ Control ] ) )
+            Inputs.Controls[ Port ] |= (1 << Control);
+    }
+    
+    return Inputs;
 }
 
 
@@ -219,7 +589,7 @@ void retro_get_system_info( struct retro_system_info *info )
     info->library_name     = "Vircon32";
     info->library_version  = "2024.08.28";
     info->need_fullpath    = true;          // games can be too large to hold in memory
-    info->valid_extensions = "v32|V32";     // target system may be case sensitive
+    info->valid_extensions = "v32|V32|v32z|V32Z";     // target system may be case sensitive
 }
 
 // -----------------------------------------------------------------------------
@@ -274,55 +644,107 @@ void retro_set_environment( retro_environment_t cb )
 
 void retro_run()
 {
+    TRACE_SCOPE( "retro_run" );
+    
     // if config variables have changed, update them
     bool variables_changed = false;
     
     if( environ_cb( RETRO_ENVIRONMENT_GET_VARIABLE_UPDATE, &variables_changed ) && variables_changed )
       update_config_variables();
     
+    // start or stop movies as configured
+    update_input_movie();
+    
     // determine if this frame will be skipped
     bool skip_frame = enable_frameskip && audio_buffer_active && audio_buffer_underrun_likely;
     
     // when possible, run a full frame
     if( !skip_frame )
     {
-        // read input for all connected gamepads
+        // read input for all connected gamepads;
+        // movies may record or replace the inputs
         input_poll_cb();
+        MovieFrame Inputs = read_frame_inputs( true );
+        Movie.ProcessFrame( Inputs );
+        ApplyMovieFrame( Console, Inputs );
         
-        for( int Port = 0; Port < V32::Constants::GamepadPorts; Port++ )
+        // in-core rewind and run-ahead rely on page
+        // tracking, so they need writes from the
+        // frontend to be found before each frame
+        if( Rewind.IsEnabled() || run_ahead_frames > 0 )
         {
-            if( !Console.HasGamepad( Port ) )
-              continue;
-            
-            // read all controls
-            Console.SetGamepadControl( Port, V32::GamepadControls::Left,        input_state_cb( Port, RETRO_DEVICE_JOYPAD, 0, RETRO_DEVICE_ID_JOYPAD_LEFT  ) );
-            Console.SetGamepadControl( Port, V32::GamepadControls::Right,       input_state_cb( Port, RETRO_DEVICE_JOYPAD, 0, RETRO_DEVICE_ID_JOYPAD_RIGHT ) );
-            Console.SetGamepadControl( Port, V32::GamepadControls::Up,          input_state_cb( Port, RETRO_DEVICE_JOYPAD, 0, RETRO_DEVICE_ID_JOYPAD_UP    ) );
-            Console.SetGamepadControl( Port, V32::GamepadControls::Down,        input_state_cb( Port, RETRO_DEVICE_JOYPAD, 0, RETRO_DEVICE_ID_JOYPAD_DOWN  ) );
-            Console.SetGamepadControl( Port, V32::GamepadControls::ButtonStart, input_state_cb( Port, RETRO_DEVICE_JOYPAD, 0, RETRO_DEVICE_ID_JOYPAD_START ) );
-            Console.SetGamepadControl( Port, V32::GamepadControls::ButtonA,     input_state_cb( Port, RETRO_DEVICE_JOYPAD, 0, RETRO_DEVICE_ID_JOYPAD_A     ) );
-            Console.SetGamepadControl( Port, V32::GamepadControls::ButtonB,     input_state_cb( Port, RETRO_DEVICE_JOYPAD, 0, RETRO_DEVICE_ID_JOYPAD_B     ) );
-            Console.SetGamepadControl( Port, V32::GamepadControls::ButtonX,     input_state_cb( Port, RETRO_DEVICE_JOYPAD, 0, RETRO_DEVICE_ID_JOYPAD_X     ) );
-            Console.SetGamepadControl( Port, V32::GamepadControls::ButtonY,     input_state_cb( Port, RETRO_DEVICE_JOYPAD, 0, RETRO_DEVICE_ID_JOYPAD_Y     ) );
-            Console.SetGamepadControl( Port, V32::GamepadControls::ButtonL,     input_state_cb( Port, RETRO_DEVICE_JOYPAD, 0, RETRO_DEVICE_ID_JOYPAD_L     ) );
-            Console.SetGamepadControl( Port, V32::GamepadControls::ButtonR,     input_state_cb( Port, RETRO_DEVICE_JOYPAD, 0, RETRO_DEVICE_ID_JOYPAD_R     ) );
+            Console.RAM.SyncExposedMemory();
+            Console.MemoryCardController.SyncExposedMemory();
         }
         
+        // to rewind, go back 2 states and then run
+        // 1 frame, so that the screen is redrawn
+        if( Rewind.IsEnabled() && input_state_cb( 0, RETRO_DEVICE_JOYPAD, 0, RETRO_DEVICE_ID_JOYPAD_L2 ) )
+          if( Rewind.StepBack() )
+          {
+              Rewind.StepBack();
+              RunAhead.Invalidate();
+              stop_input_movie();
+          }
+        
+        // cheats take effect at the start of each frame
+        Cheats.ApplyCheats();
+        
         // run the console
         if( !Console.IsPowerOn() )
           Console.SetPower( true );
         
-        Video.BeginFrame();
+        // with run-ahead, the video for this frame is
+        // replaced with the one from a predicted frame
+        bool run_ahead = (run_ahead_frames > 0 && Console.HasCartridge());
+        
+        if( run_ahead )
+          RunAheadSnapshot::SuppressVideo( true );
+        else
+          Video.BeginFrame();
+        
         Console.RunNextFrame( false );
+        Console.GetFrameSoundOutput( AudioBuffer );
+        Rewind.CaptureState();
+        
+        // predict the next frames with the same inputs,
+        // showing only the last one and then going back
+        if( run_ahead )
+        {
+            RunAhead.Save();
+            RunAheadSnapshot::SuppressMemoryCardSaves( true );
+            
+            for( unsigned i = 1; i < run_ahead_frames; i++ )
+              Console.RunNextFrame( false );
+            
+            RunAheadSnapshot::SuppressVideo( false );
+            Video.BeginFrame();
+            Console.RunNextFrame( false );
+            RunAheadSnapshot::SuppressMemoryCardSaves( false );
+        }
         
         // ensure that all queued quads are rendered
         Video.RenderQuadQueue();
         
+        // report averages every 5 seconds
+        if( enable_render_statistics && Video.GetStatistics().Frames >= 300 )
+        {
+            LOG( Video.GetStatisticsReport() );
+            Video.ResetStatistics();
+        }
+        
+        if( run_ahead )
+          RunAhead.Restore();
+        
+        // start copying the screen in the GPU, in
+        // case it is needed later for a savestate
+        if( savestates_requested && enable_compact_savestates && enable_savestate_screen )
+          Video.StartScreenReadback();
+        
         // send this frame's video signal to libretro
         video_cb( RETRO_HW_FRAME_BUFFER_VALID, V32::Constants::ScreenWidth, V32::Constants::ScreenHeight, 0 );        
         
         // send this frame's audio signal to libretro
-        Console.GetFrameSoundOutput( AudioBuffer );
         audio_batch_cb( (const int16_t*)AudioBuffer.Samples, V32::Constants::SPUSamplesPerFrame );
     }
     
@@ -330,8 +752,19 @@ void retro_run()
     // to avoid a buffer underrun and prevent crackling
     else
     {
-        // generate 1 frame's worth of audio
+        // controls are kept from the last frame
+        MovieFrame Inputs = read_frame_inputs( false );
+        Movie.ProcessFrame( Inputs );
+        ApplyMovieFrame( Console, Inputs );
+        
+        // generate 1 frame's worth of audio; the frame
+        // runs normally but nothing is drawn, since it
+        // will not be shown and GPU time is saved
+        Cheats.ApplyCheats();
+        Console.SetDrawingSuppressed( true );
         Console.RunNextFrame( false );
+        Console.SetDrawingSuppressed( false );
+        Rewind.CaptureState();
         
         // send this frame's audio signal to libretro
         Console.GetFrameSoundOutput( AudioBuffer );
@@ -392,6 +825,31 @@ string GetMemoryCardPath( const string& CartridgePath )
       return SaveDirectoryUnified + "/" + FileName.substr( 0, DotPosition ) + ".memc";
 }
 
+// -----------------------------------------------------------------------------
+
+// connects the memory card used as save RAM; if the game
+// already has a card file, its contents are kept as initial
+// contents, so they are not lost when switching to save RAM
+void ConnectSaveRAMCard()
+{
+    try
+    {
+        if( FileExists( LoadedMemoryCardPath ) )
+        {
+            Console.LoadMemoryCard( LoadedMemoryCardPath );
+            Console.UnlinkMemoryCardFile();
+        }
+        
+        else
+          Console.ConnectMemoryCard();
+    }
+    catch( const exception& e )
+    {
+        LOG( "ERROR: " + string( e.what() ) );
+        Console.ConnectMemoryCard();
+    }
+}
+
 
 // =============================================================================
 //      ROUTINE FOR LOADING VIRCON32 BIOS
@@ -400,7 +858,7 @@ string GetMemoryCardPath( const string& CartridgePath )
 
 void LoadEmbeddedBios()
 {
-    V32::Callbacks::LogLine( "Loading embedded bios" );
+    Callbacks.LogLine( "Loading embedded bios" );
     
     // save the bios bytes into a stringstream
     std::stringstream InputData;
@@ -442,20 +900,6 @@ void context_reset()
     // initialize video output
     Video.InitRendering();
     
-    // set console's video callbacks
-    V32::Callbacks::ClearScreen = CallbackFunctions::ClearScreen;
-    V32::Callbacks::DrawQuad = CallbackFunctions::DrawQuad;
-    V32::Callbacks::SetMultiplyColor = CallbackFunctions::SetMultiplyColor;
-    V32::Callbacks::SetBlendingMode = CallbackFunctions::SetBlendingMode;
-    V32::Callbacks::SelectTexture = CallbackFunctions::SelectTexture;
-    V32::Callbacks::LoadTexture = CallbackFunctions::LoadTexture;
-    V32::Callbacks::UnloadCartridgeTextures = CallbackFunctions::UnloadCartridgeTextures;
-    V32::Callbacks::UnloadBiosTexture = CallbackFunctions::UnloadBiosTexture;
-    
-    // set console's log callbacks
-    V32::Callbacks::LogLine = CallbackFunctions::LogLine;
-    V32::Callbacks::ThrowException = CallbackFunctions::ThrowException;
-    
     // obtain current time
     time_t CreationTime;
     time( &CreationTime );
@@ -477,17 +921,25 @@ void context_reset()
         {
             Console.LoadCartridge( LoadedCartridgePath );
             
-            // also load the corresponding memory card if existing
-            if( FileExists( LoadedMemoryCardPath ) )
-              Console.LoadMemoryCard( LoadedMemoryCardPath );
-            
-            // otherwise create an empty card and load it
-            else
+            // also load the corresponding memory card, unless it
+            // is in save RAM (in that case it is already connected)
+            if( !memory_card_in_save_ram )
             {
-                Console.CreateMemoryCard( LoadedMemoryCardPath );
-                Console.LoadMemoryCard( LoadedMemoryCardPath );
+                if( FileExists( LoadedMemoryCardPath ) )
+                  Console.LoadMemoryCard( LoadedMemoryCardPath );
+                
+                // otherwise create an empty card and load it
+                else
+                {
+                    Console.CreateMemoryCard( LoadedMemoryCardPath );
+                    Console.LoadMemoryCard( LoadedMemoryCardPath );
+                }
             }
         }
+        
+        // previous rewind and run-ahead states are not valid anymore
+        Rewind.Clear();
+        RunAhead.Invalidate();
     }
     catch( const exception& e )
     {
@@ -603,7 +1055,12 @@ void retro_set_video_refresh(retro_video_refresh_t cb)
 void retro_init()
 {
     LOG( "Received signal: Init" );
-    // (nothing to do for this core)
+    configure_perf_counters();
+    
+    // connect console to video output and log; this must be
+    // done before loading a game, since a memory card in save
+    // RAM is connected then, before any video context exists
+    Console.SetCallbacks( &Callbacks );
 }
 
 // -----------------------------------------------------------------------------
@@ -611,7 +1068,13 @@ void retro_init()
 void retro_deinit()
 {
     LOG( "Received signal: Deinit" );
-    // (nothing to do for this core)
+    
+    // let the frontend show our counters
+    if( perf_cb.perf_log )
+      perf_cb.perf_log();
+    
+    V32::PerfCounters::Start = nullptr;
+    V32::PerfCounters::Stop = nullptr;
 }
 
 // -----------------------------------------------------------------------------
@@ -619,7 +1082,10 @@ void retro_deinit()
 void retro_reset()
 {
     LOG( "Received signal: Reset" );
+    stop_input_movie();
     Console.Reset();
+    Rewind.Clear();
+    RunAhead.Invalidate();
 }
 
 // -----------------------------------------------------------------------------
@@ -666,6 +1132,13 @@ bool retro_load_game( const struct retro_game_info *info )
         
         // build a path for the game's memory card
         LoadedMemoryCardPath = GetMemoryCardPath( LoadedCartridgePath );
+        
+        // when the frontend saves the memory card, it must
+        // be connected now so that save RAM can be loaded
+        memory_card_in_save_ram = use_frontend_save_ram;
+        
+        if( memory_card_in_save_ram )
+          ConnectSaveRAMCard();
     }
     
     // case 2: core loaded with no game
@@ -674,6 +1147,7 @@ bool retro_load_game( const struct retro_game_info *info )
     {
         LOG( "Core loaded with no game" );
         LoadedCartridgePath = "";
+        memory_card_in_save_ram = false;
     }
     
     return true;
@@ -685,8 +1159,33 @@ void retro_unload_game()
 {
     LOG( "Received signal: Unload game" );
     
+    // in profiling builds, report the whole session
+    #if defined(ENABLE_CPU_PROFILER)
+      LOG( Console.CPU.Profiler.GetReport( 32 ) );
+      Console.CPU.Profiler.Clear();
+    #endif
+    
+    // traces are saved when unloading, so
+    // they include the whole game session
+    if( V32::Tracer.IsEnabled() )
+    {
+        set_frame_tracing( false );
+        V32::Tracer.Enable( 20 );
+    }
+    
+    // recordings are saved when stopped
+    Movie.Stop();
+    applied_movie_mode = MovieModes::Disabled;
+    
     Console.UnloadCartridge();
     Console.UnloadMemoryCard();
+    
+    // memory pointers given to the frontend
+    // are only valid until the game is unloaded
+    Console.RAM.EndExposure();
+    
+    // incremental states are only valid for this game
+    IncrementalBases.Clear();
 }
 
 // -----------------------------------------------------------------------------
@@ -708,17 +1207,42 @@ bool retro_load_game_special( unsigned type, const struct retro_game_info *info,
 
 void *retro_get_memory_data( unsigned id )
 {
-    // not implemented
-    (void)id;
-    return nullptr;
+    // pointers are given directly to console memory, so
+    // the frontend can access it without any copies; since
+    // it can also write there, its writes are found later
+    // by comparing memory against a copy
+    switch( id )
+    {
+        case RETRO_MEMORY_SAVE_RAM:
+            if( memory_card_in_save_ram && Console.HasMemoryCard() )
+              return Console.MemoryCardController.ExposeMemory();
+            return nullptr;
+            
+        case RETRO_MEMORY_SYSTEM_RAM:
+            return Console.RAM.ExposeMemory();
+            
+        default:
+            return nullptr;
+    }
 }
 
 // -----------------------------------------------------------------------------
 
 size_t retro_get_memory_size( unsigned id )
 {
-    // not implemented
-    return 0;
+    switch( id )
+    {
+        case RETRO_MEMORY_SAVE_RAM:
+            if( memory_card_in_save_ram && Console.HasMemoryCard() )
+              return Console.MemoryCardController.MemorySize * 4;
+            return 0;
+            
+        case RETRO_MEMORY_SYSTEM_RAM:
+            return Console.RAM.MemorySize * 4;
+            
+        default:
+            return 0;
+    }
 }
 
 
@@ -729,6 +1253,10 @@ size_t retro_get_memory_size( unsigned id )
 
 size_t retro_serialize_size()
 {
+    // frontends always ask for the size before saving,
+    // so from now on the screen is copied on each frame
+    savestates_requested = true;
+    
     // savestates may be a different size for each
     // game, that is fine by libretro as long as
     // that size is always the same for each game
@@ -745,6 +1273,9 @@ size_t retro_serialize_size()
 
 bool retro_serialize( void *data, size_t size )
 {
+    TRACE_SCOPE( "retro_serialize" );
+    PERF_SCOPE( Serialize );
+    
     // check that received buffer size is enough
     if( size < retro_serialize_size() )
     {
@@ -752,13 +1283,32 @@ bool retro_serialize( void *data, size_t size )
         return false;
     }
     
-    return SaveState( (ConsoleState*)data );
+    // states for the frontend's own run-ahead are loaded back by
+    // this same instance, so they only need the RAM pages changed
+    // since a base snapshot that is kept in the core
+    int savestate_context = RETRO_SAVESTATE_CONTEXT_NORMAL;
+    environ_cb( RETRO_ENVIRONMENT_GET_SAVESTATE_CONTEXT, &savestate_context );
+    
+    if( enable_incremental_savestates && savestate_context == RETRO_SAVESTATE_CONTEXT_RUNAHEAD_SAME_INSTANCE )
+      if( IncrementalBases.SaveState( Console, data, size ) )
+        return true;
+    
+    // compact states are only smaller when most of RAM
+    // is still unused; otherwise save a full state instead
+    if( enable_compact_savestates )
+      if( SaveCompactState( Console, data, size, enable_savestate_screen? &Video : nullptr ) )
+        return true;
+    
+    return SaveState( Console, (ConsoleState*)data );
 }
 
 // -----------------------------------------------------------------------------
 
 bool retro_unserialize( const void *data, size_t size )
 {
+    TRACE_SCOPE( "retro_unserialize" );
+    PERF_SCOPE( Unserialize );
+    
     // check that received buffer size is enough
     if( size < retro_serialize_size() )
     {
@@ -766,26 +1316,36 @@ bool retro_unserialize( const void *data, size_t size )
         return false;
     }
     
-    return LoadState( (const ConsoleState*)data );
+    // previous rewind and run-ahead states are not valid anymore
+    Rewind.Clear();
+    RunAhead.Invalidate();
+    stop_input_movie();
+    
+    // all kinds of states can always be loaded,
+    // including the ones from previous versions
+    if( IsCompactState( data, size ) )
+      return LoadCompactState( Console, data, size, &Video );
+    
+    if( IsIncrementalState( data, size ) )
+      return IncrementalBases.LoadState( Console, data, size );
+    
+    return LoadState( Console, (const ConsoleState*)data );
 }
 
 
 // =============================================================================
-//      HANDLING CHEAT SUPPORT (NOT SUPPORTED)
+//      HANDLING CHEAT SUPPORT
 // =============================================================================
 
 
 void retro_cheat_reset()
 {
-    // not implemented
+    Cheats.Clear();
 }
 
 // -----------------------------------------------------------------------------
 
 void retro_cheat_set( unsigned index, bool enabled, const char *code )
 {
-    // not implemented
-    (void)index;
-    (void)enabled;
-    (void)code;
+    Cheats.SetCheat( index, enabled, code? code : "" );
 }